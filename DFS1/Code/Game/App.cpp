@@ -2,6 +2,12 @@
 #include "Game/GameCommon.hpp"
 #include "Game/Game.hpp"
 #include "Game/Player.hpp"
+#include "Game/BasketballCourt.hpp"
+#include "Game/PhysicsBenchmark.hpp"
+#include "Game/ShotSolver.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include <algorithm>
+#include <stdio.h>
 
 
 App* g_theApp = nullptr;
@@ -34,6 +40,7 @@ void App::Startup()
 
 	JobSystemConfig jobConfig;
 	jobConfig.m_numWorkers = -1;
+	jobConfig.m_isProfilingEnabled = g_gameConfigBlackboard.GetValue("jobProfiling", false);
 	g_theJobSystem = new JobSystem(jobConfig);
 
 	EventSystemConfig eventConfig;
@@ -89,6 +96,26 @@ void App::Startup()
 	g_theGame->Startup();
 
 	SubscribeEventCallbackFunction("quit", App::Event_Quit);
+	SubscribeEventCallbackFunction("ballbroadphasebenchmark", Command_BallBroadphaseBenchmark);
+	SubscribeEventCallbackFunction("ballintegrationbenchmark", Command_BallIntegrationBenchmark);
+	SubscribeEventCallbackFunction("physicsstepbenchmark", Command_PhysicsStepBenchmark);
+	SubscribeEventCallbackFunction("physicsbenchmark", Command_PhysicsBenchmark);
+	SubscribeEventCallbackFunction("ballrenderstats", BasketballCourt::Command_BallRenderStats);
+	SubscribeEventCallbackFunction("courtrenderstats", BasketballCourt::Command_CourtRenderStats);
+	SubscribeEventCallbackFunction("renderqueuestats", BasketballCourt::Command_RenderQueueStats);
+	SubscribeEventCallbackFunction("renderqueuetest", Command_RenderQueueTest);
+	SubscribeEventCallbackFunction("renderrecordingtest", Command_RenderRecordingTest);
+	SubscribeEventCallbackFunction("cullingstats", BasketballCourt::Command_CullingStats);
+	SubscribeEventCallbackFunction("frustumcullingbenchmark", Command_FrustumCullingBenchmark);
+	SubscribeEventCallbackFunction("ringallocatortest", RingBufferAllocator::Command_RingBufferAllocatorTest);
+	SubscribeEventCallbackFunction("staticcolliderbenchmark", Command_StaticColliderBenchmark);
+	SubscribeEventCallbackFunction("blockertreebenchmark", Command_BlockerTreeBenchmark);
+	SubscribeEventCallbackFunction("ballraycastbenchmark", Command_BallRaycastBenchmark);
+	SubscribeEventCallbackFunction("ballsleepstats", BasketballCourt::Command_BallSleepStats);
+	SubscribeEventCallbackFunction("ballsleepbenchmark", Command_BallSleepBenchmark);
+	SubscribeEventCallbackFunction("tunnelingtest", Command_TunnelingTest);
+	SubscribeEventCallbackFunction("shotsolverbenchmark", Command_ShotSolverBenchmark);
+	SubscribeEventCallbackFunction("obstaclelevelallocationtest", Command_ObstacleLevelAllocationTest);
 
 	ConsoleTutorial();
 
@@ -133,7 +160,125 @@ void App::Shutdown()
 	g_theEventSystem = nullptr;
 	delete g_theJobSystem;
 	g_theJobSystem = nullptr;
+	delete Clock::s_theSystemClock;
+	Clock::s_theSystemClock = nullptr;
+}
+
+bool App::IsHeadlessCommandLine(std::string const& commandLine)
+{
+	Strings tokens = SplitStringOnDelimiter(commandLine, ' ');
+	if (tokens.empty())
+	{
+		return false;
+	}
+	std::string command = tokens[0];
+	std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) -> unsigned char { return (unsigned char)std::tolower(c); });
+	return command == "physicsbenchmark" || command == "tunnelingtest" || command == "renderqueuetest" || command == "renderrecordingtest" || command == "ringallocatortest";
+}
+
+int App::RunHeadless(std::string const& commandLine)
+{
+	InitializeGameConfig("Data/GameConfig.xml");
+
+	Clock::s_theSystemClock = new Clock();
+
+	g_theRNG = new RandomNumberGenerator();
+
+	JobSystemConfig jobConfig;
+	jobConfig.m_numWorkers = -1;
+	g_theJobSystem = new JobSystem(jobConfig);
+
+	EventSystemConfig eventConfig;
+	g_theEventSystem = new EventSystem(eventConfig);
+
+	// Game::Startup loads textures, sounds and UI, none of which the physics needs
+	g_theGame = new Game();
+
+	Clock::s_theSystemClock->TickSystemClock();
+	g_theJobSystem->Startup();
+	g_theEventSystem->Startup();
+
+	// Same parsing as DevConsole::Execute, minus the console
+	EventArgs args;
+	std::string lowercaseCommandLine = commandLine;
+	std::transform(lowercaseCommandLine.begin(), lowercaseCommandLine.end(), lowercaseCommandLine.begin(), [](unsigned char c) -> unsigned char { return (unsigned char)std::tolower(c); });
+	Strings pairList = SplitStringOnDelimiter(lowercaseCommandLine, ' ');
+	for (int pairIndex = 1; pairIndex < (int)pairList.size(); pairIndex++)
+	{
+		Strings pairElements = SplitStringOnDelimiter(pairList[pairIndex], '=');
+		if (pairElements.size() > 1)
+		{
+			args.SetValue(pairElements[0], pairElements[1]);
+		}
+	}
+
+	std::string report;
+	std::string outputPath;
+	bool hasFailed = false;
+	if (!pairList.empty() && pairList[0] == "tunnelingtest")
+	{
+		outputPath = args.GetValue("output", "TunnelingTest.txt");
+		std::vector<TunnelingTestResult> results = RunTunnelingTests(args);
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			report += FormatTunnelingTestReport(results[i]) + "\n";
+		}
+		hasFailed = HasTunnelingTestFailed(results);
+	}
+	else if (!pairList.empty() && pairList[0] == "renderqueuetest")
+	{
+		outputPath = args.GetValue("output", "RenderQueueTest.txt");
+		RenderQueueTestResult result = RunRenderQueueTest(args);
+		report = FormatRenderQueueTestReport(result) + "\n";
+		hasFailed = result.HasFailed();
+	}
+	else if (!pairList.empty() && pairList[0] == "renderrecordingtest")
+	{
+		outputPath = args.GetValue("output", "RenderRecordingTest.txt");
+		RenderRecordingTestResult result = RunRenderRecordingTest(args);
+		report = FormatRenderRecordingTestReport(result) + "\n";
+		hasFailed = result.HasFailed();
+	}
+	else if (!pairList.empty() && pairList[0] == "ringallocatortest")
+	{
+		outputPath = args.GetValue("output", "RingAllocatorTest.txt");
+		std::vector<std::string> lines;
+		bool hasPassed = RingBufferAllocator::RunSelfTest((unsigned int)args.GetValue("seed", 1234), args.GetValue("frames", 2000), lines);
+		report = Stringf("Ring buffer allocator test %s\n", hasPassed ? "passed" : "FAILED");
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			report += lines[i] + "\n";
+		}
+		hasFailed = !hasPassed;
+	}
+	else
+	{
+		outputPath = args.GetValue("output", "PhysicsBenchmark.txt");
+		PhysicsScenarioConfig config = ParsePhysicsScenarioConfig(args);
+		PhysicsScenarioResult result = RunPhysicsScenario(config);
+		report = FormatPhysicsScenarioReport(config, result) + "\n";
+	}
+
+	printf("%s", report.c_str());
+	DebuggerPrintf("%s", report.c_str());
+	std::vector<uint8_t> reportBuffer(report.begin(), report.end());
+	bool wasWritten = FileWriteFromBuffer(reportBuffer, outputPath);
+
+	g_theEventSystem->Shutdown();
+	g_theJobSystem->Shutdown();
+
+	delete g_theGame;
+	g_theGame = nullptr;
+	delete g_theEventSystem;
+	g_theEventSystem = nullptr;
+	delete g_theJobSystem;
+	g_theJobSystem = nullptr;
+	delete g_theRNG;
+	g_theRNG = nullptr;
+	delete Clock::s_theSystemClock;
+	Clock::s_theSystemClock = nullptr;
 
+	return wasWritten && !hasFailed ? 0 : 1;
 }
 
 void App::Run()
@@ -246,6 +391,7 @@ void App::ConsoleTutorial()
 	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, "Mouse wheel to change throw angle");
 	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, "Hold Ctrl and use mouse to adjust spin");
 	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, "Hold Left mouse button and release to shoot");
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, "G to shoot with aim assist");
 	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, "-----------------");
 	g_theDevConsole->AddLine(Rgba8::COLOR_TRANSPARENT, "\n");
 	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, "Type help to see the list of events");
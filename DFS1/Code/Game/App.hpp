@@ -25,6 +25,12 @@ public:
 	void Run();
 	void RunFrame();
 
+	// "physicsbenchmark key=value ..." or "tunnelingtest key=value ..." on the command line: runs it without a
+	// window, renderer or audio, writes the report to output= and returns the process exit code, nonzero
+	// when a tunneling test shot got through with continuous collision on
+	static bool IsHeadlessCommandLine(std::string const& commandLine);
+	int RunHeadless(std::string const& commandLine);
+
 	bool IsQuitting() const { return m_isQuitting; }
 	bool HandleQuitRequested();
 
@@ -1,28 +1,35 @@
 #include "Ball.hpp"
-
-Ball::Ball(BasketballCourt* map)
-	:Entity(map)
+#include "Game/BasketballCourt.hpp"
+
+Ball::Ball(BasketballCourt* map, int stateIndex)
+	:Entity(map, map->m_ballStates.m_positions[stateIndex], map->m_ballStates.m_velocities[stateIndex], map->m_ballStates.m_accelerations[stateIndex],
+		map->m_ballStates.m_angularVelocities[stateIndex], map->m_ballStates.m_angularAccelerations[stateIndex],
+		map->m_ballStates.m_isGravityEnabled[stateIndex], map->m_ballStates.m_drags[stateIndex], map->m_ballStates.m_masses[stateIndex])
+	,m_stateIndex(stateIndex)
+	,m_isSimulatingPhysics(map->m_ballStates.m_isSimulatingPhysics[stateIndex])
+	,m_isAwake(map->m_ballStates.m_isAwake[stateIndex])
+	,m_rotation(map->m_ballStates.m_rotations[stateIndex])
+	,m_inertia(map->m_ballStates.m_inertias[stateIndex])
 {
+	m_map->m_ballStates.ResetSlot(m_stateIndex);
+	m_isSimulatingPhysics = true;
+
 	EulerAngles euler = EulerAngles(0.f, 0.f, 90.f);
 	m_rotation = Quaternion(euler);
-	m_inertia = (2.f / 5.f) * m_mass * m_radius * m_radius;
 
+	// These write straight into the slot, where the integration kernels read them
+	m_isGravityEnabled = true;
 	m_mass = BALL_MASS;
 	m_radius = BALL_RADIUS;
+	m_inertia = BALL_INERTIA;
 	m_drag = 0.5f * (m_mass / (4 / 3 * PI * m_radius * m_radius)) * PI * 0.47f; // DRAG_COEFFICIENT;
 
-	AddVertsForSphere(m_vertexes, Vec3::ZERO, m_radius);
-
-	m_vbo = g_theRenderer->CreateVertexBuffer(sizeof(Vertex_PCU) * (int)m_vertexes.size());
-	g_theRenderer->CopyCPUToGPU(m_vertexes.data(), (int)(m_vertexes.size() * sizeof(Vertex_PCU)), m_vbo);
-
 	m_angularVelocity = Vec3::ZERO;
 }
 
 Ball::~Ball()
 {
-	delete m_vbo;
-	m_vbo = nullptr;
+	m_map->m_ballStates.ResetSlot(m_stateIndex);
 }
 
 void Ball::Update(float deltaSeconds)
@@ -54,7 +61,7 @@ void Ball::Update(float deltaSeconds)
 
 void Ball::UpdatePhysics(float fixedDeltaSeconds)
 {
-	if (!m_isSimulatingPhysics)
+	if (!m_isSimulatingPhysics || !m_isAwake)
 	{
 		return;
 	}
@@ -88,13 +95,18 @@ void Ball::UpdatePhysics(float fixedDeltaSeconds)
 	m_angularAcceleration = Vec3::ZERO;
 }
 
-void Ball::Render() const
+void Ball::Render(RenderQueue& queue) const
+{
+	RenderDrawState state;
+	state.m_texture = m_texture;
+	state.m_modelMatrix = Ball::GetModeMatrix();
+	state.m_modelColor = m_color;
+	queue.AddIndexedBuffer(state, m_map->m_ballMeshVBO, m_map->m_ballMeshIBO, m_map->m_ballMeshIndices.size());
+}
+
+float Ball::GetBoundingRadius() const
 {
-	g_theRenderer->SetBlendMode(BlendMode::ALPHA);
-	g_theRenderer->SetDepthStencilMode(DepthMode::ENABLED);
-	g_theRenderer->BindTexture(m_texture);
-	g_theRenderer->SetModelConstants(Ball::GetModeMatrix(), m_color);
-	g_theRenderer->DrawVertexBuffer(m_vbo, m_vertexes.size());
+	return m_radius;
 }
 
 Mat44 Ball::GetModeMatrix() const
@@ -105,9 +117,15 @@ Mat44 Ball::GetModeMatrix() const
 	return modelMat;
 }
 
+void Ball::WakeUp()
+{
+	m_isAwake = true;
+	m_map->m_ballStates.m_sleepSeconds[m_stateIndex] = 0.f;
+}
+
 void Ball::PlaySound(SoundID sound)
 {
-	if (m_timeSincePlaySound < 0.1f)
+	if (m_timeSincePlaySound < 0.1f || !g_theAudio)
 	{
 		return;
 	}
@@ -5,20 +5,25 @@
 class Ball: public Entity
 {
 public:
-	Ball(BasketballCourt* map);
+	// stateIndex is the slot the court's m_balls allocated for the ball, its motion state lives in m_ballStates there
+	Ball(BasketballCourt* map, int stateIndex);
 	virtual ~Ball();
 	
 	virtual void Update(float deltaSeconds) override;
 	virtual void UpdatePhysics(float fixedDeltaSeconds) override;
-	virtual void Render() const override;
+	// Draws just this ball with the court's shared sphere, the court normally draws all balls at once
+	virtual void Render(RenderQueue& queue) const override;
 	virtual Mat44 GetModeMatrix() const override;
+	virtual float GetBoundingRadius() const override;
 	void PlaySound(SoundID sound);
+	// For pushes that move a sleeping ball without giving it any velocity
+	void WakeUp();
 public:
-	bool						m_isSimulatingPhysics = true;
-	VertexBuffer*				m_vbo			= nullptr;
-	std::vector<Vertex_PCU>		m_vertexes;
-	Quaternion					m_rotation;
-	float						m_inertia;
+	int							m_stateIndex = -1;
+	bool&						m_isSimulatingPhysics;
+	bool&						m_isAwake;
+	Quaternion&					m_rotation;
+	float&						m_inertia;
 	Rgba8						m_color = Rgba8::COLOR_WHITE;
 	Texture*					m_texture = nullptr;
 	bool						m_isGarbage;
@@ -0,0 +1,584 @@
+#include "Game/BallPhysics.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cfloat>
+#include <climits>
+
+// The SIMD kernel reads four consecutive Vec3s as three registers and four Quaternions as four
+static_assert(sizeof(Vec3) == 3 * sizeof(float), "BallStateArrays expects tightly packed Vec3");
+static_assert(sizeof(Quaternion) == 4 * sizeof(float), "BallStateArrays expects tightly packed Quaternion");
+
+BallStateArrays::BallStateArrays(int capacity)
+{
+	m_capacity = (capacity + BALL_SIMD_WIDTH - 1) / BALL_SIMD_WIDTH * BALL_SIMD_WIDTH;
+	m_positions = new Vec3[m_capacity];
+	m_velocities = new Vec3[m_capacity];
+	m_accelerations = new Vec3[m_capacity];
+	m_angularVelocities = new Vec3[m_capacity];
+	m_angularAccelerations = new Vec3[m_capacity];
+	m_rotations = new Quaternion[m_capacity];
+	m_masses = new float[m_capacity];
+	m_drags = new float[m_capacity];
+	m_inertias = new float[m_capacity];
+	m_isGravityEnabled = new bool[m_capacity];
+	m_isSimulatingPhysics = new bool[m_capacity];
+	m_isAwake = new bool[m_capacity];
+	m_sleepSeconds = new float[m_capacity];
+
+	for (int slot = 0; slot < m_capacity; slot++)
+	{
+		ResetSlot(slot);
+	}
+}
+
+BallStateArrays::~BallStateArrays()
+{
+	delete[] m_positions;
+	delete[] m_velocities;
+	delete[] m_accelerations;
+	delete[] m_angularVelocities;
+	delete[] m_angularAccelerations;
+	delete[] m_rotations;
+	delete[] m_masses;
+	delete[] m_drags;
+	delete[] m_inertias;
+	delete[] m_isGravityEnabled;
+	delete[] m_isSimulatingPhysics;
+	delete[] m_isAwake;
+	delete[] m_sleepSeconds;
+}
+
+void BallStateArrays::ResetSlot(int slot)
+{
+	m_positions[slot] = Vec3::ZERO;
+	m_velocities[slot] = Vec3::ZERO;
+	m_accelerations[slot] = Vec3::ZERO;
+	m_angularVelocities[slot] = Vec3::ZERO;
+	m_angularAccelerations[slot] = Vec3::ZERO;
+	m_rotations[slot] = Quaternion();
+
+	// Empty slots still go through the SIMD kernel, a unit mass keeps them finite
+	m_masses[slot] = 1.f;
+	m_drags[slot] = 0.f;
+	m_inertias[slot] = 0.f;
+	m_isGravityEnabled[slot] = false;
+	m_isSimulatingPhysics[slot] = false;
+	m_isAwake[slot] = true;
+	m_sleepSeconds[slot] = 0.f;
+}
+
+// Same operations in the same order as Ball::UpdatePhysics, so the results match it bit for bit
+void IntegrateBallStatesScalar(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds)
+{
+	if (end > states.m_capacity)
+	{
+		end = states.m_capacity;
+	}
+
+	for (int i = begin; i < end; i++)
+	{
+		if (!states.m_isSimulatingPhysics[i] || !states.m_isAwake[i])
+		{
+			continue;
+		}
+
+		float mass = states.m_masses[i];
+		float inverseMass = 1.f / mass;
+		Vec3& position = states.m_positions[i];
+		Vec3& velocity = states.m_velocities[i];
+		Vec3& acceleration = states.m_accelerations[i];
+		Vec3& angularVelocity = states.m_angularVelocities[i];
+		Vec3& angularAcceleration = states.m_angularAccelerations[i];
+		Quaternion& rotation = states.m_rotations[i];
+
+		// Gravity, drag, Magnus
+		float accelerationX = acceleration.x + (0.f * mass) * inverseMass;
+		float accelerationY = acceleration.y + (0.f * mass) * inverseMass;
+		float gravity = states.m_isGravityEnabled[i] ? MODIFIED_GRAVITY_RATE : 0.f;
+		float accelerationZ = acceleration.z + (gravity * mass) * inverseMass;
+		float negativeDrag = -states.m_drags[i];
+		accelerationX += (velocity.x * negativeDrag) * inverseMass;
+		accelerationY += (velocity.y * negativeDrag) * inverseMass;
+		accelerationZ += (velocity.z * negativeDrag) * inverseMass;
+
+		float negativeInertia = -states.m_inertias[i];
+		float angularAccelerationX = angularAcceleration.x + angularVelocity.x * negativeInertia;
+		float angularAccelerationY = angularAcceleration.y + angularVelocity.y * negativeInertia;
+		float angularAccelerationZ = angularAcceleration.z + angularVelocity.z * negativeInertia;
+
+		float crossX = angularVelocity.y * velocity.z - angularVelocity.z * velocity.y;
+		float crossY = -(angularVelocity.x * velocity.z - angularVelocity.z * velocity.x);
+		float crossZ = angularVelocity.x * velocity.y - angularVelocity.y * velocity.x;
+		accelerationX += (crossX * 0.47f) * inverseMass;
+		accelerationY += (crossY * 0.47f) * inverseMass;
+		accelerationZ += (crossZ * 0.47f) * inverseMass;
+
+		float angularVelocityX = angularVelocity.x + angularAccelerationX * fixedDeltaSeconds;
+		float angularVelocityY = angularVelocity.y + angularAccelerationY * fixedDeltaSeconds;
+		float angularVelocityZ = angularVelocity.z + angularAccelerationZ * fixedDeltaSeconds;
+
+		// rotation += rotation * Quaternion(angularVelocity) * 0.5 * dt, then normalize
+		float rotationI = rotation.i;
+		float rotationJ = rotation.j;
+		float rotationK = rotation.k;
+		float rotationW = rotation.w;
+		float spinW = (0.f * rotationW) - (angularVelocityX * rotationI) - (angularVelocityY * rotationJ) - (angularVelocityZ * rotationK);
+		float spinI = (0.f * rotationI) + (angularVelocityX * rotationW) + (angularVelocityY * rotationK) - (angularVelocityZ * rotationJ);
+		float spinJ = (0.f * rotationJ) + (angularVelocityY * rotationW) + (angularVelocityZ * rotationI) - (angularVelocityX * rotationK);
+		float spinK = (0.f * rotationK) + (angularVelocityZ * rotationW) + (angularVelocityX * rotationJ) - (angularVelocityY * rotationI);
+		rotationI += (spinI * 0.5f) * fixedDeltaSeconds;
+		rotationJ += (spinJ * 0.5f) * fixedDeltaSeconds;
+		rotationK += (spinK * 0.5f) * fixedDeltaSeconds;
+		rotationW += (spinW * 0.5f) * fixedDeltaSeconds;
+		float lengthSquared = rotationI * rotationI + rotationJ * rotationJ + rotationK * rotationK + rotationW * rotationW;
+		if (lengthSquared != 1.f)
+		{
+			float oneOverLength = 1.f / sqrtf(lengthSquared);
+			rotationI *= oneOverLength;
+			rotationJ *= oneOverLength;
+			rotationK *= oneOverLength;
+			rotationW *= oneOverLength;
+		}
+
+		float velocityX = velocity.x + accelerationX * fixedDeltaSeconds;
+		float velocityY = velocity.y + accelerationY * fixedDeltaSeconds;
+		float velocityZ = velocity.z + accelerationZ * fixedDeltaSeconds;
+		position.x += velocityX * fixedDeltaSeconds;
+		position.y += velocityY * fixedDeltaSeconds;
+		position.z += velocityZ * fixedDeltaSeconds;
+
+		velocity = Vec3(velocityX, velocityY, velocityZ);
+		angularVelocity = Vec3(angularVelocityX, angularVelocityY, angularVelocityZ);
+		rotation.i = rotationI;
+		rotation.j = rotationJ;
+		rotation.k = rotationK;
+		rotation.w = rotationW;
+		acceleration = Vec3::ZERO;
+		angularAcceleration = Vec3::ZERO;
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+// Four packed Vec3s (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) <-> one register per component
+static void LoadVec3x4(Vec3 const* vectors, __m128& outX, __m128& outY, __m128& outZ)
+{
+	float const* floats = &vectors[0].x;
+	__m128 a = _mm_loadu_ps(floats);
+	__m128 b = _mm_loadu_ps(floats + 4);
+	__m128 c = _mm_loadu_ps(floats + 8);
+	outX = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	outY = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	outZ = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static void StoreVec3x4(Vec3* vectors, __m128 x, __m128 y, __m128 z)
+{
+	float* floats = &vectors[0].x;
+	__m128 xy01 = _mm_unpacklo_ps(x, y);
+	__m128 xy23 = _mm_unpackhi_ps(x, y);
+	_mm_storeu_ps(floats, _mm_shuffle_ps(xy01, _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(floats + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(floats + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static __m128 Select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+{
+	return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+// SSE version of IntegrateBallStatesScalar, four slots per iteration. Slots that are not simulating
+// or are asleep are computed too (cheaper than branching), then their old state is selected back before storing.
+void IntegrateBallStatesSIMD(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds)
+{
+	GUARANTEE_OR_DIE(begin % BALL_SIMD_WIDTH == 0, "IntegrateBallStatesSIMD needs begin to be a multiple of BALL_SIMD_WIDTH");
+	if (end > states.m_capacity)
+	{
+		end = states.m_capacity;
+	}
+
+	__m128 const zero = _mm_setzero_ps();
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const half = _mm_set1_ps(0.5f);
+	__m128 const magnus = _mm_set1_ps(0.47f);
+	__m128 const deltaSeconds = _mm_set1_ps(fixedDeltaSeconds);
+
+	for (int i = begin; i < end; i += BALL_SIMD_WIDTH)
+	{
+		bool const* isSimulating = &states.m_isSimulatingPhysics[i];
+		bool const* isAwake = &states.m_isAwake[i];
+		bool isActive0 = isSimulating[0] && isAwake[0];
+		bool isActive1 = isSimulating[1] && isAwake[1];
+		bool isActive2 = isSimulating[2] && isAwake[2];
+		bool isActive3 = isSimulating[3] && isAwake[3];
+		if (!isActive0 && !isActive1 && !isActive2 && !isActive3)
+		{
+			continue;
+		}
+		__m128 isActive = _mm_cmpneq_ps(_mm_set_ps(isActive3, isActive2, isActive1, isActive0), zero);
+
+		__m128 mass = _mm_loadu_ps(&states.m_masses[i]);
+		__m128 inverseMass = _mm_div_ps(one, mass);
+		__m128 positionX, positionY, positionZ;
+		__m128 velocityX, velocityY, velocityZ;
+		__m128 oldAccelerationX, oldAccelerationY, oldAccelerationZ;
+		__m128 angularVelocityX, angularVelocityY, angularVelocityZ;
+		__m128 oldAngularAccelerationX, oldAngularAccelerationY, oldAngularAccelerationZ;
+		LoadVec3x4(&states.m_positions[i], positionX, positionY, positionZ);
+		LoadVec3x4(&states.m_velocities[i], velocityX, velocityY, velocityZ);
+		LoadVec3x4(&states.m_accelerations[i], oldAccelerationX, oldAccelerationY, oldAccelerationZ);
+		LoadVec3x4(&states.m_angularVelocities[i], angularVelocityX, angularVelocityY, angularVelocityZ);
+		LoadVec3x4(&states.m_angularAccelerations[i], oldAngularAccelerationX, oldAngularAccelerationY, oldAngularAccelerationZ);
+
+		// Gravity, drag, Magnus
+		__m128 zeroForce = _mm_mul_ps(_mm_mul_ps(zero, mass), inverseMass);
+		__m128 accelerationX = _mm_add_ps(oldAccelerationX, zeroForce);
+		__m128 accelerationY = _mm_add_ps(oldAccelerationY, zeroForce);
+		bool const* isGravityEnabled = &states.m_isGravityEnabled[i];
+		__m128 gravity = _mm_set_ps(isGravityEnabled[3] ? MODIFIED_GRAVITY_RATE : 0.f, isGravityEnabled[2] ? MODIFIED_GRAVITY_RATE : 0.f,
+			isGravityEnabled[1] ? MODIFIED_GRAVITY_RATE : 0.f, isGravityEnabled[0] ? MODIFIED_GRAVITY_RATE : 0.f);
+		__m128 accelerationZ = _mm_add_ps(oldAccelerationZ, _mm_mul_ps(_mm_mul_ps(gravity, mass), inverseMass));
+		__m128 negativeDrag = _mm_sub_ps(zero, _mm_loadu_ps(&states.m_drags[i]));
+		accelerationX = _mm_add_ps(accelerationX, _mm_mul_ps(_mm_mul_ps(velocityX, negativeDrag), inverseMass));
+		accelerationY = _mm_add_ps(accelerationY, _mm_mul_ps(_mm_mul_ps(velocityY, negativeDrag), inverseMass));
+		accelerationZ = _mm_add_ps(accelerationZ, _mm_mul_ps(_mm_mul_ps(velocityZ, negativeDrag), inverseMass));
+
+		__m128 negativeInertia = _mm_sub_ps(zero, _mm_loadu_ps(&states.m_inertias[i]));
+		__m128 angularAccelerationX = _mm_add_ps(oldAngularAccelerationX, _mm_mul_ps(angularVelocityX, negativeInertia));
+		__m128 angularAccelerationY = _mm_add_ps(oldAngularAccelerationY, _mm_mul_ps(angularVelocityY, negativeInertia));
+		__m128 angularAccelerationZ = _mm_add_ps(oldAngularAccelerationZ, _mm_mul_ps(angularVelocityZ, negativeInertia));
+
+		__m128 crossX = _mm_sub_ps(_mm_mul_ps(angularVelocityY, velocityZ), _mm_mul_ps(angularVelocityZ, velocityY));
+		__m128 crossY = _mm_sub_ps(zero, _mm_sub_ps(_mm_mul_ps(angularVelocityX, velocityZ), _mm_mul_ps(angularVelocityZ, velocityX)));
+		__m128 crossZ = _mm_sub_ps(_mm_mul_ps(angularVelocityX, velocityY), _mm_mul_ps(angularVelocityY, velocityX));
+		accelerationX = _mm_add_ps(accelerationX, _mm_mul_ps(_mm_mul_ps(crossX, magnus), inverseMass));
+		accelerationY = _mm_add_ps(accelerationY, _mm_mul_ps(_mm_mul_ps(crossY, magnus), inverseMass));
+		accelerationZ = _mm_add_ps(accelerationZ, _mm_mul_ps(_mm_mul_ps(crossZ, magnus), inverseMass));
+
+		__m128 newAngularVelocityX = _mm_add_ps(angularVelocityX, _mm_mul_ps(angularAccelerationX, deltaSeconds));
+		__m128 newAngularVelocityY = _mm_add_ps(angularVelocityY, _mm_mul_ps(angularAccelerationY, deltaSeconds));
+		__m128 newAngularVelocityZ = _mm_add_ps(angularVelocityZ, _mm_mul_ps(angularAccelerationZ, deltaSeconds));
+
+		// Quaternions are already one register per ball, transpose them to one register per component
+		__m128 oldRotationI = _mm_loadu_ps(&states.m_rotations[i + 0].i);
+		__m128 oldRotationJ = _mm_loadu_ps(&states.m_rotations[i + 1].i);
+		__m128 oldRotationK = _mm_loadu_ps(&states.m_rotations[i + 2].i);
+		__m128 oldRotationW = _mm_loadu_ps(&states.m_rotations[i + 3].i);
+		_MM_TRANSPOSE4_PS(oldRotationI, oldRotationJ, oldRotationK, oldRotationW);
+		__m128 rotationI = oldRotationI;
+		__m128 rotationJ = oldRotationJ;
+		__m128 rotationK = oldRotationK;
+		__m128 rotationW = oldRotationW;
+		__m128 spinW = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(zero, rotationW), _mm_mul_ps(newAngularVelocityX, rotationI)), _mm_mul_ps(newAngularVelocityY, rotationJ)), _mm_mul_ps(newAngularVelocityZ, rotationK));
+		__m128 spinI = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(zero, rotationI), _mm_mul_ps(newAngularVelocityX, rotationW)), _mm_mul_ps(newAngularVelocityY, rotationK)), _mm_mul_ps(newAngularVelocityZ, rotationJ));
+		__m128 spinJ = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(zero, rotationJ), _mm_mul_ps(newAngularVelocityY, rotationW)), _mm_mul_ps(newAngularVelocityZ, rotationI)), _mm_mul_ps(newAngularVelocityX, rotationK));
+		__m128 spinK = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(zero, rotationK), _mm_mul_ps(newAngularVelocityZ, rotationW)), _mm_mul_ps(newAngularVelocityX, rotationJ)), _mm_mul_ps(newAngularVelocityY, rotationI));
+		rotationI = _mm_add_ps(rotationI, _mm_mul_ps(_mm_mul_ps(spinI, half), deltaSeconds));
+		rotationJ = _mm_add_ps(rotationJ, _mm_mul_ps(_mm_mul_ps(spinJ, half), deltaSeconds));
+		rotationK = _mm_add_ps(rotationK, _mm_mul_ps(_mm_mul_ps(spinK, half), deltaSeconds));
+		rotationW = _mm_add_ps(rotationW, _mm_mul_ps(_mm_mul_ps(spinW, half), deltaSeconds));
+
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rotationI, rotationI), _mm_mul_ps(rotationJ, rotationJ)), _mm_mul_ps(rotationK, rotationK)), _mm_mul_ps(rotationW, rotationW));
+		__m128 oneOverLength = Select(_mm_cmpneq_ps(lengthSquared, one), _mm_div_ps(one, _mm_sqrt_ps(lengthSquared)), one);
+		rotationI = Select(isActive, _mm_mul_ps(rotationI, oneOverLength), oldRotationI);
+		rotationJ = Select(isActive, _mm_mul_ps(rotationJ, oneOverLength), oldRotationJ);
+		rotationK = Select(isActive, _mm_mul_ps(rotationK, oneOverLength), oldRotationK);
+		rotationW = Select(isActive, _mm_mul_ps(rotationW, oneOverLength), oldRotationW);
+		_MM_TRANSPOSE4_PS(rotationI, rotationJ, rotationK, rotationW);
+		_mm_storeu_ps(&states.m_rotations[i + 0].i, rotationI);
+		_mm_storeu_ps(&states.m_rotations[i + 1].i, rotationJ);
+		_mm_storeu_ps(&states.m_rotations[i + 2].i, rotationK);
+		_mm_storeu_ps(&states.m_rotations[i + 3].i, rotationW);
+
+		__m128 newVelocityX = _mm_add_ps(velocityX, _mm_mul_ps(accelerationX, deltaSeconds));
+		__m128 newVelocityY = _mm_add_ps(velocityY, _mm_mul_ps(accelerationY, deltaSeconds));
+		__m128 newVelocityZ = _mm_add_ps(velocityZ, _mm_mul_ps(accelerationZ, deltaSeconds));
+		StoreVec3x4(&states.m_positions[i],
+			Select(isActive, _mm_add_ps(positionX, _mm_mul_ps(newVelocityX, deltaSeconds)), positionX),
+			Select(isActive, _mm_add_ps(positionY, _mm_mul_ps(newVelocityY, deltaSeconds)), positionY),
+			Select(isActive, _mm_add_ps(positionZ, _mm_mul_ps(newVelocityZ, deltaSeconds)), positionZ));
+		StoreVec3x4(&states.m_velocities[i], Select(isActive, newVelocityX, velocityX), Select(isActive, newVelocityY, velocityY), Select(isActive, newVelocityZ, velocityZ));
+		StoreVec3x4(&states.m_angularVelocities[i], Select(isActive, newAngularVelocityX, angularVelocityX),
+			Select(isActive, newAngularVelocityY, angularVelocityY), Select(isActive, newAngularVelocityZ, angularVelocityZ));
+		StoreVec3x4(&states.m_accelerations[i], _mm_andnot_ps(isActive, oldAccelerationX), _mm_andnot_ps(isActive, oldAccelerationY), _mm_andnot_ps(isActive, oldAccelerationZ));
+		StoreVec3x4(&states.m_angularAccelerations[i], _mm_andnot_ps(isActive, oldAngularAccelerationX),
+			_mm_andnot_ps(isActive, oldAngularAccelerationY), _mm_andnot_ps(isActive, oldAngularAccelerationZ));
+	}
+}
+
+// Vec3::operator== has a tolerance, the smallest push has to wake a ball
+static bool IsExactlyZero(Vec3 const& vec)
+{
+	return vec.x == 0.f && vec.y == 0.f && vec.z == 0.f;
+}
+
+void UpdateBallSleepTimers(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds)
+{
+	if (end > states.m_capacity)
+	{
+		end = states.m_capacity;
+	}
+
+	float const maxLinearSpeedSquared = BALL_SLEEP_LINEAR_SPEED * BALL_SLEEP_LINEAR_SPEED;
+	float const maxAngularSpeedSquared = BALL_SLEEP_ANGULAR_SPEED * BALL_SLEEP_ANGULAR_SPEED;
+	for (int i = begin; i < end; i++)
+	{
+		// Held balls and empty slots count as awake, so a thrown ball starts with a fresh timer
+		if (!states.m_isSimulatingPhysics[i])
+		{
+			states.m_isAwake[i] = true;
+			states.m_sleepSeconds[i] = 0.f;
+			continue;
+		}
+
+		// Sleeping balls were zeroed when they fell asleep, anything nonzero came from outside
+		if (!states.m_isAwake[i])
+		{
+			if (!IsExactlyZero(states.m_velocities[i]) || !IsExactlyZero(states.m_angularVelocities[i])
+				|| !IsExactlyZero(states.m_accelerations[i]) || !IsExactlyZero(states.m_angularAccelerations[i]))
+			{
+				states.m_isAwake[i] = true;
+				states.m_sleepSeconds[i] = 0.f;
+			}
+			continue;
+		}
+
+		if (states.m_velocities[i].GetLengthSquared() < maxLinearSpeedSquared && states.m_angularVelocities[i].GetLengthSquared() < maxAngularSpeedSquared)
+		{
+			states.m_sleepSeconds[i] += fixedDeltaSeconds;
+		}
+		else
+		{
+			states.m_sleepSeconds[i] = 0.f;
+		}
+	}
+}
+
+void PutBallToSleep(BallStateArrays& states, int slot)
+{
+	states.m_isAwake[slot] = false;
+	states.m_velocities[slot] = Vec3::ZERO;
+	states.m_angularVelocities[slot] = Vec3::ZERO;
+	states.m_accelerations[slot] = Vec3::ZERO;
+	states.m_angularAccelerations[slot] = Vec3::ZERO;
+}
+
+//------------------------------------------------------------------------------------------------
+// Far enough that no ray reaches it, near enough that squaring the distance stays finite
+constexpr float BALL_RAY_PADDING_COORDINATE = 1.0e18f;
+
+void BallRayBatch::Clear()
+{
+	m_xs.clear();
+	m_ys.clear();
+	m_zs.clear();
+	m_ballIndices.clear();
+	m_tileBounds.clear();
+	m_numCenters = 0;
+}
+
+void BallRayBatch::AddCenter(Vec3 const& center, int ballIndex)
+{
+	m_xs.push_back(center.x);
+	m_ys.push_back(center.y);
+	m_zs.push_back(center.z);
+	m_ballIndices.push_back(ballIndex);
+	m_numCenters++;
+}
+
+void BallRayBatch::Finish()
+{
+	int numTiles = (m_numCenters + BALL_RAY_TILE_SIZE - 1) / BALL_RAY_TILE_SIZE;
+	int paddedSize = numTiles * BALL_RAY_TILE_SIZE;
+	m_xs.resize(paddedSize, BALL_RAY_PADDING_COORDINATE);
+	m_ys.resize(paddedSize, BALL_RAY_PADDING_COORDINATE);
+	m_zs.resize(paddedSize, BALL_RAY_PADDING_COORDINATE);
+	m_ballIndices.resize(paddedSize, INT_MAX);
+
+	m_tileBounds.resize(numTiles);
+	for (int tileIndex = 0; tileIndex < numTiles; tileIndex++)
+	{
+		int first = tileIndex * BALL_RAY_TILE_SIZE;
+		int last = first + BALL_RAY_TILE_SIZE < m_numCenters ? first + BALL_RAY_TILE_SIZE : m_numCenters;
+		Vec3 mins = Vec3(m_xs[first], m_ys[first], m_zs[first]);
+		Vec3 maxs = mins;
+		for (int i = first + 1; i < last; i++)
+		{
+			mins = Vec3(fminf(mins.x, m_xs[i]), fminf(mins.y, m_ys[i]), fminf(mins.z, m_zs[i]));
+			maxs = Vec3(fmaxf(maxs.x, m_xs[i]), fmaxf(maxs.y, m_ys[i]), fmaxf(maxs.z, m_zs[i]));
+		}
+		m_tileBounds[tileIndex] = AABB3(mins, maxs);
+	}
+}
+
+// Same operations in the same order as RaycastVsSphere3D, returns -1 for a miss
+static float GetRayVsSphereDistance(Vec3 const& startPos, Vec3 const& fwdNormal, float maxDist, float centerX, float centerY, float centerZ, float sphereRadius)
+{
+	float toCenterX = centerX - startPos.x;
+	float toCenterY = centerY - startPos.y;
+	float toCenterZ = centerZ - startPos.z;
+	float radiusSquared = sphereRadius * sphereRadius;
+	if ((toCenterX * toCenterX) + (toCenterY * toCenterY) + (toCenterZ * toCenterZ) <= radiusSquared)
+	{
+		return 0.f;
+	}
+
+	float SCiLength = (toCenterX * fwdNormal.x) + (toCenterY * fwdNormal.y) + (toCenterZ * fwdNormal.z);
+	float SCjkX = toCenterX - fwdNormal.x * SCiLength;
+	float SCjkY = toCenterY - fwdNormal.y * SCiLength;
+	float SCjkZ = toCenterZ - fwdNormal.z * SCiLength;
+	float SCjkLengthSquared = (SCjkX * SCjkX) + (SCjkY * SCjkY) + (SCjkZ * SCjkZ);
+	if (SCjkLengthSquared >= radiusSquared)
+	{
+		return -1.f;
+	}
+	float distance = SCiLength - sqrtf(radiusSquared - SCjkLengthSquared);
+	if (distance >= maxDist || distance <= 0.f)
+	{
+		return -1.f;
+	}
+	return distance;
+}
+
+// Distance along the ray to where it enters the box grown by margin, -1 when it misses that box before
+// maxDist. Axes the ray doesn't move along have a oneOverDirection of 0 and only check the start
+static float GetRayEntryDistance(float const* starts, float const* oneOverDirections, float maxDist, AABB3 const& box, float margin)
+{
+	float const mins[3] = { box.m_mins.x - margin, box.m_mins.y - margin, box.m_mins.z - margin };
+	float const maxs[3] = { box.m_maxs.x + margin, box.m_maxs.y + margin, box.m_maxs.z + margin };
+	float entry = 0.f;
+	float exit = maxDist;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (oneOverDirections[axis] == 0.f)
+		{
+			if (starts[axis] < mins[axis] || starts[axis] > maxs[axis])
+			{
+				return -1.f;
+			}
+			continue;
+		}
+		float slabEntry = (mins[axis] - starts[axis]) * oneOverDirections[axis];
+		float slabExit = (maxs[axis] - starts[axis]) * oneOverDirections[axis];
+		if (slabEntry > slabExit)
+		{
+			float swap = slabEntry;
+			slabEntry = slabExit;
+			slabExit = swap;
+		}
+		entry = slabEntry > entry ? slabEntry : entry;
+		exit = slabExit < exit ? slabExit : exit;
+	}
+	return entry <= exit ? entry : -1.f;
+}
+
+BallRayHit RaycastVsBallRayBatchScalar(BallRayBatch const& batch, Vec3 const& startPos, Vec3 const& fwdNormal, float maxDist, float sphereRadius)
+{
+	BallRayHit hit;
+	for (int i = 0; i < batch.m_numCenters; i++)
+	{
+		float distance = GetRayVsSphereDistance(startPos, fwdNormal, maxDist, batch.m_xs[i], batch.m_ys[i], batch.m_zs[i], sphereRadius);
+		if (distance < 0.f)
+		{
+			continue;
+		}
+		if (hit.m_ballIndex < 0 || distance < hit.m_distance || (distance == hit.m_distance && batch.m_ballIndices[i] < hit.m_ballIndex))
+		{
+			hit.m_ballIndex = batch.m_ballIndices[i];
+			hit.m_distance = distance;
+		}
+	}
+	return hit;
+}
+
+BallRayHit RaycastVsBallRayBatchSIMD(BallRayBatch const& batch, Vec3 const& startPos, Vec3 const& fwdNormal, float maxDist, float sphereRadius)
+{
+	__m128 const startX = _mm_set1_ps(startPos.x);
+	__m128 const startY = _mm_set1_ps(startPos.y);
+	__m128 const startZ = _mm_set1_ps(startPos.z);
+	__m128 const fwdX = _mm_set1_ps(fwdNormal.x);
+	__m128 const fwdY = _mm_set1_ps(fwdNormal.y);
+	__m128 const fwdZ = _mm_set1_ps(fwdNormal.z);
+	__m128 const radiusSquared = _mm_set1_ps(sphereRadius * sphereRadius);
+	__m128 const maxDistance = _mm_set1_ps(maxDist);
+	__m128 const zero = _mm_setzero_ps();
+
+	// Every lane keeps its own best, they are compared once at the end
+	__m128 bestDistances = _mm_set1_ps(FLT_MAX);
+	__m128i bestIndices = _mm_set1_epi32(INT_MAX);
+	float bestDistance = FLT_MAX;
+
+	// The tile bounds hold the centers, grow them by the radius to hold the spheres. The small extra keeps
+	// rounding in the entry distance from skipping a tile whose hit ties the best so far
+	float const starts[3] = { startPos.x, startPos.y, startPos.z };
+	float const oneOverDirections[3] = {
+		fwdNormal.x != 0.f ? 1.f / fwdNormal.x : 0.f,
+		fwdNormal.y != 0.f ? 1.f / fwdNormal.y : 0.f,
+		fwdNormal.z != 0.f ? 1.f / fwdNormal.z : 0.f };
+	float tileMargin = sphereRadius * 1.001f + 0.001f;
+	int numTiles = (int)batch.m_tileBounds.size();
+	for (int tileIndex = 0; tileIndex < numTiles; tileIndex++)
+	{
+		float entryDistance = GetRayEntryDistance(starts, oneOverDirections, maxDist, batch.m_tileBounds[tileIndex], tileMargin);
+		if (entryDistance < 0.f || entryDistance > bestDistance)
+		{
+			continue;
+		}
+
+		int tileStart = tileIndex * BALL_RAY_TILE_SIZE;
+		for (int i = tileStart; i < tileStart + BALL_RAY_TILE_SIZE; i += BALL_SIMD_WIDTH)
+		{
+			__m128 toCenterX = _mm_sub_ps(_mm_loadu_ps(&batch.m_xs[i]), startX);
+			__m128 toCenterY = _mm_sub_ps(_mm_loadu_ps(&batch.m_ys[i]), startY);
+			__m128 toCenterZ = _mm_sub_ps(_mm_loadu_ps(&batch.m_zs[i]), startZ);
+			__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, toCenterX), _mm_mul_ps(toCenterY, toCenterY)), _mm_mul_ps(toCenterZ, toCenterZ));
+			__m128 isInside = _mm_cmple_ps(distanceSquared, radiusSquared);
+
+			__m128 SCiLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, fwdX), _mm_mul_ps(toCenterY, fwdY)), _mm_mul_ps(toCenterZ, fwdZ));
+			__m128 SCjkX = _mm_sub_ps(toCenterX, _mm_mul_ps(fwdX, SCiLength));
+			__m128 SCjkY = _mm_sub_ps(toCenterY, _mm_mul_ps(fwdY, SCiLength));
+			__m128 SCjkZ = _mm_sub_ps(toCenterZ, _mm_mul_ps(fwdZ, SCiLength));
+			__m128 SCjkLengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(SCjkX, SCjkX), _mm_mul_ps(SCjkY, SCjkY)), _mm_mul_ps(SCjkZ, SCjkZ));
+			__m128 isNearLine = _mm_cmplt_ps(SCjkLengthSquared, radiusSquared);
+
+			// Lanes that miss the line take the square root of a negative number, the masks drop them
+			__m128 distance = _mm_sub_ps(SCiLength, _mm_sqrt_ps(_mm_sub_ps(radiusSquared, SCjkLengthSquared)));
+			__m128 isInRange = _mm_and_ps(_mm_cmplt_ps(distance, maxDistance), _mm_cmpgt_ps(distance, zero));
+			__m128 isHit = _mm_or_ps(isInside, _mm_and_ps(isNearLine, isInRange));
+			distance = _mm_andnot_ps(isInside, distance);
+
+			__m128i indices = _mm_loadu_si128((__m128i const*)&batch.m_ballIndices[i]);
+			__m128 isCloser = _mm_cmplt_ps(distance, bestDistances);
+			__m128 isTiedLower = _mm_and_ps(_mm_cmpeq_ps(distance, bestDistances), _mm_castsi128_ps(_mm_cmplt_epi32(indices, bestIndices)));
+			__m128 isBetter = _mm_and_ps(isHit, _mm_or_ps(isCloser, isTiedLower));
+			bestDistances = Select(isBetter, distance, bestDistances);
+			bestIndices = _mm_castps_si128(Select(isBetter, _mm_castsi128_ps(indices), _mm_castsi128_ps(bestIndices)));
+		}
+
+		float laneDistances[BALL_SIMD_WIDTH];
+		_mm_storeu_ps(laneDistances, bestDistances);
+		for (int lane = 0; lane < BALL_SIMD_WIDTH; lane++)
+		{
+			bestDistance = laneDistances[lane] < bestDistance ? laneDistances[lane] : bestDistance;
+		}
+	}
+
+	float laneDistances[BALL_SIMD_WIDTH];
+	int laneIndices[BALL_SIMD_WIDTH];
+	_mm_storeu_ps(laneDistances, bestDistances);
+	_mm_storeu_si128((__m128i*)laneIndices, bestIndices);
+	BallRayHit hit;
+	for (int lane = 0; lane < BALL_SIMD_WIDTH; lane++)
+	{
+		if (laneIndices[lane] == INT_MAX)
+		{
+			continue;
+		}
+		if (hit.m_ballIndex < 0 || laneDistances[lane] < hit.m_distance || (laneDistances[lane] == hit.m_distance && laneIndices[lane] < hit.m_ballIndex))
+		{
+			hit.m_ballIndex = laneIndices[lane];
+			hit.m_distance = laneDistances[lane];
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/AABB3.hpp"
+
+constexpr int BALL_SIMD_WIDTH = 4;
+constexpr int BALL_RAY_TILE_SIZE = 16; // multiple of BALL_SIMD_WIDTH
+
+// Motion state of every ball, one array per field, indexed by the ball's slot in the court's m_balls.
+// Each Ball binds its Entity state to its slot, so these arrays are the only copy and the
+// integration kernels stream them without touching Ball objects. The capacity is fixed so the
+// addresses Balls hold never move; it is rounded up to a multiple of BALL_SIMD_WIDTH.
+struct BallStateArrays
+{
+	explicit BallStateArrays(int capacity);
+	~BallStateArrays();
+	BallStateArrays(BallStateArrays const& copy) = delete;
+
+	void ResetSlot(int slot);
+
+	int m_capacity = 0;
+	Vec3* m_positions = nullptr;
+	Vec3* m_velocities = nullptr;
+	Vec3* m_accelerations = nullptr;
+	Vec3* m_angularVelocities = nullptr;
+	Vec3* m_angularAccelerations = nullptr;
+	Quaternion* m_rotations = nullptr;
+
+	// The Ball's m_mass, m_drag, m_inertia and m_isGravityEnabled are bound to these too, so changing
+	// them on the Ball changes what the kernels integrate
+	float* m_masses = nullptr;
+	float* m_drags = nullptr;
+	float* m_inertias = nullptr;
+	bool* m_isGravityEnabled = nullptr;
+
+	// False for empty slots and for balls the player is holding
+	bool* m_isSimulatingPhysics = nullptr;
+
+	// Sleeping balls are skipped by integration and by the court narrowphase. m_sleepSeconds is how long
+	// the ball has stayed under the sleep speeds, sleeping balls keep the value they fell asleep with
+	bool* m_isAwake = nullptr;
+	float* m_sleepSeconds = nullptr;
+};
+
+// [begin, end) are slots; the SIMD kernel needs begin to be a multiple of BALL_SIMD_WIDTH.
+// Both produce exactly what Ball::UpdatePhysics would for every simulating slot.
+void IntegrateBallStatesScalar(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds);
+void IntegrateBallStatesSIMD(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds);
+
+// Runs after integration. Awake balls under BALL_SLEEP_LINEAR_SPEED and BALL_SLEEP_ANGULAR_SPEED add to
+// m_sleepSeconds, faster ones reset it. Sleeping balls wake as soon as anything has given them motion,
+// an impulse, a force or a collision response. Falling asleep is left to the court, per contact island.
+void UpdateBallSleepTimers(BallStateArrays& states, int begin, int end, float fixedDeltaSeconds);
+void PutBallToSleep(BallStateArrays& states, int slot);
+
+// Ball centers packed for ray queries, one array per component and padded to whole tiles, plus the bounds
+// of every tile of BALL_RAY_TILE_SIZE centers so a ray can skip the tiles it can't reach. Centers are
+// added in any order, each with its ball's dense index; padding sits too far away for any ray to reach.
+struct BallRayBatch
+{
+	void Clear();
+	void AddCenter(Vec3 const& center, int ballIndex);
+	// Pads the last tile and computes the tile bounds, call it after the last AddCenter
+	void Finish();
+
+	std::vector<float> m_xs;
+	std::vector<float> m_ys;
+	std::vector<float> m_zs;
+	std::vector<int> m_ballIndices;
+	std::vector<AABB3> m_tileBounds;
+	int m_numCenters = 0;
+};
+
+struct BallRayHit
+{
+	int m_ballIndex = -1;
+	float m_distance = 0.f;
+};
+
+// The closest sphere of the given radius around any center that the ray hits, by the rules of
+// RaycastVsSphere3D: a ray starting inside a sphere hits it at 0. Equal distances go to the lower ball
+// index, so both agree with testing every ball in dense order. The SIMD version tests four centers per
+// iteration and skips tiles that can't hold a hit closer than the best so far.
+BallRayHit RaycastVsBallRayBatchScalar(BallRayBatch const& batch, Vec3 const& startPos, Vec3 const& fwdNormal, float maxDist, float sphereRadius);
+BallRayHit RaycastVsBallRayBatchSIMD(BallRayBatch const& batch, Vec3 const& startPos, Vec3 const& fwdNormal, float maxDist, float sphereRadius);
@@ -0,0 +1,100 @@
+#include "Game/BallSlotMap.hpp"
+#include "Game/Ball.hpp"
+
+BallSlotMap::BallSlotMap(int capacity)
+{
+	// Reserved up front so inserting never reallocates
+	m_slots.resize(capacity);
+	m_balls.reserve(capacity);
+}
+
+int BallSlotMap::AllocateSlot()
+{
+	int slot = -1;
+	if (m_freeList >= 0)
+	{
+		slot = m_freeList;
+		m_freeList = m_slots[slot].m_nextFree;
+	}
+	else if (m_numSlotsUsed < (int)m_slots.size())
+	{
+		slot = m_numSlotsUsed++;
+	}
+	else
+	{
+		return -1;
+	}
+	m_slots[slot].m_nextFree = -1;
+	return slot;
+}
+
+BallHandle BallSlotMap::Insert(Ball* ball)
+{
+	int slot = ball->m_stateIndex;
+	GUARANTEE_OR_DIE(slot >= 0 && slot < m_numSlotsUsed && m_slots[slot].m_denseIndex < 0, "Inserting a ball whose slot was not allocated");
+	m_slots[slot].m_denseIndex = (int)m_balls.size();
+	m_balls.push_back(ball);
+
+	BallHandle handle;
+	handle.m_slot = slot;
+	handle.m_generation = m_slots[slot].m_generation;
+	return handle;
+}
+
+void BallSlotMap::Remove(Ball* ball)
+{
+	int slot = ball->m_stateIndex;
+	GUARANTEE_OR_DIE(slot >= 0 && slot < m_numSlotsUsed && m_slots[slot].m_denseIndex >= 0 && m_balls[m_slots[slot].m_denseIndex] == ball, "Removing a ball that is not in the slot map");
+
+	int denseIndex = m_slots[slot].m_denseIndex;
+	Ball* lastBall = m_balls.back();
+	m_balls[denseIndex] = lastBall;
+	m_slots[lastBall->m_stateIndex].m_denseIndex = denseIndex;
+	m_balls.pop_back();
+
+	m_slots[slot].m_denseIndex = -1;
+	m_slots[slot].m_generation++;
+	m_slots[slot].m_nextFree = m_freeList;
+	m_freeList = slot;
+}
+
+void BallSlotMap::Clear()
+{
+	for (int slot = 0; slot < m_numSlotsUsed; slot++)
+	{
+		if (m_slots[slot].m_denseIndex >= 0)
+		{
+			m_slots[slot].m_generation++;
+		}
+		m_slots[slot].m_denseIndex = -1;
+		m_slots[slot].m_nextFree = -1;
+	}
+	m_balls.clear();
+	m_freeList = -1;
+	m_numSlotsUsed = 0;
+}
+
+Ball* BallSlotMap::Get(BallHandle handle) const
+{
+	if (handle.m_slot < 0 || handle.m_slot >= m_numSlotsUsed)
+	{
+		return nullptr;
+	}
+	Slot const& slot = m_slots[handle.m_slot];
+	if (slot.m_generation != handle.m_generation || slot.m_denseIndex < 0)
+	{
+		return nullptr;
+	}
+	return m_balls[slot.m_denseIndex];
+}
+
+BallHandle BallSlotMap::GetHandle(Ball const* ball) const
+{
+	BallHandle handle;
+	if (ball)
+	{
+		handle.m_slot = ball->m_stateIndex;
+		handle.m_generation = m_slots[ball->m_stateIndex].m_generation;
+	}
+	return handle;
+}
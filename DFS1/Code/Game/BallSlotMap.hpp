@@ -0,0 +1,52 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+
+class Ball;
+
+// Refers to a ball without owning it. Once the ball is destroyed the handle stops resolving, even after
+// a new ball has taken the same slot
+struct BallHandle
+{
+	int m_slot = -1;
+	unsigned int m_generation = 0;
+};
+
+// The court's live balls. Each ball keeps one slot for its lifetime, the same index its motion state
+// uses in m_ballStates, and the live balls are also packed densely so loops visit only balls that exist.
+// Removing a ball moves the last live ball into its place, so dense order is not creation order.
+class BallSlotMap
+{
+public:
+	explicit BallSlotMap(int capacity);
+
+	// Reserves the slot the next ball has to be constructed with, -1 when every slot is taken
+	int AllocateSlot();
+	// ball->m_stateIndex has to be a slot from AllocateSlot
+	BallHandle Insert(Ball* ball);
+	// Doesn't delete the ball. Its slot goes back on the free list and handles to it stop resolving
+	void Remove(Ball* ball);
+	void Clear();
+
+	// Null when the handle's ball has been removed
+	Ball* Get(BallHandle handle) const;
+	BallHandle GetHandle(Ball const* ball) const;
+
+	Ball* operator[](int denseIndex) const { return m_balls[denseIndex]; }
+	int GetNumBalls() const { return (int)m_balls.size(); }
+	// Every live ball's slot is below this, so slot-indexed passes can stop here
+	int GetNumSlotsUsed() const { return m_numSlotsUsed; }
+	int GetCapacity() const { return (int)m_slots.size(); }
+
+private:
+	struct Slot
+	{
+		unsigned int m_generation = 1;
+		int m_denseIndex = -1; // -1 while free or reserved
+		int m_nextFree = -1;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<Ball*> m_balls;
+	int m_freeList = -1;
+	int m_numSlotsUsed = 0;
+};
@@ -4,23 +4,63 @@
 #include "Game/Entity.hpp"
 #include "Game/Prop.hpp"
 #include "Game/Blocker.hpp"
-
-BasketballCourt::BasketballCourt()
+#include "Game/ShotSolver.hpp"
+#include <algorithm>
+
+BasketballCourt::BasketballCourt(int ballCapacity /*= MAX_BALLS*/)
+	:m_balls(ballCapacity < MAX_BALLS ? ballCapacity : MAX_BALLS)
+	,m_ballStates(ballCapacity < MAX_BALLS ? ballCapacity : MAX_BALLS)
+	,m_ballPool(BALL_POOL_PAGE_SIZE)
+	,m_propPool(COURT_POOL_PAGE_SIZE)
+	,m_playerPool(1)
+	,m_blockerPool(COURT_POOL_PAGE_SIZE)
 {
 	m_gameFloor = Plane3(Vec3(0.f, 0.f, 1.f), 0.f);
 	m_northWall = Plane3(Vec3(0.f, 1.f, 0.f), 50.f);
 	m_southWall = Plane3(Vec3(0.f, -1.f, 0.f), 50.f);
 	m_eastWall = Plane3(Vec3(1.f, 0.f, 0.f), 50.f);
 	m_westWall = Plane3(Vec3(-1.f, 0.f, 0.f), 50.f);
+	BuildStaticColliders();
 }
 
 BasketballCourt::~BasketballCourt()
 {
-
+	// Balls point into m_ballStates, so they have to go before it does. Everything else the court created
+	// goes with its pool
+	DeleteAllBalls();
+	m_entityList.clear();
+	m_blockerList.clear();
+	m_player = nullptr;
+	m_propPool.DestroyAll();
+	m_playerPool.DestroyAll();
+	m_blockerPool.DestroyAll();
+
+	delete m_hoopA;
+	m_hoopA = nullptr;
+	delete m_hoopB;
+	m_hoopB = nullptr;
+	delete m_ballMeshVBO;
+	m_ballMeshVBO = nullptr;
+	delete m_ballMeshIBO;
+	m_ballMeshIBO = nullptr;
+	delete m_ballInstanceVBO;
+	m_ballInstanceVBO = nullptr;
+	delete m_courtMesh;
+	m_courtMesh = nullptr;
+	delete m_skyboxMesh;
+	m_skyboxMesh = nullptr;
+	delete m_netMesh;
+	m_netMesh = nullptr;
 }
 
 void BasketballCourt::Startup()
 {
+	m_isPhysicsMultithreaded = g_gameConfigBlackboard.GetValue("multithreadedPhysics", true);
+	m_isBallSleepEnabled = g_gameConfigBlackboard.GetValue("ballSleep", true);
+	m_isContinuousCollisionEnabled = g_gameConfigBlackboard.GetValue("continuousCollision", true);
+	m_isRenderQueueSorted = g_gameConfigBlackboard.GetValue("sortRenderQueue", true);
+	m_isRenderRecordingParallel = g_gameConfigBlackboard.GetValue("parallelRenderRecording", true);
+	m_isFrustumCullingEnabled = g_gameConfigBlackboard.GetValue("frustumCulling", true);
 	InitializeCourt();
 
 	if (g_theGame->m_currentGameMode == CREATIVE)
@@ -42,16 +82,15 @@ void BasketballCourt::Startup()
 
 void BasketballCourt::Update(float deltaSeconds)
 {
+	// The player carries its ball around during Update
+	m_isBallRayBatchDirty = true;
 	for (size_t i = 0; i < m_entityList.size(); i++)
 	{
 		m_entityList[i]->Update(deltaSeconds);
 	}
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	for (int i = 0; i < m_balls.GetNumBalls(); i++)
 	{
-		if (m_ballList[i])
-		{
-			m_ballList[i]->Update(deltaSeconds);
-		}
+		m_balls[i]->Update(deltaSeconds);
 	}
 
 	if (g_theGame->m_currentGameMode == OBSTACLE)
@@ -67,6 +106,7 @@ void BasketballCourt::UpdatePhysics(float fixedDeltaSeconds)
 {
 	PlayerCollisionWithWorld();
 	BounceBallsCourt();
+	PlayPhysicsSoundEvents();
 	BounceBallsOffPlayer();
 	BounceBallsOffBalls();
 
@@ -75,52 +115,269 @@ void BasketballCourt::UpdatePhysics(float fixedDeltaSeconds)
 	{
 		m_entityList[i]->UpdatePhysics(fixedDeltaSeconds);
 	}
-	for (size_t i = 0; i < m_ballList.size(); i++)
+
+	// Integration only touches each ball's own slot in m_ballStates, so workers take it in chunks of
+	// whole SIMD groups. Scoring plays sounds and can delete balls, so it stays on this thread
+	int numBallSlots = (m_balls.GetNumSlotsUsed() + BALL_SIMD_WIDTH - 1) / BALL_SIMD_WIDTH * BALL_SIMD_WIDTH;
+	RunPhysicsPhase(numBallSlots, BALL_INTEGRATION_GRAIN, [this, fixedDeltaSeconds](int chunkIndex, int chunkBegin, int chunkEnd)
+		{
+			UNUSED(chunkIndex);
+			IntegrateBallStatesSIMD(m_ballStates, chunkBegin, chunkEnd, fixedDeltaSeconds);
+		});
+	// Blockers moved during Update, the sweep and the blocker bounce both query where they are now
+	if (!m_blockerList.empty())
+	{
+		UpdateBlockerTree();
+	}
+	if (m_isContinuousCollisionEnabled)
+	{
+		SweepFastBalls(fixedDeltaSeconds);
+	}
+	UpdateBallSleep(fixedDeltaSeconds);
+	// A score can clear the court, which deletes balls and reorders the ones left, so scoring stops there
+	int numBallsBeforeScoring = m_balls.GetNumBalls();
+	for (int i = 0; i < m_balls.GetNumBalls(); i++)
 	{
-		if (m_ballList[i])
+		Ball* ball = m_balls[i];
+		IsBallAScore(ball, m_hoopA);
+		if (m_balls.GetNumBalls() != numBallsBeforeScoring)
+		{
+			break;
+		}
+		IsBallAScore(ball, m_hoopB);
+		if (m_balls.GetNumBalls() != numBallsBeforeScoring)
 		{
-			m_ballList[i]->UpdatePhysics(fixedDeltaSeconds);
-			IsBallAScore(m_ballList[i], m_hoopA);
-			IsBallAScore(m_ballList[i], m_hoopB);
+			break;
 		}
 	}
 
-	if (g_theGame->m_currentGameMode == OBSTACLE)
+	// Blockers only exist in OBSTACLE mode, except in headless benchmark scenarios
+	if (!m_blockerList.empty())
 	{
 		BounceBallsOffBlockers();
+		PlayPhysicsSoundEvents();
 	}
+	m_isBallRayBatchDirty = true;
 }
 
 void BasketballCourt::Render() const
 {
 	g_theRenderer->BeginCamera(*m_player->GetCamera());
-	m_player->Render();
-	for (size_t i = 0; i < m_entityList.size(); i++)
+	if (m_isRenderRecordingParallel && g_theJobSystem)
+	{
+		BuildRenderQueueParallel(m_renderQueue, g_theJobSystem);
+	}
+	else
+	{
+		BuildRenderQueue(m_renderQueue);
+	}
+	m_renderQueueStats = m_renderQueue.Submit(g_theRenderer, m_isRenderQueueSorted);
+	g_theRenderer->EndCamera(*m_player->GetCamera());
+}
+
+void BasketballCourt::BuildRenderQueue(RenderQueue& queue) const
+{
+	queue.Clear();
+	BuildVisibility(*m_player->GetCamera(), nullptr, m_visibility);
+	m_player->Render(queue);
+	for (size_t i = 0; i < m_visibility.m_visibleEntities.size(); i++)
+	{
+		m_entityList[m_visibility.m_visibleEntities[i]]->Render(queue);
+	}
+	RenderBalls(queue);
+	for (size_t i = 0; i < m_visibility.m_visibleBlockers.size(); i++)
+	{
+		m_blockerList[m_visibility.m_visibleBlockers[i]]->Render(queue);
+	}
+
+	if (g_debugDrawing)
+	{
+		DebugAddWorldBasis();
+		DrawGrid(queue);
+	}
+
+	DrawCourt(queue);
+}
+
+void BasketballCourt::BuildRenderQueueParallel(RenderQueue& queue, JobSystem* jobSystem) const
+{
+	BuildVisibility(*m_player->GetCamera(), jobSystem, m_visibility);
+
+	// Entity and blocker tasks are ranges of the visible lists
+	m_renderRecordTasks.clear();
+	RenderRecordTask task;
+	task.m_piece = RenderRecordPiece::PLAYER;
+	m_renderRecordTasks.push_back(task);
+	int numVisibleEntities = (int)m_visibility.m_visibleEntities.size();
+	for (int begin = 0; begin < numVisibleEntities; begin += RENDER_RECORD_GRAIN)
+	{
+		task.m_piece = RenderRecordPiece::ENTITIES;
+		task.m_begin = begin;
+		task.m_end = begin + RENDER_RECORD_GRAIN < numVisibleEntities ? begin + RENDER_RECORD_GRAIN : numVisibleEntities;
+		m_renderRecordTasks.push_back(task);
+	}
+	task.m_piece = RenderRecordPiece::BALLS;
+	m_renderRecordTasks.push_back(task);
+	int numVisibleBlockers = (int)m_visibility.m_visibleBlockers.size();
+	for (int begin = 0; begin < numVisibleBlockers; begin += RENDER_RECORD_GRAIN)
+	{
+		task.m_piece = RenderRecordPiece::BLOCKERS;
+		task.m_begin = begin;
+		task.m_end = begin + RENDER_RECORD_GRAIN < numVisibleBlockers ? begin + RENDER_RECORD_GRAIN : numVisibleBlockers;
+		m_renderRecordTasks.push_back(task);
+	}
+	if (g_debugDrawing)
+	{
+		DebugAddWorldBasis();
+		task.m_piece = RenderRecordPiece::GRID;
+		m_renderRecordTasks.push_back(task);
+	}
+	task.m_piece = RenderRecordPiece::COURT;
+	m_renderRecordTasks.push_back(task);
+
+	UploadBallInstances();
+
+	// Queues are kept between frames so their arenas don't have to grow again
+	int numTasks = (int)m_renderRecordTasks.size();
+	if ((int)m_renderRecordQueues.size() < numTasks)
+	{
+		m_renderRecordQueues.resize(numTasks);
+	}
+	jobSystem->ParallelFor(0, numTasks, 1, [this](int taskIndex)
+		{
+			m_renderRecordQueues[taskIndex].Clear();
+			RecordRenderTask(m_renderRecordTasks[taskIndex], m_renderRecordQueues[taskIndex]);
+		});
+
+	queue.Clear();
+	for (int taskIndex = 0; taskIndex < numTasks; taskIndex++)
 	{
-		m_entityList[i]->Render();
+		queue.Append(m_renderRecordQueues[taskIndex]);
 	}
-	for (size_t i = 0; i < m_ballList.size(); i++)
+}
+
+void BasketballCourt::BuildVisibility(Camera const& camera, JobSystem* jobSystem, CourtVisibility& out_visibility) const
+{
+	double startTime = GetCurrentTimeSeconds();
+	out_visibility.m_numEntities = (int)m_entityList.size();
+	out_visibility.m_numBalls = m_balls.GetNumBalls();
+	out_visibility.m_numBlockers = g_theGame->m_currentGameMode == OBSTACLE ? (int)m_blockerList.size() : 0;
+	out_visibility.m_visibleEntities.clear();
+	out_visibility.m_visibleBalls.clear();
+	out_visibility.m_visibleBlockers.clear();
+
+	if (!m_isFrustumCullingEnabled)
 	{
-		if (m_ballList[i])
+		for (int i = 0; i < out_visibility.m_numEntities; i++)
+		{
+			out_visibility.m_visibleEntities.push_back(i);
+		}
+		for (int i = 0; i < out_visibility.m_numBalls; i++)
+		{
+			out_visibility.m_visibleBalls.push_back(i);
+		}
+		for (int i = 0; i < out_visibility.m_numBlockers; i++)
 		{
-			m_ballList[i]->Render();
+			out_visibility.m_visibleBlockers.push_back(i);
 		}
+		out_visibility.m_cullSeconds = GetCurrentTimeSeconds() - startTime;
+		return;
 	}
-	if (g_theGame->m_currentGameMode == OBSTACLE)
+
+	// Spheres go entities, then balls, then blockers, so the visible list splits back up in order
+	m_cullingSpheres.Clear();
+	for (int i = 0; i < out_visibility.m_numEntities; i++)
 	{
-		for (size_t i = 0; i < m_blockerList.size(); i++)
+		m_cullingSpheres.AddSphere(m_entityList[i]->m_position, m_entityList[i]->GetBoundingRadius());
+	}
+	for (int i = 0; i < out_visibility.m_numBalls; i++)
+	{
+		m_cullingSpheres.AddSphere(m_balls[i]->m_position, m_balls[i]->GetBoundingRadius());
+	}
+	for (int i = 0; i < out_visibility.m_numBlockers; i++)
+	{
+		m_cullingSpheres.AddSphere(m_blockerList[i]->m_position, m_blockerList[i]->GetBoundingRadius());
+	}
+	m_cullingSpheres.Finish();
+
+	BuildVisibleList(camera.GetWorldFrustum(), m_cullingSpheres, jobSystem, m_cullingScratch, m_visibleSpheres);
+	int firstBall = out_visibility.m_numEntities;
+	int firstBlocker = firstBall + out_visibility.m_numBalls;
+	for (size_t i = 0; i < m_visibleSpheres.size(); i++)
+	{
+		int sphereIndex = m_visibleSpheres[i];
+		if (sphereIndex < firstBall)
+		{
+			out_visibility.m_visibleEntities.push_back(sphereIndex);
+		}
+		else if (sphereIndex < firstBlocker)
+		{
+			out_visibility.m_visibleBalls.push_back(sphereIndex - firstBall);
+		}
+		else
 		{
-			m_blockerList[i]->Render();
+			out_visibility.m_visibleBlockers.push_back(sphereIndex - firstBlocker);
 		}
 	}
+	out_visibility.m_cullSeconds = GetCurrentTimeSeconds() - startTime;
+}
 
-	if (g_debugDrawing)
+int CourtVisibility::GetNumTested() const
+{
+	return m_numEntities + m_numBalls + m_numBlockers;
+}
+
+int CourtVisibility::GetNumVisible() const
+{
+	return (int)(m_visibleEntities.size() + m_visibleBalls.size() + m_visibleBlockers.size());
+}
+
+bool BasketballCourt::Command_CullingStats(EventArgs& args)
+{
+	UNUSED(args);
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
 	{
-		DrawGrid();
+		g_theDevConsole->AddLine(DevConsole::ERROR, "No court to report on");
+		return false;
 	}
+	CourtVisibility const& visibility = court->m_visibility;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Frustum culling last frame (%s): %d of %d objects drawn, %d culled, %.3f ms",
+		court->m_isFrustumCullingEnabled ? "on" : "off", visibility.GetNumVisible(), visibility.GetNumTested(), visibility.GetNumTested() - visibility.GetNumVisible(), visibility.m_cullSeconds * 1000.0));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  entities %d of %d, balls %d of %d, blockers %d of %d",
+		(int)visibility.m_visibleEntities.size(), visibility.m_numEntities, (int)visibility.m_visibleBalls.size(), visibility.m_numBalls, (int)visibility.m_visibleBlockers.size(), visibility.m_numBlockers));
+	return false;
+}
 
-	DrawCourt();
-	g_theRenderer->EndCamera(*m_player->GetCamera());
+void BasketballCourt::RecordRenderTask(RenderRecordTask const& task, RenderQueue& queue) const
+{
+	switch (task.m_piece)
+	{
+	case RenderRecordPiece::PLAYER:
+		m_player->Render(queue);
+		break;
+	case RenderRecordPiece::ENTITIES:
+		for (int i = task.m_begin; i < task.m_end; i++)
+		{
+			m_entityList[m_visibility.m_visibleEntities[i]]->Render(queue);
+		}
+		break;
+	case RenderRecordPiece::BALLS:
+		AddBallInstances(queue);
+		break;
+	case RenderRecordPiece::BLOCKERS:
+		for (int i = task.m_begin; i < task.m_end; i++)
+		{
+			m_blockerList[m_visibility.m_visibleBlockers[i]]->Render(queue);
+		}
+		break;
+	case RenderRecordPiece::GRID:
+		DrawGrid(queue);
+		break;
+	case RenderRecordPiece::COURT:
+		DrawCourt(queue);
+		break;
+	}
 }
 
 void BasketballCourt::Shutdown()
@@ -128,9 +385,58 @@ void BasketballCourt::Shutdown()
 
 }
 
+void BasketballCourt::RunPhysicsPhase(int count, int grain, std::function<void(int, int, int)> const& chunkFunction)
+{
+	int numChunks = (count + grain - 1) / grain;
+	if ((int)m_physicsSoundEventsByChunk.size() < numChunks)
+	{
+		m_physicsSoundEventsByChunk.resize(numChunks);
+	}
+
+	if (m_isPhysicsMultithreaded && g_theJobSystem)
+	{
+		g_theJobSystem->ParallelForRange(0, count, grain, [&chunkFunction, grain](int chunkBegin, int chunkEnd)
+			{
+				chunkFunction(chunkBegin / grain, chunkBegin, chunkEnd);
+			});
+		return;
+	}
+
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		int chunkBegin = chunkIndex * grain;
+		chunkFunction(chunkIndex, chunkBegin, chunkBegin + grain < count ? chunkBegin + grain : count);
+	}
+}
+
+std::vector<PhysicsSoundEvent>& BasketballCourt::GetPhysicsSoundEvents(int chunkIndex)
+{
+	return m_physicsSoundEventsByChunk[chunkIndex];
+}
+
+void BasketballCourt::PlayPhysicsSoundEvents()
+{
+	for (size_t chunkIndex = 0; chunkIndex < m_physicsSoundEventsByChunk.size(); chunkIndex++)
+	{
+		std::vector<PhysicsSoundEvent>& soundEvents = m_physicsSoundEventsByChunk[chunkIndex];
+		for (size_t eventIndex = 0; eventIndex < soundEvents.size(); eventIndex++)
+		{
+			if (soundEvents[eventIndex].m_ball)
+			{
+				soundEvents[eventIndex].m_ball->PlaySound(soundEvents[eventIndex].m_sound);
+			}
+			else if (soundEvents[eventIndex].m_blocker)
+			{
+				soundEvents[eventIndex].m_blocker->PlaySound(soundEvents[eventIndex].m_sound);
+			}
+		}
+		soundEvents.clear();
+	}
+}
+
 Prop* BasketballCourt::CreateProp(bool isGravityEnabled /*= false*/, float mass /*= 1.f*/, float height /*= 1.f*/, float radius /*= 1.f*/, Vec3 position /*= Vec3::ZERO*/, EulerAngles orientation /*= EulerAngles()*/)
 {
-	Prop* newProp = new Prop(this);
+	Prop* newProp = m_propPool.Create(this);
 	newProp->m_isGravityEnabled = isGravityEnabled;
 	newProp->m_position = position;
 	newProp->m_orientationDegrees = orientation;
@@ -143,27 +449,31 @@ Prop* BasketballCourt::CreateProp(bool isGravityEnabled /*= false*/, float mass
 
 Ball* BasketballCourt::CreateBall(Vec3 position /*= Vec3::ZERO*/, EulerAngles orientation /*= EulerAngles()*/)
 {
-	Ball* newBall = new Ball(this);
-	newBall->m_position = position;
-	newBall->m_rotation = orientation;
-	newBall->m_texture = g_theGame->m_ballTexture;
-
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	int slot = m_balls.AllocateSlot();
+	if (slot < 0 || slot >= m_ballStates.m_capacity)
 	{
-		if (m_ballList[i] == nullptr)
-		{
-			m_ballList[i] = newBall;
-			return newBall;
-		}
+		return nullptr;
 	}
 
-	m_ballList.push_back(newBall);
+	Ball* newBall = m_ballPool.Create(this, slot);
+	newBall->m_position = position;
+	newBall->m_rotation = orientation;
+	newBall->m_texture = g_theGame->m_ballTexture;
+	m_balls.Insert(newBall);
+	m_isBallRayBatchDirty = true;
 	return newBall;
 }
 
+void BasketballCourt::DestroyBall(Ball* ball)
+{
+	m_balls.Remove(ball);
+	m_ballPool.Destroy(ball);
+	m_isBallRayBatchDirty = true;
+}
+
 Player* BasketballCourt::CreatePlayer(Vec3 position /*= Vec3::ZERO*/, EulerAngles orientation /*= EulerAngles()*/)
 {
-	Player* player = new Player(this);
+	Player* player = m_playerPool.Create(this);
 	player->m_position = position;
 	player->m_orientationDegrees = orientation;
 	m_entityList.push_back(player);
@@ -172,30 +482,52 @@ Player* BasketballCourt::CreatePlayer(Vec3 position /*= Vec3::ZERO*/, EulerAngle
 
 Blocker* BasketballCourt::CreateBlocker(BlockerType type, Vec3 position, float width, float minHeight /*= 0*/, float maxHeight /*= 10*/, float time)
 {
-	Blocker* blocker = new Blocker(this, type, position, width, minHeight, maxHeight, time);
+	Blocker* blocker = m_blockerPool.Create(this, type, position, width, minHeight, maxHeight, time);
+	blocker->m_proxyId = m_blockerTree.CreateProxy(blocker->GetBounds(), (int)m_blockerList.size());
 	m_blockerList.push_back(blocker);
 	return blocker;
 }
 
 GameRaycast3D BasketballCourt::RaycastVsBall(Vec3 startPos, Vec3 fwdNormal)
+{
+	GameRaycast3D result;
+	if (m_isBallRayBatchDirty)
+	{
+		BuildBallRayBatch();
+	}
+	BallRayHit hit = RaycastVsBallRayBatchSIMD(m_ballRayBatch, startPos, fwdNormal, RAY_CAST_LENGTH, RAY_CAST_RADIUS);
+	if (hit.m_ballIndex < 0)
+	{
+		return result;
+	}
+
+	Ball* hitBall = m_balls[hit.m_ballIndex];
+	RaycastResult3D ray = RaycastVsSphere3D(startPos, fwdNormal, RAY_CAST_LENGTH, hitBall->m_position, RAY_CAST_RADIUS);
+	result.m_didImpact = ray.m_didImpact;
+	result.m_impactDist = ray.m_impactDist;
+	result.m_impactNormal = ray.m_impactNormal;
+	result.m_impactPos = ray.m_impactPos;
+	result.m_hitBall = hitBall;
+	return result;
+}
+
+GameRaycast3D BasketballCourt::RaycastVsBallBruteForce(Vec3 startPos, Vec3 fwdNormal)
 {
 	GameRaycast3D result;
 	float smallestDitance = FLT_MAX;
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	for (int i = 0; i < m_balls.GetNumBalls(); i++)
 	{
-		if (m_ballList[i])
+		RaycastResult3D ray = RaycastVsSphere3D(startPos, fwdNormal, RAY_CAST_LENGTH, m_balls[i]->m_position, RAY_CAST_RADIUS);
+		if (ray.m_didImpact)
 		{
-			RaycastResult3D ray = RaycastVsSphere3D(startPos, fwdNormal, RAY_CAST_LENGTH, m_ballList[i]->m_position, RAY_CAST_RADIUS);
-			if (ray.m_didImpact)
+			if (ray.m_impactDist < smallestDitance)
 			{
-				if (ray.m_impactDist < smallestDitance)
-				{
-					result.m_didImpact = ray.m_didImpact;
-					result.m_impactDist = ray.m_impactDist;
-					result.m_impactNormal = ray.m_impactNormal;
-					result.m_impactPos = ray.m_impactPos;
-					result.m_hitBall = m_ballList[i];
-				}
+				smallestDitance = ray.m_impactDist;
+				result.m_didImpact = ray.m_didImpact;
+				result.m_impactDist = ray.m_impactDist;
+				result.m_impactNormal = ray.m_impactNormal;
+				result.m_impactPos = ray.m_impactPos;
+				result.m_hitBall = m_balls[i];
 			}
 		}
 	}
@@ -203,6 +535,30 @@ GameRaycast3D BasketballCourt::RaycastVsBall(Vec3 startPos, Vec3 fwdNormal)
 	return result;
 }
 
+void BasketballCourt::BuildBallRayBatch()
+{
+	m_ballRayBatch.Clear();
+	int numBalls = m_balls.GetNumBalls();
+	// The grid is from the start of the last step, a ball created or removed since leaves it stale
+	if ((int)m_ballGrid.m_ballIndices.size() == numBalls)
+	{
+		for (int i = 0; i < numBalls; i++)
+		{
+			int ballIndex = m_ballGrid.m_ballIndices[i];
+			m_ballRayBatch.AddCenter(m_balls[ballIndex]->m_position, ballIndex);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < numBalls; i++)
+		{
+			m_ballRayBatch.AddCenter(m_balls[i]->m_position, i);
+		}
+	}
+	m_ballRayBatch.Finish();
+	m_isBallRayBatchDirty = false;
+}
+
 void BasketballCourt::PlayerCollisionWithWorld()
 {
 	Vec2 playerXY = Vec2(m_player->m_position.x, m_player->m_position.y);
@@ -248,76 +604,308 @@ void BasketballCourt::PlayerCollisionWithWorld()
 
 void BasketballCourt::DeleteAllBalls()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
-	{
-		delete m_ballList[i];
-		m_ballList[i] = nullptr;
-	}
-
-	m_ballList.clear();
+	m_ballPool.DestroyAll();
+	m_balls.Clear();
+	m_isBallRayBatchDirty = true;
 }
 
+// Removing a ball moves the last one into its place, so these walk the balls from the back
 void BasketballCourt::DeleteAllBallsThatPlayerNotHolding()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	Ball const* heldBall = m_player->GetCurrentBall();
+	for (int i = m_balls.GetNumBalls() - 1; i >= 0; i--)
 	{
-		if (m_player->m_currentBall == m_ballList[i])
+		if (m_balls[i] != heldBall)
 		{
-			continue;
+			DestroyBall(m_balls[i]);
 		}
-		delete m_ballList[i];
-		m_ballList[i] = nullptr;
 	}
 }
 
 void BasketballCourt::DeleteAllGarbageBalls()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	for (int i = m_balls.GetNumBalls() - 1; i >= 0; i--)
 	{
-		if (m_ballList[i]->m_isGarbage)
+		if (m_balls[i]->m_isGarbage)
 		{
-			delete m_ballList[i];
-			m_ballList[i] = nullptr;
+			DestroyBall(m_balls[i]);
 		}
 	}
 }
 
 void BasketballCourt::BounceBallsCourt()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	// Each ball only reads the court and hoops, so balls are independent
+	RunPhysicsPhase(m_balls.GetNumBalls(), BALL_COLLISION_GRAIN, [this](int chunkIndex, int chunkBegin, int chunkEnd)
+		{
+			std::vector<PhysicsSoundEvent>& soundEvents = GetPhysicsSoundEvents(chunkIndex);
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				if (m_balls[i]->m_isAwake)
+				{
+					// The query margin covers the floor bounce pushing the ball, so the hoop pass can reuse it
+					int colliderIndexes[MAX_COURT_COLLIDER_CANDIDATES];
+					int numColliders = QueryStaticColliders(m_balls[i], colliderIndexes);
+					BounceBallOffFloor(m_balls[i], colliderIndexes, numColliders, soundEvents);
+					BounceBallOffHoop(m_balls[i], colliderIndexes, numColliders, soundEvents);
+				}
+			}
+		});
+}
+
+void BasketballCourt::BounceBallsOffPlayer()
+{
+	Ball const* heldBall = m_player->GetCurrentBall();
+	RunPhysicsPhase(m_balls.GetNumBalls(), BALL_COLLISION_GRAIN, [this, heldBall](int chunkIndex, int chunkBegin, int chunkEnd)
+		{
+			UNUSED(chunkIndex);
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				if (!m_player->m_isHoldingBall && heldBall != m_balls[i])
+				{
+					if (PushSphereOutOfZCylinder3D(m_balls[i]->m_position, m_balls[i]->m_radius, m_player->GetPositionXY(), m_player->GetHeightRange(), m_player->m_radius))
+					{
+						m_balls[i]->WakeUp();
+					}
+				}
+			}
+		});
+}
+
+void BasketballCourt::BounceBallsOffBalls()
+{
+	RebuildBallGrid();
+	FindBallContactPairs();
+	BuildBallContactIslands();
+
+	// Islands share no balls, so they can be resolved in any order or at the same time
+	BallContactIslands const& islands = m_ballContactIslands;
+	RunPhysicsPhase(islands.m_numIslands, BALL_ISLAND_GRAIN, [this, &islands](int chunkIndex, int chunkBegin, int chunkEnd)
+		{
+			UNUSED(chunkIndex);
+			for (int islandIndex = chunkBegin; islandIndex < chunkEnd; islandIndex++)
+			{
+				for (int pairIndex = islands.m_islandStarts[islandIndex]; pairIndex < islands.m_islandStarts[islandIndex + 1]; pairIndex++)
+				{
+					BallContactPair const& pair = islands.m_islandPairs[pairIndex];
+					BounceBallsOffBall(m_balls[pair.m_ballA], m_balls[pair.m_ballB]);
+				}
+			}
+		});
+}
+
+void BasketballCourt::FindBallContactPairs()
+{
+	// Pairs come out in the same (i, j) order as the all-pairs loop. Cells are twice the ball diameter and
+	// pairs further apart than one cell are dropped, so push-outs earlier in the pass cannot bring in a pair
+	// we did not gather. Each chunk of balls writes its own list and the lists are joined in chunk order.
+	// Two sleeping balls never pair, a sleeping ball pairs through its awake neighbours instead
+	BallContactIslands& islands = m_ballContactIslands;
+	bool hasSleepingBalls = m_numSleepingBalls > 0;
+	int numBalls = m_balls.GetNumBalls();
+	int numChunks = (numBalls + BALL_COLLISION_GRAIN - 1) / BALL_COLLISION_GRAIN;
+	if ((int)islands.m_pairsByChunk.size() < numChunks)
 	{
-		if (m_ballList[i])
+		islands.m_pairsByChunk.resize(numChunks);
+		islands.m_candidatesByChunk.resize(numChunks);
+	}
+
+	RunPhysicsPhase(numBalls, BALL_COLLISION_GRAIN, [this, &islands](int chunkIndex, int chunkBegin, int chunkEnd)
 		{
-			BounceBallOffFloor(m_ballList[i]);
-			BounceBallOffHoop(m_ballList[i]);
-		}
+			BallGrid const& grid = m_ballGrid;
+			float maxContactDistanceSquared = grid.m_cellSize * grid.m_cellSize;
+			std::vector<BallContactPair>& pairs = islands.m_pairsByChunk[chunkIndex];
+			pairs.clear();
+			std::vector<int>& candidates = islands.m_candidatesByChunk[chunkIndex];
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				int cellIndex = grid.m_ballCells[i];
+				if (!m_balls[i]->m_isAwake)
+				{
+					continue;
+				}
+
+				int cellX = cellIndex % grid.m_numCellsX;
+				int cellY = cellIndex / grid.m_numCellsX;
+				candidates.clear();
+				for (int neighborY = cellY - 1; neighborY <= cellY + 1; neighborY++)
+				{
+					if (neighborY < 0 || neighborY >= grid.m_numCellsY)
+					{
+						continue;
+					}
+					for (int neighborX = cellX - 1; neighborX <= cellX + 1; neighborX++)
+					{
+						if (neighborX < 0 || neighborX >= grid.m_numCellsX)
+						{
+							continue;
+						}
+						int neighborCell = neighborY * grid.m_numCellsX + neighborX;
+						for (int k = grid.m_cellStarts[neighborCell]; k < grid.m_cellStarts[neighborCell + 1]; k++)
+						{
+							int j = grid.m_ballIndices[k];
+							bool isGatheredFromThisBall = j > i || (j < i && !m_balls[j]->m_isAwake);
+							if (isGatheredFromThisBall && GetDistanceSquared3D(m_balls[i]->m_position, m_balls[j]->m_position) < maxContactDistanceSquared)
+							{
+								candidates.push_back(j);
+							}
+						}
+					}
+				}
+
+				std::sort(candidates.begin(), candidates.end());
+				for (size_t candidateIndex = 0; candidateIndex < candidates.size(); candidateIndex++)
+				{
+					BallContactPair pair;
+					pair.m_ballA = i < candidates[candidateIndex] ? i : candidates[candidateIndex];
+					pair.m_ballB = i < candidates[candidateIndex] ? candidates[candidateIndex] : i;
+					pairs.push_back(pair);
+				}
+			}
+		});
+
+	islands.m_pairs.clear();
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		islands.m_pairs.insert(islands.m_pairs.end(), islands.m_pairsByChunk[chunkIndex].begin(), islands.m_pairsByChunk[chunkIndex].end());
+	}
+
+	// Pairs gathered from the awake side of a sleeping neighbour are out of place
+	if (hasSleepingBalls)
+	{
+		std::sort(islands.m_pairs.begin(), islands.m_pairs.end(), [](BallContactPair const& a, BallContactPair const& b)
+			{
+				return a.m_ballA != b.m_ballA ? a.m_ballA < b.m_ballA : a.m_ballB < b.m_ballB;
+			});
 	}
 }
 
-void BasketballCourt::BounceBallsOffPlayer()
+void BasketballCourt::BuildBallContactIslands()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	BallContactIslands& islands = m_ballContactIslands;
+	int numBalls = m_balls.GetNumBalls();
+
+	// Union-find over the balls of every pair, always keeping the smaller index as the root
+	islands.m_ballParents.resize(numBalls);
+	for (int i = 0; i < numBalls; i++)
 	{
-		if (m_ballList[i])
+		islands.m_ballParents[i] = i;
+	}
+	auto findRoot = [&islands](int ball)
 		{
-			Vec3 nearestPoint = GetNearestPointOnZCynlinder3D(m_ballList[i]->m_position, m_player->GetPositionXY(), m_player->GetHeightRange(), m_player->m_radius);
-			if (!m_player->m_isHoldingBall && m_player->m_currentBall != m_ballList[i])
+			while (islands.m_ballParents[ball] != ball)
 			{
-				PushSphereOutOfZCylinder3D(m_ballList[i]->m_position, m_ballList[i]->m_radius, m_player->GetPositionXY(), m_player->GetHeightRange(), m_player->m_radius);
+				islands.m_ballParents[ball] = islands.m_ballParents[islands.m_ballParents[ball]];
+				ball = islands.m_ballParents[ball];
 			}
+			return ball;
+		};
+	for (size_t pairIndex = 0; pairIndex < islands.m_pairs.size(); pairIndex++)
+	{
+		int rootA = findRoot(islands.m_pairs[pairIndex].m_ballA);
+		int rootB = findRoot(islands.m_pairs[pairIndex].m_ballB);
+		if (rootA < rootB)
+		{
+			islands.m_ballParents[rootB] = rootA;
+		}
+		else if (rootB < rootA)
+		{
+			islands.m_ballParents[rootA] = rootB;
+		}
+	}
+
+	// Number the islands by their smallest ball, then bucket the pairs with a counting sort so each
+	// island keeps its pairs in global order
+	islands.m_islandOfBall.assign(numBalls, -1);
+	islands.m_numIslands = 0;
+	for (size_t pairIndex = 0; pairIndex < islands.m_pairs.size(); pairIndex++)
+	{
+		int root = findRoot(islands.m_pairs[pairIndex].m_ballA);
+		if (islands.m_islandOfBall[root] < 0)
+		{
+			islands.m_islandOfBall[root] = islands.m_numIslands++;
+		}
+	}
+
+	islands.m_islandStarts.assign(islands.m_numIslands + 1, 0);
+	for (size_t pairIndex = 0; pairIndex < islands.m_pairs.size(); pairIndex++)
+	{
+		islands.m_islandStarts[islands.m_islandOfBall[findRoot(islands.m_pairs[pairIndex].m_ballA)] + 1]++;
+	}
+	islands.m_largestIslandPairs = 0;
+	for (int islandIndex = 0; islandIndex < islands.m_numIslands; islandIndex++)
+	{
+		if (islands.m_islandStarts[islandIndex + 1] > islands.m_largestIslandPairs)
+		{
+			islands.m_largestIslandPairs = islands.m_islandStarts[islandIndex + 1];
 		}
+		islands.m_islandStarts[islandIndex + 1] += islands.m_islandStarts[islandIndex];
+	}
+
+	islands.m_islandCursors.assign(islands.m_islandStarts.begin(), islands.m_islandStarts.end() - 1);
+	islands.m_islandPairs.resize(islands.m_pairs.size());
+	for (size_t pairIndex = 0; pairIndex < islands.m_pairs.size(); pairIndex++)
+	{
+		int islandIndex = islands.m_islandOfBall[findRoot(islands.m_pairs[pairIndex].m_ballA)];
+		islands.m_islandPairs[islands.m_islandCursors[islandIndex]++] = islands.m_pairs[pairIndex];
 	}
 }
 
-void BasketballCourt::BounceBallsOffBalls()
+void BasketballCourt::RebuildBallGrid()
+{
+	BallGrid& grid = m_ballGrid;
+
+	float maxRadius = BALL_RADIUS;
+	int numBalls = m_balls.GetNumBalls();
+	for (int i = 0; i < numBalls; i++)
+	{
+		if (m_balls[i]->m_radius > maxRadius)
+		{
+			maxRadius = m_balls[i]->m_radius;
+		}
+	}
+	grid.m_cellSize = BALL_GRID_CELL_SIZE > 4.f * maxRadius ? BALL_GRID_CELL_SIZE : 4.f * maxRadius;
+	grid.m_numCellsX = (int)ceilf(2.f * BALL_GRID_HALF_EXTENT / grid.m_cellSize);
+	grid.m_numCellsY = grid.m_numCellsX;
+	int numCells = grid.m_numCellsX * grid.m_numCellsY;
+
+	grid.m_cellStarts.assign(numCells + 1, 0);
+	grid.m_ballCells.resize(numBalls);
+	for (int i = 0; i < numBalls; i++)
+	{
+		Ball* ball = m_balls[i];
+		int cellX = (int)floorf((ball->m_position.x + BALL_GRID_HALF_EXTENT) / grid.m_cellSize);
+		int cellY = (int)floorf((ball->m_position.y + BALL_GRID_HALF_EXTENT) / grid.m_cellSize);
+		cellX = cellX < 0 ? 0 : (cellX >= grid.m_numCellsX ? grid.m_numCellsX - 1 : cellX);
+		cellY = cellY < 0 ? 0 : (cellY >= grid.m_numCellsY ? grid.m_numCellsY - 1 : cellY);
+		int cellIndex = cellY * grid.m_numCellsX + cellX;
+		grid.m_ballCells[i] = cellIndex;
+		grid.m_cellStarts[cellIndex + 1]++;
+	}
+
+	for (int cellIndex = 0; cellIndex < numCells; cellIndex++)
+	{
+		grid.m_cellStarts[cellIndex + 1] += grid.m_cellStarts[cellIndex];
+	}
+
+	grid.m_cellCursors.assign(grid.m_cellStarts.begin(), grid.m_cellStarts.end() - 1);
+	grid.m_ballIndices.resize(grid.m_cellStarts[numCells]);
+	for (int i = 0; i < numBalls; i++)
+	{
+		grid.m_ballIndices[grid.m_cellCursors[grid.m_ballCells[i]]++] = i;
+	}
+}
+
+void BasketballCourt::BounceBallsOffBallsBruteForce()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	int numBalls = m_balls.GetNumBalls();
+	for (int i = 0; i < numBalls; i++)
 	{
-		for (size_t j = i + 1; j < m_ballList.size(); j++)
+		for (int j = i + 1; j < numBalls; j++)
 		{
-			if (m_ballList[i] && m_ballList[j])
+			if (m_balls[i]->m_isAwake || m_balls[j]->m_isAwake)
 			{
-				BounceBallsOffBall(m_ballList[i], m_ballList[j]);
+				BounceBallsOffBall(m_balls[i], m_balls[j]);
 			}
 		}
 	}
@@ -325,12 +913,28 @@ void BasketballCourt::BounceBallsOffBalls()
 
 void BasketballCourt::BounceBallsOffBlockers()
 {
-	for (size_t i = 0; i < m_ballList.size(); i++)
+	int numChunks = (m_balls.GetNumBalls() + BALL_COLLISION_GRAIN - 1) / BALL_COLLISION_GRAIN;
+	if ((int)m_blockerCandidatesByChunk.size() < numChunks)
 	{
-		if (m_ballList[i])
+		m_blockerCandidatesByChunk.resize(numChunks);
+	}
+
+	RunPhysicsPhase(m_balls.GetNumBalls(), BALL_COLLISION_GRAIN, [this](int chunkIndex, int chunkBegin, int chunkEnd)
 		{
-			BounceBallOffBlocker(m_ballList[i]);
-		}
+			std::vector<PhysicsSoundEvent>& soundEvents = GetPhysicsSoundEvents(chunkIndex);
+			std::vector<int>& blockerCandidates = m_blockerCandidatesByChunk[chunkIndex];
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				BounceBallOffBlocker(m_balls[i], soundEvents, blockerCandidates);
+			}
+		});
+}
+
+void BasketballCourt::UpdateBlockerTree()
+{
+	for (size_t i = 0; i < m_blockerList.size(); i++)
+	{
+		m_blockerTree.MoveProxy(m_blockerList[i]->m_proxyId, m_blockerList[i]->GetBounds());
 	}
 }
 
@@ -385,7 +989,7 @@ bool BasketballCourt::BounceBallsOffBall(Ball* a, Ball* b)
 	return true;
 }
 
-void BasketballCourt::BounceBallOffFloor(Ball* ball)
+void BasketballCourt::BounceBallOffFloor(Ball* ball, int const* colliderIndexes, int numColliders, std::vector<PhysicsSoundEvent>& soundEvents)
 {
 	if (!ball)
 	{
@@ -393,36 +997,19 @@ void BasketballCourt::BounceBallOffFloor(Ball* ball)
 	}
 
 	bool isHit = false;
-	Vec3 pointOnFloor = m_gameFloor.GetNearestPoint(ball->m_position);
-	if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnFloor, 0.99f, GROUND_STATIC_FRICTION))
-	{
-		ball->AddImpulseTorque(pointOnFloor, -ball->m_velocity);
-		isHit = true;
-	}
-	Vec3 pointOnNWall = m_northWall.GetNearestPoint(ball->m_position);
-	if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnNWall, 0.99f, GROUND_STATIC_FRICTION))
+	for (int i = 0; i < numColliders; i++)
 	{
-
-		ball->AddImpulseTorque(pointOnNWall, -ball->m_velocity);
-		isHit = true;
-	}
-	Vec3 pointOnSWall = m_southWall.GetNearestPoint(ball->m_position);
-	if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnSWall, 0.99f, GROUND_STATIC_FRICTION))
-	{
-		ball->AddImpulseTorque(pointOnSWall, -ball->m_velocity);
-		isHit = true;
-	}
-	Vec3 pointOnEWall = m_eastWall.GetNearestPoint(ball->m_position);
-	if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnEWall, 0.99f, GROUND_STATIC_FRICTION))
-	{
-		ball->AddImpulseTorque(pointOnEWall, -ball->m_velocity);
-		isHit = true;
-	}
-	Vec3 pointOnWWall = m_westWall.GetNearestPoint(ball->m_position);
-	if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnWWall, 0.99f, GROUND_STATIC_FRICTION))
-	{
-		ball->AddImpulseTorque(pointOnWWall, -ball->m_velocity);
-		isHit = true;
+		CourtCollider const& collider = m_staticColliders.GetCollider(colliderIndexes[i]);
+		if (collider.m_tag != CourtColliderTag::FLOOR && collider.m_tag != CourtColliderTag::WALL)
+		{
+			continue;
+		}
+		Vec3 pointOnCollider = collider.GetNearestPoint(ball->m_position);
+		if (BounceSphereOffPoint(ball->m_position, BALL_RADIUS, ball->m_velocity, 0.9f, pointOnCollider, collider.m_elasticity, collider.m_friction))
+		{
+			ball->AddImpulseTorque(pointOnCollider, -ball->m_velocity);
+			isHit = true;
+		}
 	}
 	if (isHit)
 	{
@@ -430,12 +1017,15 @@ void BasketballCourt::BounceBallOffFloor(Ball* ball)
 		ball->AddImpulse(0.87f * CrossProduct3D(ball->m_angularVelocity, -ball->m_velocity));
 		if (ball->m_velocity.z > BALL_RADIUS + 0.05f)
 		{
-			ball->PlaySound(g_theGame->m_ballBounceGroundSound);
+			PhysicsSoundEvent soundEvent;
+			soundEvent.m_ball = ball;
+			soundEvent.m_sound = g_theGame->m_ballBounceGroundSound;
+			soundEvents.push_back(soundEvent);
 		}
 	}
 }
 
-void BasketballCourt::BounceBallOffHoop(Ball* ball)
+void BasketballCourt::BounceBallOffHoop(Ball* ball, int const* colliderIndexes, int numColliders, std::vector<PhysicsSoundEvent>& soundEvents)
 {
 	if (!ball)
 	{
@@ -443,133 +1033,73 @@ void BasketballCourt::BounceBallOffHoop(Ball* ball)
 	}
 
 	bool isHit = false;
-
-	if (m_hoopCylA)
+	for (int i = 0; i < numColliders; i++)
 	{
-		Vec3 pHoopACyl = GetNearestPointOnZCynlinder3D(ball->m_position, m_hoopCylA->GetPositionXY(), m_hoopCylA->GetHeightRange(), m_hoopCylA->m_radius);
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoopACyl, 0.6f, 0.1f))
+		CourtCollider const& collider = m_staticColliders.GetCollider(colliderIndexes[i]);
+		if (collider.m_tag == CourtColliderTag::FLOOR || collider.m_tag == CourtColliderTag::WALL)
 		{
-			ball->AddImpulseTorque(pHoopACyl, -ball->m_velocity);
-			isHit = true;
-		}
-	}
-
-	if (m_hoopCylB)
-	{
-		Vec3 pHoopBCyl = GetNearestPointOnZCynlinder3D(ball->m_position, m_hoopCylB->GetPositionXY(), m_hoopCylB->GetHeightRange(), m_hoopCylA->m_radius);
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoopBCyl, 0.6f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoopBCyl, -ball->m_velocity);
-			isHit = true;
-		}
-	}
-
-	if (m_hoopBoardA)
-	{
-		Vec3 pHoodBoardA = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBoardA->m_position, m_hoopBoardA->m_height, 0.1f, m_hoopBoardA->m_radius));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBoardA, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBoardA, -ball->m_velocity);
-			isHit = true;
-		}
-	}
-
-	if (m_hoopBoardB)
-	{
-		Vec3 pHoodBoardB = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBoardB->m_position, m_hoopBoardB->m_height, 0.1f, m_hoopBoardB->m_radius));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBoardB, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBoardB, -ball->m_velocity);
-			isHit = true;
-		}
-	}
-
-	if (m_hoopBasketA1)
-	{
-		Vec3 pHoodBasketA1 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketA1->m_position, m_hoopBasketA1->m_height, m_hoopBasketA1->m_radius, m_hoopBasketA1->m_height));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketA1, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBasketA1, -ball->m_velocity);
-			isHit = true;
-		}
-	}
-
-	if (m_hoopBasketA2)
-	{
-		Vec3 pHoodBasketA2 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketA2->m_position, m_hoopBasketA2->m_height, m_hoopBasketA2->m_height, m_hoopBasketA2->m_radius));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketA2, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBasketA2, -ball->m_velocity);
-			isHit = true;
+			continue;
 		}
-	}
-
-	if (m_hoopBasketA3)
-	{
-		Vec3 pHoodBasketA3 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketA3->m_position, m_hoopBasketA3->m_height, m_hoopBasketA3->m_radius, m_hoopBasketA3->m_height));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketA3, 0.7f, 0.1f))
+		Vec3 pointOnCollider = collider.GetNearestPoint(ball->m_position);
+		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pointOnCollider, collider.m_elasticity, collider.m_friction))
 		{
-			ball->AddImpulseTorque(pHoodBasketA3, -ball->m_velocity);
+			ball->AddImpulseTorque(pointOnCollider, -ball->m_velocity);
 			isHit = true;
 		}
 	}
 
-	if (m_hoopBasketB1)
+	if (isHit)
 	{
-		Vec3 pHoodBasketB1 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketB1->m_position, m_hoopBasketB1->m_height, m_hoopBasketB1->m_radius, m_hoopBasketB1->m_height));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketB1, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBasketB1, -ball->m_velocity);
-			isHit = true;
-		}
+		SonFormularForBallVsGroundCollisionResolve(ball);
+		PhysicsSoundEvent soundEvent;
+		soundEvent.m_ball = ball;
+		soundEvent.m_sound = g_theGame->m_ballBounceBackboardSound;
+		soundEvents.push_back(soundEvent);
 	}
+}
 
-	if (m_hoopBasketB2)
+void BasketballCourt::BounceBallOffBlocker(Ball* ball, std::vector<PhysicsSoundEvent>& soundEvents, std::vector<int>& blockerCandidates)
+{
+	blockerCandidates.clear();
+	if (m_isBlockerTreeEnabled)
 	{
-		Vec3 pHoodBasketB2 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketB2->m_position, m_hoopBasketB2->m_height, m_hoopBasketB2->m_height, m_hoopBasketB2->m_radius));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketB2, 0.7f, 0.1f))
-		{
-			ball->AddImpulseTorque(pHoodBasketB2, -ball->m_velocity);
-			isHit = true;
-		}
+		// Twice the radius, an earlier bounce can push the ball up to a radius towards the next blocker
+		float queryHalfExtent = 2.f * ball->m_radius;
+		Vec3 halfExtents = Vec3(queryHalfExtent, queryHalfExtent, queryHalfExtent);
+		m_blockerTree.Query(AABB3(ball->m_position - halfExtents, ball->m_position + halfExtents), blockerCandidates);
+		std::sort(blockerCandidates.begin(), blockerCandidates.end());
 	}
-
-	if (m_hoopBasketB3)
+	else
 	{
-		Vec3 pHoodBasketB3 = GetNearestPointOnAABB3D(ball->m_position, AABB3(m_hoopBasketB3->m_position, m_hoopBasketB3->m_height, m_hoopBasketB3->m_radius, m_hoopBasketB3->m_height));
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, pHoodBasketB3, 0.7f, 0.1f))
+		for (int i = 0; i < (int)m_blockerList.size(); i++)
 		{
-			ball->AddImpulseTorque(pHoodBasketB3, -ball->m_velocity);
-			isHit = true;
+			blockerCandidates.push_back(i);
 		}
 	}
 
-
-	if (isHit)
-	{
-		SonFormularForBallVsGroundCollisionResolve(ball);
-		ball->PlaySound(g_theGame->m_ballBounceBackboardSound);
-	}
-}
-
-void BasketballCourt::BounceBallOffBlocker(Ball* ball)
-{
-	for (size_t i = 0; i < m_blockerList.size(); i++)
+	for (size_t candidateIndex = 0; candidateIndex < blockerCandidates.size(); candidateIndex++)
 	{
-		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, m_blockerList[i]->GetNearestPoint(ball->m_position), 0.5f))
+		Blocker* blocker = m_blockerList[blockerCandidates[candidateIndex]];
+		if (BounceSphereOffPoint(ball->m_position, ball->m_radius, ball->m_velocity, 0.9f, blocker->GetNearestPoint(ball->m_position), 0.5f))
 		{
-			switch (m_blockerList[i]->m_type)
+			PhysicsSoundEvent soundEvent;
+			soundEvent.m_blocker = blocker;
+			switch (blocker->m_type)
 			{
 			case BlockerType::STATIC_BLOCK:
-				m_blockerList[i]->PlaySound(g_theGame->m_staticBlockerSound);
+				soundEvent.m_sound = g_theGame->m_staticBlockerSound;
 				break;
 			case BlockerType::CONTINUOUS_BLOCK:
-				m_blockerList[i]->PlaySound(g_theGame->m_continuousBlockerSound);
+				soundEvent.m_sound = g_theGame->m_continuousBlockerSound;
 				break;
 			case BlockerType::TIMER_BLOCK:
-				m_blockerList[i]->PlaySound(g_theGame->m_timerBlockerSound);
+				soundEvent.m_sound = g_theGame->m_timerBlockerSound;
 				break;
 			}
+			if (soundEvent.m_sound != MISSING_SOUND_ID)
+			{
+				soundEvents.push_back(soundEvent);
+			}
 		}
 	}
 }
@@ -588,9 +1118,7 @@ bool BasketballCourt::IsBallAScore(Ball* ball, Hoop* hoop)
 			return false;
 		}
 		hoop->m_isColliding = true;
-		if (ball->m_position.z > hoop->m_collider.GetCenter().z + 0.9f
-			&& FloatRange(hoop->m_collider.m_mins.x, hoop->m_collider.m_maxs.x).IsOnRange(ball->m_position.x)
-			&& FloatRange(hoop->m_collider.m_mins.y, hoop->m_collider.m_maxs.y).IsOnRange(ball->m_position.y))
+		if (IsShotScoringPosition(ball->m_position, hoop->m_collider))
 		{
 			g_theGame->PlaySound(g_theGame->m_scoreSound, true);
 			g_theGame->ShakeCamera(15.f);
@@ -632,6 +1160,8 @@ void BasketballCourt::SonFormularForBallVsGroundCollisionResolve(Ball* ball)
 
 void BasketballCourt::InitializeCourt()
 {
+	CreateBallMesh();
+
 	AddVertsForQuad3D(m_courtVertices, m_courtIndices, Vec3(-50, -50, 0), Vec3(50, -50, 0), Vec3(-50, 50, 0), Vec3(50, 50, 0));
 
 	AddVertsForSkyBox(m_skyboxVertices, AABB3(-50.f, -50.f, -40.f, 50.f, 50.f, 60.f), Rgba8::COLOR_WHITE);
@@ -692,34 +1222,147 @@ void BasketballCourt::InitializeCourt()
 
 		m_hoopB = new Hoop(AABB3(Vec3(-40.8f, 0.f, 11.5f), 0.5f, 1.5f, 1.5f));
 	}
+
+	// The hoop props never change their vertexes after this, so culling reads their radius from the cache
+	Prop* props[10] = { m_hoopCylA, m_hoopBoardA, m_hoopBasketA1, m_hoopBasketA2, m_hoopBasketA3, m_hoopCylB, m_hoopBoardB, m_hoopBasketB1, m_hoopBasketB2, m_hoopBasketB3 };
+	for (int i = 0; i < 10; i++)
+	{
+		if (props[i])
+		{
+			props[i]->UpdateBoundingRadius();
+		}
+	}
+
+	CreateCourtMeshes();
+	BuildStaticColliders();
 }
 
-void BasketballCourt::DrawCourt() const
+void BasketballCourt::BuildStaticColliders()
 {
-	g_theRenderer->BindShader(nullptr);
-	g_theRenderer->SetModelConstants();
-	g_theRenderer->SetDepthStencilMode(DepthMode::ENABLED);
-	g_theRenderer->SetBlendMode(BlendMode::ALPHA);
+	// Registration order is resolution order, kept the same as the old hard-coded checks
+	m_staticColliders.Clear();
+	m_staticColliders.AddPlane(CourtColliderTag::FLOOR, m_gameFloor, 0.99f, GROUND_STATIC_FRICTION);
+	m_staticColliders.AddPlane(CourtColliderTag::WALL, m_northWall, 0.99f, GROUND_STATIC_FRICTION);
+	m_staticColliders.AddPlane(CourtColliderTag::WALL, m_southWall, 0.99f, GROUND_STATIC_FRICTION);
+	m_staticColliders.AddPlane(CourtColliderTag::WALL, m_eastWall, 0.99f, GROUND_STATIC_FRICTION);
+	m_staticColliders.AddPlane(CourtColliderTag::WALL, m_westWall, 0.99f, GROUND_STATIC_FRICTION);
+
+	Prop const* poles[2] = { m_hoopCylA, m_hoopCylB };
+	for (int i = 0; i < 2; i++)
+	{
+		if (poles[i])
+		{
+			m_staticColliders.AddZCylinder(CourtColliderTag::POLE, poles[i]->GetPositionXY(), poles[i]->GetHeightRange(), poles[i]->m_radius, 0.6f, 0.1f);
+		}
+	}
+	Prop const* boards[2] = { m_hoopBoardA, m_hoopBoardB };
+	for (int i = 0; i < 2; i++)
+	{
+		if (boards[i])
+		{
+			m_staticColliders.AddBox(CourtColliderTag::BOARD, AABB3(boards[i]->m_position, boards[i]->m_height, 0.1f, boards[i]->m_radius), 0.7f, 0.1f);
+		}
+	}
+	// Rims 1 and 3 run along X, rim 2 along Y
+	Prop const* rims[6] = { m_hoopBasketA1, m_hoopBasketA2, m_hoopBasketA3, m_hoopBasketB1, m_hoopBasketB2, m_hoopBasketB3 };
+	for (int i = 0; i < 6; i++)
+	{
+		Prop const* rim = rims[i];
+		if (!rim)
+		{
+			continue;
+		}
+		AABB3 rimBox = (i % 3 == 1) ? AABB3(rim->m_position, rim->m_height, rim->m_height, rim->m_radius) : AABB3(rim->m_position, rim->m_height, rim->m_radius, rim->m_height);
+		m_staticColliders.AddBox(CourtColliderTag::RIM, rimBox, 0.7f, 0.1f);
+	}
 
-	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_BACK);
-	g_theRenderer->BindTexture(g_theGame->m_courtTexture);
-	g_theRenderer->DrawIndexedBuffer(m_courtVertices, m_courtIndices);
+	m_staticColliders.Build();
+}
 
-	g_theRenderer->BindTexture(g_theGame->m_skyboxTexture);
-	g_theRenderer->DrawVertexArray(m_skyboxVertices.size(), m_skyboxVertices.data());
+int BasketballCourt::QueryStaticColliders(Ball const* ball, int* outIndexes) const
+{
+	// Twice the radius, so a collider a previous bounce this step pushed the ball into is still a candidate
+	float queryHalfExtent = 2.f * ball->m_radius;
+	Vec3 halfExtents = Vec3(queryHalfExtent, queryHalfExtent, queryHalfExtent);
+	return m_staticColliders.Query(AABB3(ball->m_position - halfExtents, ball->m_position + halfExtents), outIndexes, MAX_COURT_COLLIDER_CANDIDATES);
+}
 
-	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_NONE);
-	g_theRenderer->BindTexture(g_theGame->m_netTexture);
-	g_theRenderer->DrawIndexedBuffer(m_netVertices, m_netIndices);
+void BasketballCourt::DrawCourt(RenderQueue& queue) const
+{
+	m_courtRenderRecord.m_numStaticMeshDraws = 0;
+	m_courtRenderRecord.m_numImmediateDraws = 0;
+	m_courtRenderRecord.m_numImmediateBytes = 0;
+
+	RenderDrawState state;
+	state.m_texture = g_theGame->m_courtTexture;
+	DrawCourtPiece(queue, state, m_courtMesh, m_courtVertices, m_courtIndices);
+
+	state.m_texture = g_theGame->m_skyboxTexture;
+	DrawCourtPiece(queue, state, m_skyboxMesh, m_skyboxVertices, std::vector<unsigned int>());
+
+	// The nets are see-through and seen from both sides, so they go after everything solid
+	state.m_pass = RenderPass::TRANSLUCENT;
+	state.m_blendMode = BlendMode::ALPHA;
+	state.m_rasterizerMode = RasterizerMode::SOLID_CULL_NONE;
+	state.m_texture = g_theGame->m_netTexture;
+	DrawCourtPiece(queue, state, m_netMesh, m_netVertices, m_netIndices);
 }
 
-void BasketballCourt::DrawGrid() const
+void BasketballCourt::CreateCourtMeshes()
 {
-	DebugAddWorldBasis();
-	// Drawing Grid
+	delete m_courtMesh;
+	m_courtMesh = nullptr;
+	delete m_skyboxMesh;
+	m_skyboxMesh = nullptr;
+	delete m_netMesh;
+	m_netMesh = nullptr;
+
+	std::vector<Vertex_PCU> const* vertexes[3] = { &m_courtVertices, &m_skyboxVertices, &m_netVertices };
+	std::vector<unsigned int> const* indexes[3] = { &m_courtIndices, nullptr, &m_netIndices };
+	StaticMesh** meshes[3] = { &m_courtMesh, &m_skyboxMesh, &m_netMesh };
+	for (int i = 0; i < 3; i++)
+	{
+		if (vertexes[i]->empty())
+		{
+			continue;
+		}
+		size_t numIndexes = indexes[i] ? indexes[i]->size() : 0;
+		m_courtRenderRecord.m_numStaticMeshUploads++;
+		m_courtRenderRecord.m_numStaticMeshBytes += vertexes[i]->size() * sizeof(Vertex_PCU) + numIndexes * sizeof(unsigned int);
+		if (g_theRenderer)
+		{
+			*meshes[i] = g_theRenderer->CreateStaticMesh(vertexes[i]->size(), vertexes[i]->data(), numIndexes, indexes[i] ? indexes[i]->data() : nullptr);
+		}
+	}
+}
+
+void BasketballCourt::DrawCourtPiece(RenderQueue& queue, RenderDrawState const& state, StaticMesh const* mesh, std::vector<Vertex_PCU> const& vertexes, std::vector<unsigned int> const& indexes) const
+{
+	if (mesh)
+	{
+		m_courtRenderRecord.m_numStaticMeshDraws++;
+		queue.AddStaticMesh(state, mesh);
+		return;
+	}
+	if (vertexes.empty())
+	{
+		return;
+	}
+	m_courtRenderRecord.m_numImmediateDraws++;
+	m_courtRenderRecord.m_numImmediateBytes += vertexes.size() * sizeof(Vertex_PCU) + indexes.size() * sizeof(unsigned int);
+	if (indexes.empty())
+	{
+		queue.AddVertexArray(state, vertexes.size(), vertexes.data());
+	}
+	else
+	{
+		queue.AddIndexedVertexArray(state, vertexes.size(), vertexes.data(), indexes.size(), indexes.data());
+	}
+}
 
-	g_theRenderer->BindTexture(nullptr);
-	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_BACK);
+void BasketballCourt::DrawGrid(RenderQueue& queue) const
+{
+	// Drawing Grid
 
 	std::vector<Vertex_PCU> gridVertexes;
 
@@ -772,8 +1415,7 @@ void BasketballCourt::DrawGrid() const
 		AddVertsForAABB3D(gridVertexes, cube, color);
 	}
 
-	g_theRenderer->SetModelConstants();
-	g_theRenderer->DrawVertexArray((int)gridVertexes.size(), gridVertexes.data());
+	queue.AddVertexArray(RenderDrawState(), gridVertexes.size(), gridVertexes.data());
 }
 
 void BasketballCourt::RandomPlayerPosition()
@@ -790,29 +1432,395 @@ void BasketballCourt::RandomPlayerPosition()
 
 void BasketballCourt::SpawnRandomBlockers(int num)
 {
+	SpawnRandomBlockers(num, *g_theRNG);
+}
+
+void BasketballCourt::SpawnRandomBlockers(int num, RandomNumberGenerator& rng)
+{
+	// The lists and the pool keep their memory, so once a level as big as this one has been built, building it again allocates nothing
 	for (size_t i = 0; i < m_blockerList.size(); i++)
 	{
-		if (m_blockerList[i])
-		{
-			delete m_blockerList[i];
-		}
+		m_blockerPool.Destroy(m_blockerList[i]);
 	}
 	m_blockerList.clear();
+	m_blockerTree.Clear();
 
 	for (size_t i = 0; i < num; i++)
 	{
-		BlockerType type = (BlockerType)g_theRNG->RollRandomIntInRange(0, (int)BlockerType::BlockerType_COUNT - 1);
-		float xPos = g_theRNG->RollRandomFloatInRange(1.f, 21.f);
-		float yPos = g_theRNG->RollRandomFloatInRange(-26.f, 26.f);
+		BlockerType type = (BlockerType)rng.RollRandomIntInRange(0, (int)BlockerType::BlockerType_COUNT - 1);
+		float xPos = rng.RollRandomFloatInRange(1.f, 21.f);
+		float yPos = rng.RollRandomFloatInRange(-26.f, 26.f);
 		float zPos = 0.f;
-		float width = g_theRNG->RollRandomFloatInRange(3.f, 7.f);
-		float minHeight = g_theRNG->RollRandomFloatInRange(2.f, 4.f);
-		float maxHeight = g_theRNG->RollRandomFloatInRange(15.f, 25.f);
+		float width = rng.RollRandomFloatInRange(3.f, 7.f);
+		float minHeight = rng.RollRandomFloatInRange(2.f, 4.f);
+		float maxHeight = rng.RollRandomFloatInRange(15.f, 25.f);
 		if (type == BlockerType::STATIC_BLOCK)
 		{
-			maxHeight = g_theRNG->RollRandomFloatInRange(15.f, 20.f);
+			maxHeight = rng.RollRandomFloatInRange(15.f, 20.f);
 		}
-		float timer = g_theRNG->RollRandomFloatInRange(0.5f, 3.);
+		float timer = rng.RollRandomFloatInRange(0.5f, 3.);
 		CreateBlocker(type, Vec3(xPos, yPos, zPos), width, minHeight, maxHeight, timer);
 	}
 }
+
+void BasketballCourt::SweepFastBalls(float fixedDeltaSeconds)
+{
+	int numChunks = (m_balls.GetNumBalls() + BALL_COLLISION_GRAIN - 1) / BALL_COLLISION_GRAIN;
+	if ((int)m_blockerCandidatesByChunk.size() < numChunks)
+	{
+		m_blockerCandidatesByChunk.resize(numChunks);
+	}
+
+	// Each ball only reads the court and blockers, so balls are independent
+	RunPhysicsPhase(m_balls.GetNumBalls(), BALL_COLLISION_GRAIN, [this, fixedDeltaSeconds](int chunkIndex, int chunkBegin, int chunkEnd)
+		{
+			std::vector<int>& blockerCandidates = m_blockerCandidatesByChunk[chunkIndex];
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				Ball* ball = m_balls[i];
+				if (ball->m_isSimulatingPhysics && ball->m_isAwake)
+				{
+					SweepBall(ball, fixedDeltaSeconds, blockerCandidates);
+				}
+			}
+		});
+}
+
+void BasketballCourt::SweepBall(Ball* ball, float fixedDeltaSeconds, std::vector<int>& blockerCandidates)
+{
+	// Anything thinner than the distance a slower ball covers in a step still gets a discrete check with the ball inside it
+	Vec3 stepDisplacement = ball->m_velocity * fixedDeltaSeconds;
+	if (stepDisplacement.GetLengthSquared() < ball->m_radius * ball->m_radius)
+	{
+		return;
+	}
+
+	// Integration already moved the ball, sweep again from where it started. At each impact the ball stops
+	// on the surface, bounces like the discrete response would, and carries on for the rest of the step
+	Vec3 start = ball->m_position - stepDisplacement;
+	float remainingFraction = 1.f;
+	for (int impact = 0; impact <= BALL_CCD_MAX_IMPACTS; impact++)
+	{
+		Vec3 displacement = ball->m_velocity * (fixedDeltaSeconds * remainingFraction);
+		Vec3 end = start + displacement;
+		Vec3 halfExtents = Vec3(ball->m_radius, ball->m_radius, ball->m_radius);
+		AABB3 sweepBounds = AABB3(Vec3(fminf(start.x, end.x), fminf(start.y, end.y), fminf(start.z, end.z)) - halfExtents,
+			Vec3(fmaxf(start.x, end.x), fmaxf(start.y, end.y), fmaxf(start.z, end.z)) + halfExtents);
+
+		float firstImpactFraction = 2.f;
+		Vec3 pointOnSurface;
+		float elasticity = 0.f;
+		float friction = 0.f;
+
+		int colliderIndexes[MAX_COURT_COLLIDER_CANDIDATES];
+		int numColliders = m_staticColliders.Query(sweepBounds, colliderIndexes, MAX_COURT_COLLIDER_CANDIDATES);
+		for (int i = 0; i < numColliders; i++)
+		{
+			CourtCollider const& collider = m_staticColliders.GetCollider(colliderIndexes[i]);
+			float fraction = collider.GetSweptSphereImpactFraction(start, displacement, ball->m_radius);
+			if (fraction >= 0.f && fraction < firstImpactFraction)
+			{
+				firstImpactFraction = fraction;
+				pointOnSurface = collider.GetNearestPoint(start + displacement * fraction);
+				elasticity = collider.m_elasticity;
+				friction = collider.m_friction;
+			}
+		}
+
+		if (!m_blockerList.empty())
+		{
+			blockerCandidates.clear();
+			m_blockerTree.Query(sweepBounds, blockerCandidates);
+			for (size_t i = 0; i < blockerCandidates.size(); i++)
+			{
+				Blocker* blocker = m_blockerList[blockerCandidates[i]];
+				float fraction = GetSweptSphereVsAABB3DImpactFraction(start, displacement, ball->m_radius, blocker->GetBounds());
+				if (fraction >= 0.f && fraction < firstImpactFraction)
+				{
+					firstImpactFraction = fraction;
+					pointOnSurface = blocker->GetNearestPoint(start + displacement * fraction);
+					elasticity = 0.5f;
+					friction = 0.f;
+				}
+			}
+		}
+
+		if (firstImpactFraction > 1.f)
+		{
+			// Leave a sweep that hit nothing where integration put it, so CCD doesn't change those results
+			if (impact > 0)
+			{
+				ball->m_position = end;
+			}
+			return;
+		}
+		if (impact == BALL_CCD_MAX_IMPACTS)
+		{
+			// Out of impacts, stay on the last surface rather than risk moving through this one
+			return;
+		}
+
+		start += displacement * firstImpactFraction;
+		remainingFraction *= 1.f - firstImpactFraction;
+		ball->m_position = start;
+
+		// Same response as BounceSphereOffPoint, minus the push out, the ball is already on the surface
+		Vec3 normal = (start - pointOnSurface).GetNormalized();
+		float normalSpeed = DotProduct3D(ball->m_velocity, normal);
+		if (normalSpeed < 0.f)
+		{
+			Vec3 normalVelocity = normal * normalSpeed;
+			Vec3 tangentVelocity = (ball->m_velocity - normalVelocity) * (1.f - friction);
+			ball->m_velocity = tangentVelocity - normalVelocity * (0.9f * elasticity);
+		}
+	}
+}
+
+void BasketballCourt::UpdateBallSleep(float fixedDeltaSeconds)
+{
+	// Timers run over slots like integration does, islands are over dense indices and map to slots through the balls
+	int numBalls = m_balls.GetNumBalls();
+	if (m_isBallSleepEnabled)
+	{
+		RunPhysicsPhase(m_balls.GetNumSlotsUsed(), BALL_COLLISION_GRAIN, [this, fixedDeltaSeconds](int chunkIndex, int chunkBegin, int chunkEnd)
+			{
+				UNUSED(chunkIndex);
+				UpdateBallSleepTimers(m_ballStates, chunkBegin, chunkEnd, fixedDeltaSeconds);
+			});
+
+		// Balls in contact fall asleep together, otherwise each would keep nudging the others awake. An island
+		// with a ball that is still moving wakes every sleeping ball in it, they might be resting on that ball
+		BallContactIslands& islands = m_ballContactIslands;
+		islands.m_isBallInIsland.assign(numBalls, 0);
+		RunPhysicsPhase(islands.m_numIslands, BALL_ISLAND_GRAIN, [this, &islands](int chunkIndex, int chunkBegin, int chunkEnd)
+			{
+				UNUSED(chunkIndex);
+				for (int islandIndex = chunkBegin; islandIndex < chunkEnd; islandIndex++)
+				{
+					int firstPair = islands.m_islandStarts[islandIndex];
+					int lastPair = islands.m_islandStarts[islandIndex + 1];
+					float shortestSleepSeconds = FLT_MAX;
+					bool hasMovingBall = false;
+					for (int pairIndex = firstPair; pairIndex < lastPair; pairIndex++)
+					{
+						int balls[2] = { islands.m_islandPairs[pairIndex].m_ballA, islands.m_islandPairs[pairIndex].m_ballB };
+						for (int ballIndex = 0; ballIndex < 2; ballIndex++)
+						{
+							int slot = m_balls[balls[ballIndex]]->m_stateIndex;
+							float sleepSeconds = m_ballStates.m_sleepSeconds[slot];
+							islands.m_isBallInIsland[balls[ballIndex]] = 1;
+							shortestSleepSeconds = sleepSeconds < shortestSleepSeconds ? sleepSeconds : shortestSleepSeconds;
+							hasMovingBall = hasMovingBall || (m_ballStates.m_isAwake[slot] && sleepSeconds == 0.f);
+						}
+					}
+
+					if (shortestSleepSeconds < BALL_SLEEP_SECONDS && !hasMovingBall)
+					{
+						continue;
+					}
+					for (int pairIndex = firstPair; pairIndex < lastPair; pairIndex++)
+					{
+						int balls[2] = { islands.m_islandPairs[pairIndex].m_ballA, islands.m_islandPairs[pairIndex].m_ballB };
+						for (int ballIndex = 0; ballIndex < 2; ballIndex++)
+						{
+							int slot = m_balls[balls[ballIndex]]->m_stateIndex;
+							if (shortestSleepSeconds >= BALL_SLEEP_SECONDS)
+							{
+								PutBallToSleep(m_ballStates, slot);
+							}
+							else
+							{
+								m_ballStates.m_isAwake[slot] = true;
+							}
+						}
+					}
+				}
+			});
+
+		RunPhysicsPhase(numBalls, BALL_COLLISION_GRAIN, [this, &islands](int chunkIndex, int chunkBegin, int chunkEnd)
+			{
+				UNUSED(chunkIndex);
+				for (int i = chunkBegin; i < chunkEnd; i++)
+				{
+					int slot = m_balls[i]->m_stateIndex;
+					if (!islands.m_isBallInIsland[i] && m_ballStates.m_isAwake[slot] && m_ballStates.m_sleepSeconds[slot] >= BALL_SLEEP_SECONDS)
+					{
+						PutBallToSleep(m_ballStates, slot);
+					}
+				}
+			});
+	}
+
+	m_numAwakeBalls = 0;
+	m_numSleepingBalls = 0;
+	for (int i = 0; i < numBalls; i++)
+	{
+		if (m_balls[i]->m_isAwake)
+		{
+			m_numAwakeBalls++;
+		}
+		else
+		{
+			m_numSleepingBalls++;
+		}
+	}
+}
+
+bool BasketballCourt::Command_BallSleepStats(EventArgs& args)
+{
+	UNUSED(args);
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "Start a game first, there is no court");
+		return false;
+	}
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball sleep: %s, %d awake, %d asleep",
+		court->m_isBallSleepEnabled ? "enabled" : "disabled", court->m_numAwakeBalls, court->m_numSleepingBalls));
+	return false;
+}
+
+void BasketballCourt::CreateBallMesh()
+{
+	m_ballMeshVertices.clear();
+	m_ballMeshIndices.clear();
+	AddVertsForSphere(m_ballMeshVertices, m_ballMeshIndices, Vec3::ZERO, BALL_RADIUS);
+
+	m_ballRenderRecord.m_numMeshUploads++;
+	if (!g_theRenderer)
+	{
+		return;
+	}
+	delete m_ballMeshVBO;
+	delete m_ballMeshIBO;
+	m_ballMeshVBO = g_theRenderer->CreateVertexBuffer(sizeof(Vertex_PCU) * (unsigned int)m_ballMeshVertices.size());
+	m_ballMeshIBO = g_theRenderer->CreateIndexBuffer(sizeof(unsigned int) * m_ballMeshIndices.size());
+	g_theRenderer->CopyCPUToGPU(m_ballMeshVertices.data(), (unsigned int)(m_ballMeshVertices.size() * sizeof(Vertex_PCU)), m_ballMeshVBO);
+	g_theRenderer->CopyCPUToGPU(m_ballMeshIndices.data(), (unsigned int)(m_ballMeshIndices.size() * sizeof(unsigned int)), m_ballMeshIBO);
+}
+
+void BasketballCourt::BuildBallInstances() const
+{
+	m_ballInstances.clear();
+	for (size_t i = 0; i < m_visibility.m_visibleBalls.size(); i++)
+	{
+		Ball const* ball = m_balls[m_visibility.m_visibleBalls[i]];
+		ModelInstance instance;
+		instance.ModelMatrix = ball->GetModeMatrix();
+		instance.ModelColor = ball->m_color;
+		m_ballInstances.push_back(instance);
+	}
+}
+
+void BasketballCourt::RenderBalls(RenderQueue& queue) const
+{
+	UploadBallInstances();
+	AddBallInstances(queue);
+}
+
+void BasketballCourt::UploadBallInstances() const
+{
+	BuildBallInstances();
+
+	m_ballRenderRecord.m_numInstanceUploads = 0;
+	m_ballRenderRecord.m_numDrawCalls = 0;
+	m_ballRenderRecord.m_numInstances = (int)m_ballInstances.size();
+	if (m_ballInstances.empty())
+	{
+		return;
+	}
+	m_ballRenderRecord.m_numInstanceUploads++;
+	m_ballRenderRecord.m_numDrawCalls++;
+	if (g_theRenderer && m_ballMeshVBO)
+	{
+		unsigned int instanceBytes = (unsigned int)(m_ballInstances.size() * sizeof(ModelInstance));
+		if (!m_ballInstanceVBO)
+		{
+			m_ballInstanceVBO = g_theRenderer->CreateVertexBuffer(instanceBytes);
+		}
+		g_theRenderer->CopyCPUToGPU(m_ballInstances.data(), instanceBytes, m_ballInstanceVBO);
+	}
+}
+
+void BasketballCourt::AddBallInstances(RenderQueue& queue) const
+{
+	if (m_ballInstances.empty())
+	{
+		return;
+	}
+	RenderDrawState state;
+	state.m_texture = g_theGame->m_ballTexture;
+	queue.AddIndexedInstanced(state, m_ballMeshVBO, m_ballMeshIBO, m_ballMeshIndices.size(), m_ballInstanceVBO, m_ballInstances.size());
+}
+
+bool BasketballCourt::Command_BallRenderStats(EventArgs& args)
+{
+	UNUSED(args);
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "No court to report on");
+		return false;
+	}
+	BallRenderRecord const& record = court->m_ballRenderRecord;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball rendering: %d balls, %d mesh uploads, %d instance uploads and %d draw calls last frame",
+		record.m_numInstances, record.m_numMeshUploads, record.m_numInstanceUploads, record.m_numDrawCalls));
+	if (g_theRenderer)
+	{
+		RendererFrameStats const& stats = g_theRenderer->GetFrameStats();
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  renderer this frame: %d draw calls, %d instances, %d buffers created, %d uploads (%d bytes), %d transient discards",
+			stats.m_numDrawCalls, stats.m_numInstancesDrawn, stats.m_numBuffersCreated, stats.m_numBufferUploads, (int)stats.m_numBytesUploaded, stats.m_numTransientDiscards));
+	}
+	return false;
+}
+
+bool BasketballCourt::Command_CourtRenderStats(EventArgs& args)
+{
+	UNUSED(args);
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "No court to report on");
+		return false;
+	}
+	CourtRenderRecord const& record = court->m_courtRenderRecord;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Court rendering: %d static meshes uploaded once (%d bytes), %d static draws and %d immediate draws last frame",
+		record.m_numStaticMeshUploads, (int)record.m_numStaticMeshBytes, record.m_numStaticMeshDraws, record.m_numImmediateDraws));
+	std::string uploadLine = Stringf("  bytes queued for upload for court geometry last frame: %d", (int)record.m_numImmediateBytes);
+	g_theDevConsole->AddLine(record.m_numImmediateBytes > 0 ? DevConsole::ERROR : DevConsole::INFO_MINOR, uploadLine);
+	return false;
+}
+
+bool BasketballCourt::Command_RenderQueueStats(EventArgs& args)
+{
+	UNUSED(args);
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "No court to report on");
+		return false;
+	}
+	RenderQueueStats const& stats = court->m_renderQueueStats;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Render queue last frame (%s): %d packets, %d draws, %d state changes",
+		court->m_isRenderQueueSorted ? "sorted" : "unsorted", stats.m_numPackets, stats.m_numDraws, stats.GetNumStateChanges()));
+
+	// The same packets again in recording mode, both ways, so the two orders can be compared on this frame
+	RenderQueueStats recorded[2] = { court->m_renderQueue.Submit(nullptr, false), court->m_renderQueue.Submit(nullptr, true) };
+	char const* orderNames[2] = { "unsorted", "sorted" };
+	for (int i = 0; i < 2; i++)
+	{
+		RenderQueueStats const& record = recorded[i];
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %-8s %3d state changes: %d shader, %d texture, %d blend, %d depth, %d rasterizer, %d model constants",
+			orderNames[i], record.GetNumStateChanges(), record.m_numShaderBinds, record.m_numTextureBinds, record.m_numBlendChanges, record.m_numDepthChanges, record.m_numRasterizerChanges, record.m_numModelConstantUpdates));
+	}
+	if (recorded[0].m_numDraws != recorded[1].m_numDraws || recorded[0].m_numInstancesDrawn != recorded[1].m_numInstancesDrawn)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "  Sorting changed what gets drawn");
+	}
+	return false;
+}
+
+int BasketballCourt::GetNumObjectPoolPageAllocations() const
+{
+	return m_ballPool.GetNumPageAllocations() + m_propPool.GetNumPageAllocations() + m_playerPool.GetNumPageAllocations() + m_blockerPool.GetNumPageAllocations();
+}
@@ -1,5 +1,11 @@
 #pragma once
 #include "Game/GameCommon.hpp"
+#include "Game/BallPhysics.hpp"
+#include "Game/BallSlotMap.hpp"
+#include "Game/CourtColliders.hpp"
+#include "Game/DynamicAABBTree.hpp"
+#include "Game/FrustumCulling.hpp"
+#include "Game/ObjectPool.hpp"
 
 class Entity;
 class Player;
@@ -18,11 +24,112 @@ struct Hoop
 	AABB3 m_collider;
 	bool m_isColliding = false;
 };
+// Uniform XY grid over the court, rebuilt every fixed step. Balls are bucketed by cell with a counting
+// sort, so each cell lists its balls in m_balls dense order. Balls outside the court clamp to the border cells.
+struct BallGrid
+{
+	float m_cellSize = BALL_GRID_CELL_SIZE;
+	int m_numCellsX = 0;
+	int m_numCellsY = 0;
+	std::vector<int> m_cellStarts;
+	std::vector<int> m_cellCursors;
+	std::vector<int> m_ballIndices;
+	std::vector<int> m_ballCells;
+};
+
+// Two balls close enough at the start of a step that resolving them might push them apart, as dense indices into m_balls
+struct BallContactPair
+{
+	int m_ballA = -1;
+	int m_ballB = -1;
+};
+// Contact pairs grouped into islands that share no balls. Islands are resolved in parallel and each
+// keeps its pairs in global (a, b) order, so the result is the same as resolving every pair in order
+struct BallContactIslands
+{
+	std::vector<std::vector<BallContactPair>> m_pairsByChunk;
+	std::vector<std::vector<int>> m_candidatesByChunk; // scratch, kept so steps don't reallocate it
+	std::vector<BallContactPair> m_pairs;
+	std::vector<int> m_ballParents;
+	std::vector<int> m_islandOfBall;
+	std::vector<int> m_islandStarts;
+	std::vector<int> m_islandCursors;
+	std::vector<BallContactPair> m_islandPairs;
+	int m_numIslands = 0;
+	int m_largestIslandPairs = 0;
+	std::vector<unsigned char> m_isBallInIsland; // filled by the sleep pass
+};
+// Sounds can't be started from a worker, so parallel phases queue them per chunk and the main thread
+// plays them afterwards in chunk order, which is the order the serial loop used to play them in
+struct PhysicsSoundEvent
+{
+	Ball* m_ball = nullptr;
+	Blocker* m_blocker = nullptr;
+	SoundID m_sound = MISSING_SOUND_ID;
+};
+
+// What RenderBalls asked the renderer for, recorded whether or not there is a renderer to ask.
+// Mesh uploads count over the court's lifetime, everything else over the last RenderBalls call.
+struct BallRenderRecord
+{
+	int m_numMeshUploads = 0;
+	int m_numInstanceUploads = 0;
+	int m_numDrawCalls = 0;
+	int m_numInstances = 0;
+};
+
+// What DrawCourt asked the renderer for, recorded whether or not there is a renderer to ask.
+// Static mesh uploads count over the court's lifetime, everything else over the last DrawCourt call.
+struct CourtRenderRecord
+{
+	int m_numStaticMeshUploads = 0;
+	size_t m_numStaticMeshBytes = 0;
+	int m_numStaticMeshDraws = 0;
+	int m_numImmediateDraws = 0;
+	size_t m_numImmediateBytes = 0;
+};
+
+// What one camera sees of the court's entities, balls and blockers, as indexes into m_entityList,
+// m_balls (dense) and m_blockerList in ascending order. Blockers are only listed in OBSTACLE mode,
+// the only one that draws them. The court itself and the grid are never culled
+struct CourtVisibility
+{
+	std::vector<int> m_visibleEntities;
+	std::vector<int> m_visibleBalls;
+	std::vector<int> m_visibleBlockers;
+	int m_numEntities = 0;
+	int m_numBalls = 0;
+	int m_numBlockers = 0;
+	double m_cullSeconds = 0.0;
+
+	int GetNumTested() const;
+	int GetNumVisible() const;
+};
+
+// One piece of the world pass, recorded into its own queue. Pieces are listed in the order
+// BuildRenderQueue records them, so merging their queues in list order gives the serial queue
+enum class RenderRecordPiece
+{
+	PLAYER,
+	ENTITIES,
+	BALLS,
+	BLOCKERS,
+	GRID,
+	COURT
+};
+struct RenderRecordTask
+{
+	RenderRecordPiece m_piece = RenderRecordPiece::PLAYER;
+	int m_begin = 0;
+	int m_end = 0;
+};
+
 class BasketballCourt
 {
 public:
 
-	BasketballCourt();
+	// The ball state arrays are allocated up front for ballCapacity balls, capped at MAX_BALLS
+	explicit BasketballCourt(int ballCapacity = MAX_BALLS);
 	~BasketballCourt();
 
 	void Startup();
@@ -30,9 +137,16 @@ public:
 	void UpdatePhysics(float fixedDeltaSeconds);
 	void Render() const;
 	void Shutdown();
+	// Everything Render draws in the player's camera, without touching the renderer. Both builds cull
+	// against the player's camera first, unless culling is off
+	void BuildRenderQueue(RenderQueue& queue) const;
+	// The same queue, recorded in pieces by jobSystem's workers and merged in BuildRenderQueue's order.
+	// The ball instance upload and debug draws stay on the calling thread, neither is safe off it
+	void BuildRenderQueueParallel(RenderQueue& queue, JobSystem* jobSystem) const;
 
 	std::vector<Entity*> m_entityList;
-	std::vector<Ball*> m_ballList;
+	BallSlotMap m_balls;
+	BallStateArrays m_ballStates;
 	std::vector<Prop*> m_obstacleList;
 
 	Player* m_player = nullptr;
@@ -70,12 +184,15 @@ public:
 
 	// Prop
 	Prop* CreateProp(bool isGravityEnabled = false, float mass = 1.f, float height = 1.f, float radius = 1.f, Vec3 position = Vec3::ZERO, EulerAngles orientation = EulerAngles());
+	// Null once the court holds MAX_BALLS balls
 	Ball* CreateBall(Vec3 position = Vec3::ZERO, EulerAngles orientation = EulerAngles());
+	void DestroyBall(Ball* ball);
 	Player* CreatePlayer(Vec3 position = Vec3::ZERO, EulerAngles orientation = EulerAngles());
 	Blocker* CreateBlocker(BlockerType type, Vec3 position, float width, float minHeight = 0, float maxHeight = 10, float time = 2.f);
 
 	// Ball
 	GameRaycast3D RaycastVsBall(Vec3 startPos, Vec3 fwdNormal);
+	GameRaycast3D RaycastVsBallBruteForce(Vec3 startPos, Vec3 fwdNormal);
 	void PlayerCollisionWithWorld();
 
 	void DeleteAllBalls();
@@ -84,21 +201,127 @@ public:
 	void BounceBallsCourt();
 	void BounceBallsOffPlayer();
 	void BounceBallsOffBalls();
+	void BounceBallsOffBallsBruteForce();
+	void RebuildBallGrid();
+	void FindBallContactPairs();
+	void BuildBallContactIslands();
 	void BounceBallsOffBlockers();
 	bool BounceBallsOffBall(Ball* a, Ball* b);
-	void BounceBallOffFloor(Ball* ball);
-	void BounceBallOffHoop(Ball* ball);
-	void BounceBallOffBlocker(Ball* ball);
+	// Both take the ball's QueryStaticColliders result, queried once per step for the pair
+	void BounceBallOffFloor(Ball* ball, int const* colliderIndexes, int numColliders, std::vector<PhysicsSoundEvent>& soundEvents);
+	void BounceBallOffHoop(Ball* ball, int const* colliderIndexes, int numColliders, std::vector<PhysicsSoundEvent>& soundEvents);
+	void BounceBallOffBlocker(Ball* ball, std::vector<PhysicsSoundEvent>& soundEvents, std::vector<int>& blockerCandidates);
 	bool IsBallAScore(Ball* ball, Hoop* hoop);
 
 	void SonFormularForBallVsGroundCollisionResolve(Ball* ball);
 
+	BallGrid m_ballGrid;
+	std::vector<int> m_ballPairCandidates;
+
+	// Multithreaded physics. Every phase is split into the same chunks whether it runs on the JobSystem
+	// or on this thread, so both give bit-identical results
+	void RunPhysicsPhase(int count, int grain, std::function<void(int, int, int)> const& chunkFunction);
+	std::vector<PhysicsSoundEvent>& GetPhysicsSoundEvents(int chunkIndex);
+	void PlayPhysicsSoundEvents();
+
+	bool m_isPhysicsMultithreaded = true;
+	BallContactIslands m_ballContactIslands;
+	std::vector<std::vector<PhysicsSoundEvent>> m_physicsSoundEventsByChunk;
+
+	// Resting balls sleep until something touches or pushes them, balls in contact sleep and wake as an island
+	void UpdateBallSleep(float fixedDeltaSeconds);
+	bool m_isBallSleepEnabled = true;
+	int m_numAwakeBalls = 0;
+	int m_numSleepingBalls = 0;
+	static bool Command_BallSleepStats(EventArgs& args);
+
+	// Continuous collision for balls that move more than their radius in a step, so they can't pass
+	// through the boards, rims or blockers between two discrete checks at coarse fixed steps
+	void SweepFastBalls(float fixedDeltaSeconds);
+	void SweepBall(Ball* ball, float fixedDeltaSeconds, std::vector<int>& blockerCandidates);
+	bool m_isContinuousCollisionEnabled = true;
+
+	// Every ball shares one indexed sphere and draws in a single instanced call
+	void CreateBallMesh();
+	void BuildBallInstances() const;
+	void RenderBalls(RenderQueue& queue) const;
+	// RenderBalls in two halves: the first touches the renderer, the second only the queue
+	void UploadBallInstances() const;
+	void AddBallInstances(RenderQueue& queue) const;
+
+	std::vector<Vertex_PCU> m_ballMeshVertices;
+	std::vector<unsigned int> m_ballMeshIndices;
+	VertexBuffer* m_ballMeshVBO = nullptr;
+	IndexBuffer* m_ballMeshIBO = nullptr;
+	mutable VertexBuffer* m_ballInstanceVBO = nullptr;
+	mutable std::vector<ModelInstance> m_ballInstances;
+	mutable BallRenderRecord m_ballRenderRecord;
+	static bool Command_BallRenderStats(EventArgs& args);
+
+	// Static court geometry, rebuilt whenever the props that make it up change
+	void BuildStaticColliders();
+	int QueryStaticColliders(Ball const* ball, int* outIndexes) const;
+	CourtColliderBVH m_staticColliders;
+
+	// Blockers change height every frame, so they live in a tree of fat boxes that only reinserts the ones
+	// that outgrow theirs. Candidates are sorted back into m_blockerList order before a ball resolves them
+	void UpdateBlockerTree();
+	DynamicAABBTree m_blockerTree = DynamicAABBTree(BLOCKER_TREE_MARGIN);
+	std::vector<std::vector<int>> m_blockerCandidatesByChunk;
+	bool m_isBlockerTreeEnabled = true;
+
+	// Every ball, prop, player and blocker the court creates lives in these pools and goes when the court
+	// does. Destroyed objects leave their blocks behind, so an obstacle level change builds the next level's
+	// blockers in the last one's memory
+	ObjectPool<Ball> m_ballPool;
+	ObjectPool<Prop> m_propPool;
+	ObjectPool<Player> m_playerPool;
+	ObjectPool<Blocker> m_blockerPool;
+	int GetNumObjectPoolPageAllocations() const;
+
+	// Ball centers packed for RaycastVsBall in the ball grid's cell order, so nearby balls share tiles.
+	// Anything that moves, adds or removes balls marks it dirty and the next ray rebuilds it
+	void BuildBallRayBatch();
+	BallRayBatch m_ballRayBatch;
+	bool m_isBallRayBatchDirty = true;
+
 	// Field
 	void InitializeCourt();
-	void DrawCourt() const;
+	void DrawCourt(RenderQueue& queue) const;
+
+	// The floor, skybox and nets never change after InitializeCourt, so they go to the GPU once and every
+	// frame draws them by handle. A piece without a mesh falls back to an immediate draw
+	void CreateCourtMeshes();
+	void DrawCourtPiece(RenderQueue& queue, RenderDrawState const& state, StaticMesh const* mesh, std::vector<Vertex_PCU> const& vertexes, std::vector<unsigned int> const& indexes) const;
+	StaticMesh* m_courtMesh = nullptr;
+	StaticMesh* m_skyboxMesh = nullptr;
+	StaticMesh* m_netMesh = nullptr;
+	mutable CourtRenderRecord m_courtRenderRecord;
+	static bool Command_CourtRenderStats(EventArgs& args);
+
+	// The world pass is recorded into one queue and submitted once, sorted by state unless turned off
+	mutable RenderQueue m_renderQueue;
+	mutable RenderQueueStats m_renderQueueStats;
+	bool m_isRenderQueueSorted = true;
+	static bool Command_RenderQueueStats(EventArgs& args);
+
+	// Every entity, ball and blocker has a bounding sphere around its position, and whatever is entirely
+	// outside the camera's frustum isn't recorded at all. With culling off everything comes out visible
+	void BuildVisibility(Camera const& camera, JobSystem* jobSystem, CourtVisibility& out_visibility) const;
+	mutable CullingSpheres m_cullingSpheres;
+	mutable std::vector<unsigned char> m_cullingScratch;
+	mutable std::vector<int> m_visibleSpheres;
+	mutable CourtVisibility m_visibility;
+	bool m_isFrustumCullingEnabled = true;
+	static bool Command_CullingStats(EventArgs& args);
+
+	void RecordRenderTask(RenderRecordTask const& task, RenderQueue& queue) const;
+	mutable std::vector<RenderRecordTask> m_renderRecordTasks;
+	mutable std::vector<RenderQueue> m_renderRecordQueues;
+	bool m_isRenderRecordingParallel = true;
 
 	// DEBUG
-	void DrawGrid() const;
+	void DrawGrid(RenderQueue& queue) const;
 
 	// PLAYER
 	void RandomPlayerPosition();
@@ -106,4 +329,5 @@ public:
 	// OBSTACLE 
 
 	void SpawnRandomBlockers(int num);
+	void SpawnRandomBlockers(int num, RandomNumberGenerator& rng);
 };
\ No newline at end of file
@@ -1,13 +1,12 @@
 #include "Blocker.hpp"
 
 Blocker::Blocker(BasketballCourt* map, BlockerType type, Vec3 pos, float width, float minHeight, float maxHeight, float time)
-	:Entity(map), m_minHeight(minHeight), m_maxHeight(maxHeight)
+	:Entity(map), m_minHeight(minHeight), m_maxHeight(maxHeight), m_timer(time, Clock::s_theSystemClock)
 {
-	m_timer = new Timer(time, Clock::s_theSystemClock);
 	m_radius = width;
 	m_position = pos;
 	m_type = type;
-	m_timer->Start();
+	m_timer.Start();
 	if (type == BlockerType::STATIC_BLOCK)
 	{
 		m_height = maxHeight;
@@ -39,38 +38,38 @@ void Blocker::Update(float deltaSeconds)
 		return;
 		break;
 	case BlockerType::CONTINUOUS_BLOCK:
-		if (m_timer->DecrementPeriodIfElapsed())
+		if (m_timer.DecrementPeriodIfElapsed())
 		{
 			m_sign *= -1;
 		}
 
 		if (m_sign > 0)
 		{
-			m_height = Interpolate(m_minHeight, m_maxHeight, m_timer->GetElapsedFraction());
+			m_height = Interpolate(m_minHeight, m_maxHeight, m_timer.GetElapsedFraction());
 		}
 		else
 		{
-			m_height = Interpolate(m_maxHeight, m_minHeight, m_timer->GetElapsedFraction());
+			m_height = Interpolate(m_maxHeight, m_minHeight, m_timer.GetElapsedFraction());
 		}
 		break;
 	case BlockerType::TIMER_BLOCK:
-		if (m_timer->DecrementPeriodIfElapsed())
+		if (m_timer.DecrementPeriodIfElapsed())
 		{
 			m_sign *= -1;
 		}
 		if (m_sign > 0)
 		{
-			m_height = Interpolate(m_height, m_maxHeight, m_timer->GetElapsedFraction());
+			m_height = Interpolate(m_height, m_maxHeight, m_timer.GetElapsedFraction());
 		}
 		else
 		{
-			m_height = Interpolate(m_height, m_minHeight, m_timer->GetElapsedFraction());
+			m_height = Interpolate(m_height, m_minHeight, m_timer.GetElapsedFraction());
 		}
 		break;
 	}
 }
 
-void Blocker::Render() const
+void Blocker::Render(RenderQueue& queue) const
 {
 	std::vector<Vertex_PCU> verts;
 	if (g_debugDrawing)
@@ -80,20 +79,40 @@ void Blocker::Render() const
 
 	AddVertsForQuad3D(verts, Vec3(0, -m_radius, 0), Vec3(0, m_radius, 0), Vec3(0, -m_radius, m_height), Vec3(0, m_radius, m_height));
 
-	g_theRenderer->SetBlendMode(BlendMode::ALPHA);
-	g_theRenderer->SetDepthStencilMode(DepthMode::ENABLED);
-	g_theRenderer->BindTexture(m_texture);
-	g_theRenderer->SetModelConstants(GetModeMatrix(), m_color);
-	g_theRenderer->DrawVertexArray((int)verts.size(), verts.data());
+	// The picture is a single quad with see-through edges, seen from both sides
+	RenderDrawState state;
+	state.m_pass = RenderPass::TRANSLUCENT;
+	state.m_blendMode = BlendMode::ALPHA;
+	state.m_texture = m_texture;
+	state.m_rasterizerMode = RasterizerMode::SOLID_CULL_NONE;
+	state.m_modelMatrix = GetModeMatrix();
+	state.m_modelColor = m_color;
+	queue.AddVertexArray(state, verts.size(), verts.data());
+}
+
+float Blocker::GetBoundingRadius() const
+{
+	// The debug box is the largest thing drawn, GetBounds is the same box around m_position
+	AABB3 bounds = GetBounds();
+	return (bounds.m_maxs - bounds.m_mins).GetLength() * 0.5f;
 }
 
 Vec3 Blocker::GetNearestPoint(Vec3 const point)
 {
-	return GetNearestPointOnAABB3D(point, AABB3(m_position, m_height, 1, m_radius));
+	return GetNearestPointOnAABB3D(point, GetBounds());
+}
+
+AABB3 Blocker::GetBounds() const
+{
+	return AABB3(m_position, m_height, 1, m_radius);
 }
 
 void Blocker::PlaySound(SoundID sound)
 {
+	if (!g_theAudio)
+	{
+		return;
+	}
 	float vol = g_gameConfigBlackboard.GetValue("sound", 1.f);
 	if (g_gameConfigBlackboard.GetValue("debugMuteAll", false))
 	{
@@ -1,6 +1,7 @@
 #pragma once
 #include "Game/GameCommon.hpp"
 #include "Game/Entity.hpp"
+#include "Engine/Core/Timer.hpp"
 
 enum class BlockerType
 {
@@ -17,8 +18,10 @@ public:
 	virtual ~Blocker();
 	
 	virtual void Update(float deltaSeconds) override;
-	virtual void Render() const override;
+	virtual void Render(RenderQueue& queue) const override;
+	virtual float GetBoundingRadius() const override;
 	Vec3 GetNearestPoint(Vec3 const point);
+	AABB3 GetBounds() const;
 
 	void PlaySound(SoundID sound);
 public:
@@ -27,7 +30,8 @@ public:
 	int m_sign = 1;
 
 	BlockerType m_type = BlockerType::STATIC_BLOCK;
-	Timer* m_timer = nullptr;
+	Timer m_timer;
 	Rgba8						m_color = Rgba8::COLOR_WHITE;
 	Texture*					m_texture = nullptr;
+	int							m_proxyId = -1;
 };
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "Game/CourtColliders.hpp"
+#include <algorithm>
+
+// Planes are infinite, their bounds only need to cover everywhere a ball can be before it is culled
+constexpr float COURT_PLANE_BOUNDS_EXTENT = 1000.f;
+constexpr int MAX_COURT_COLLIDERS_PER_LEAF = 2;
+constexpr int MAX_COURT_BVH_DEPTH = 64;
+// Past a cylinder's rim the swept surface is a torus, closed in on a step at a time until this near
+constexpr float RIM_SWEEP_CONTACT_TOLERANCE = 0.001f;
+constexpr int MAX_RIM_SWEEP_STEPS = 32;
+
+namespace
+{
+	// Inclusive, unlike DoAABBsOverlap3D, so a zero-thickness plane slab still gets hit
+	bool DoAABBsTouch3D(AABB3 const& boxA, AABB3 const& boxB)
+	{
+		return boxA.m_mins.x <= boxB.m_maxs.x && boxA.m_maxs.x >= boxB.m_mins.x
+			&& boxA.m_mins.y <= boxB.m_maxs.y && boxA.m_maxs.y >= boxB.m_mins.y
+			&& boxA.m_mins.z <= boxB.m_maxs.z && boxA.m_maxs.z >= boxB.m_mins.z;
+	}
+
+	AABB3 GetUnion(AABB3 const& boxA, AABB3 const& boxB)
+	{
+		return AABB3(Vec3(fminf(boxA.m_mins.x, boxB.m_mins.x), fminf(boxA.m_mins.y, boxB.m_mins.y), fminf(boxA.m_mins.z, boxB.m_mins.z)),
+			Vec3(fmaxf(boxA.m_maxs.x, boxB.m_maxs.x), fmaxf(boxA.m_maxs.y, boxB.m_maxs.y), fmaxf(boxA.m_maxs.z, boxB.m_maxs.z)));
+	}
+
+	float GetAxis(Vec3 const& vec, int axis)
+	{
+		return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+	}
+
+	void SetAxis(Vec3& vec, int axis, float value)
+	{
+		(axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z)) = value;
+	}
+
+	// Narrows [entry, exit] to the part of the sweep that is between min and max along one axis
+	bool ClipSweepToSlab(float start, float displacement, float min, float max, float& entry, float& exit)
+	{
+		if (displacement == 0.f)
+		{
+			return start >= min && start <= max;
+		}
+		float oneOverDisplacement = 1.f / displacement;
+		float slabEntry = (min - start) * oneOverDisplacement;
+		float slabExit = (max - start) * oneOverDisplacement;
+		if (slabEntry > slabExit)
+		{
+			float temp = slabEntry;
+			slabEntry = slabExit;
+			slabExit = temp;
+		}
+		entry = slabEntry > entry ? slabEntry : entry;
+		exit = slabExit < exit ? slabExit : exit;
+		return entry <= exit;
+	}
+
+	float GetImpactFraction(float entry, float exit)
+	{
+		if (entry > exit || entry <= 0.f || entry > 1.f)
+		{
+			return -1.f;
+		}
+		return entry;
+	}
+
+	float GetEarlierImpactFraction(float fractionA, float fractionB)
+	{
+		if (fractionA <= 0.f)
+		{
+			return fractionB > 0.f ? fractionB : -1.f;
+		}
+		return fractionB > 0.f && fractionB < fractionA ? fractionB : fractionA;
+	}
+
+	// First touch of a sphere sweep against a point, -1 if it doesn't happen within [0, 1]
+	float GetSweptSphereVsPointImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius, Vec3 const& point)
+	{
+		Vec3 fromPoint = start - point;
+		float a = DotProduct3D(displacement, displacement);
+		if (a == 0.f)
+		{
+			return -1.f;
+		}
+		float b = 2.f * DotProduct3D(fromPoint, displacement);
+		float c = DotProduct3D(fromPoint, fromPoint) - radius * radius;
+		float discriminant = b * b - 4.f * a * c;
+		if (discriminant < 0.f)
+		{
+			return -1.f;
+		}
+		float impactFraction = (-b - sqrtf(discriminant)) / (2.f * a);
+		return impactFraction >= 0.f && impactFraction <= 1.f ? impactFraction : -1.f;
+	}
+
+	// First touch of a sphere sweep against the capsule around a box edge running along axis from segmentStart to segmentEnd
+	float GetSweptSphereVsBoxEdgeImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius, Vec3 const& segmentStart, Vec3 const& segmentEnd, int axis)
+	{
+		int axisU = (axis + 1) % 3;
+		int axisV = (axis + 2) % 3;
+		float fromEdgeU = GetAxis(start, axisU) - GetAxis(segmentStart, axisU);
+		float fromEdgeV = GetAxis(start, axisV) - GetAxis(segmentStart, axisV);
+		float displacementU = GetAxis(displacement, axisU);
+		float displacementV = GetAxis(displacement, axisV);
+		float a = displacementU * displacementU + displacementV * displacementV;
+		if (a > 0.f)
+		{
+			float b = 2.f * (fromEdgeU * displacementU + fromEdgeV * displacementV);
+			float c = fromEdgeU * fromEdgeU + fromEdgeV * fromEdgeV - radius * radius;
+			float discriminant = b * b - 4.f * a * c;
+			if (discriminant >= 0.f)
+			{
+				float impactFraction = (-b - sqrtf(discriminant)) / (2.f * a);
+				float alongEdge = GetAxis(start, axis) + GetAxis(displacement, axis) * impactFraction;
+				if (impactFraction >= 0.f && impactFraction <= 1.f && alongEdge >= GetAxis(segmentStart, axis) && alongEdge <= GetAxis(segmentEnd, axis))
+				{
+					return impactFraction;
+				}
+			}
+		}
+
+		// Missed the side, so it can only touch one of the rounded ends
+		return GetEarlierImpactFraction(GetSweptSphereVsPointImpactFraction(start, displacement, radius, segmentStart),
+			GetSweptSphereVsPointImpactFraction(start, displacement, radius, segmentEnd));
+	}
+}
+
+float GetSweptSphereVsAABB3DImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius, AABB3 const& box)
+{
+	float entry = -FLT_MAX;
+	float exit = FLT_MAX;
+	if (!ClipSweepToSlab(start.x, displacement.x, box.m_mins.x - radius, box.m_maxs.x + radius, entry, exit)
+		|| !ClipSweepToSlab(start.y, displacement.y, box.m_mins.y - radius, box.m_maxs.y + radius, entry, exit)
+		|| !ClipSweepToSlab(start.z, displacement.z, box.m_mins.z - radius, box.m_maxs.z + radius, entry, exit))
+	{
+		return -1.f;
+	}
+	float enterFraction = entry > 0.f ? entry : 0.f;
+	if (enterFraction > exit || enterFraction > 1.f)
+	{
+		return -1.f;
+	}
+
+	// The grown box is only the real swept surface over the faces. Entering it past two or three of the
+	// box's faces is beyond an edge or corner, where the surface is rounded by capsules around the edges.
+	Vec3 enterPosition = start + displacement * enterFraction;
+	int outsideAxes = 0;
+	int numOutsideAxes = 0;
+	Vec3 corner = box.m_mins;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float position = GetAxis(enterPosition, axis);
+		if (position < GetAxis(box.m_mins, axis) || position > GetAxis(box.m_maxs, axis))
+		{
+			outsideAxes |= 1 << axis;
+			numOutsideAxes++;
+		}
+		if (position > GetAxis(box.m_maxs, axis))
+		{
+			SetAxis(corner, axis, GetAxis(box.m_maxs, axis));
+		}
+	}
+	if (numOutsideAxes < 2)
+	{
+		return GetImpactFraction(entry, exit);
+	}
+	if (entry <= 0.f && GetDistanceSquared3D(start, GetNearestPointOnAABB3D(start, box)) <= radius * radius)
+	{
+		return -1.f;
+	}
+
+	// Beyond an edge only the edge along the one axis still inside can be hit, beyond a corner any of its three
+	float impactFraction = -1.f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (numOutsideAxes == 3 || (outsideAxes & (1 << axis)) == 0)
+		{
+			Vec3 segmentStart = corner;
+			Vec3 segmentEnd = corner;
+			SetAxis(segmentStart, axis, GetAxis(box.m_mins, axis));
+			SetAxis(segmentEnd, axis, GetAxis(box.m_maxs, axis));
+			impactFraction = GetEarlierImpactFraction(impactFraction, GetSweptSphereVsBoxEdgeImpactFraction(start, displacement, radius, segmentStart, segmentEnd, axis));
+		}
+	}
+	return impactFraction;
+}
+
+Vec3 CourtCollider::GetNearestPoint(Vec3 const& referencePosition) const
+{
+	switch (m_shape)
+	{
+	case CourtColliderShape::PLANE:
+		return m_plane.GetNearestPoint(referencePosition);
+	case CourtColliderShape::Z_CYLINDER:
+		return GetNearestPointOnZCynlinder3D(referencePosition, m_cylinderCenterXY, m_cylinderMinMaxZ, m_cylinderRadius);
+	case CourtColliderShape::BOX:
+	default:
+		return GetNearestPointOnAABB3D(referencePosition, m_box);
+	}
+}
+
+float CourtCollider::GetSweptSphereImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius) const
+{
+	switch (m_shape)
+	{
+	case CourtColliderShape::PLANE:
+	{
+		// Either side of the plane, whichever the sphere starts on
+		float startDistance = DotProduct3D(start, m_plane.m_normal) - m_plane.m_distanceFromOrigin;
+		float endDistance = DotProduct3D(start + displacement, m_plane.m_normal) - m_plane.m_distanceFromOrigin;
+		if (startDistance > radius && endDistance < radius)
+		{
+			return (startDistance - radius) / (startDistance - endDistance);
+		}
+		if (startDistance < -radius && endDistance > -radius)
+		{
+			return (-radius - startDistance) / (endDistance - startDistance);
+		}
+		return -1.f;
+	}
+	case CourtColliderShape::Z_CYLINDER:
+	{
+		// The caps are grown like a box and the side as a circle of the combined radius, which is exact
+		// everywhere but past the rim
+		float entry = -FLT_MAX;
+		float exit = FLT_MAX;
+		if (!ClipSweepToSlab(start.z, displacement.z, m_cylinderMinMaxZ.m_min - radius, m_cylinderMinMaxZ.m_max + radius, entry, exit))
+		{
+			return -1.f;
+		}
+		float combinedRadius = m_cylinderRadius + radius;
+		Vec2 fromCenter = Vec2(start.x, start.y) - m_cylinderCenterXY;
+		Vec2 displacementXY = Vec2(displacement.x, displacement.y);
+		float a = DotProduct2D(displacementXY, displacementXY);
+		float b = 2.f * DotProduct2D(fromCenter, displacementXY);
+		float c = DotProduct2D(fromCenter, fromCenter) - combinedRadius * combinedRadius;
+		if (a == 0.f)
+		{
+			if (c > 0.f)
+			{
+				return -1.f;
+			}
+		}
+		else
+		{
+			float discriminant = b * b - 4.f * a * c;
+			if (discriminant < 0.f)
+			{
+				return -1.f;
+			}
+			float root = sqrtf(discriminant);
+			float circleEntry = (-b - root) / (2.f * a);
+			float circleExit = (-b + root) / (2.f * a);
+			entry = circleEntry > entry ? circleEntry : entry;
+			exit = circleExit < exit ? circleExit : exit;
+		}
+		float enterFraction = entry > 0.f ? entry : 0.f;
+		if (enterFraction > exit || enterFraction > 1.f)
+		{
+			return -1.f;
+		}
+		Vec3 enterPosition = start + displacement * enterFraction;
+		bool isPastCaps = enterPosition.z < m_cylinderMinMaxZ.m_min || enterPosition.z > m_cylinderMinMaxZ.m_max;
+		bool isPastSide = (Vec2(enterPosition.x, enterPosition.y) - m_cylinderCenterXY).GetLengthSquared() > m_cylinderRadius * m_cylinderRadius;
+		if (!isPastCaps || !isPastSide)
+		{
+			return GetImpactFraction(entry, exit);
+		}
+
+		// Past the rim, step along the sweep by the remaining gap, which can never overshoot the surface
+		float displacementLength = displacement.GetLength();
+		if (displacementLength == 0.f)
+		{
+			return -1.f;
+		}
+		float impactFraction = enterFraction;
+		for (int stepIndex = 0; stepIndex < MAX_RIM_SWEEP_STEPS; stepIndex++)
+		{
+			Vec3 position = start + displacement * impactFraction;
+			float gap = GetDistance3D(position, GetNearestPoint(position)) - radius;
+			if (gap <= RIM_SWEEP_CONTACT_TOLERANCE)
+			{
+				return impactFraction > 0.f ? impactFraction : -1.f;
+			}
+			impactFraction += gap / displacementLength;
+			if (impactFraction > exit || impactFraction > 1.f)
+			{
+				return -1.f;
+			}
+		}
+		return -1.f;
+	}
+	case CourtColliderShape::BOX:
+	default:
+		return GetSweptSphereVsAABB3DImpactFraction(start, displacement, radius, m_box);
+	}
+}
+
+void CourtColliderBVH::Clear()
+{
+	m_colliders.clear();
+	m_leafColliders.clear();
+	m_nodes.clear();
+}
+
+int CourtColliderBVH::AddPlane(CourtColliderTag tag, Plane3 const& plane, float elasticity, float friction)
+{
+	CourtCollider collider;
+	collider.m_tag = tag;
+	collider.m_shape = CourtColliderShape::PLANE;
+	collider.m_plane = plane;
+	collider.m_elasticity = elasticity;
+	collider.m_friction = friction;
+
+	// Thin along the normal's axis, effectively unbounded along the others. Court planes are axis aligned.
+	Vec3 pointOnPlane = plane.m_normal * plane.m_distanceFromOrigin;
+	Vec3 halfExtents = Vec3(fabsf(plane.m_normal.x) > 0.999f ? 0.f : COURT_PLANE_BOUNDS_EXTENT,
+		fabsf(plane.m_normal.y) > 0.999f ? 0.f : COURT_PLANE_BOUNDS_EXTENT,
+		fabsf(plane.m_normal.z) > 0.999f ? 0.f : COURT_PLANE_BOUNDS_EXTENT);
+	collider.m_bounds = AABB3(pointOnPlane - halfExtents, pointOnPlane + halfExtents);
+
+	m_colliders.push_back(collider);
+	return (int)m_colliders.size() - 1;
+}
+
+int CourtColliderBVH::AddZCylinder(CourtColliderTag tag, Vec2 const& centerXY, FloatRange const& minMaxZ, float radius, float elasticity, float friction)
+{
+	CourtCollider collider;
+	collider.m_tag = tag;
+	collider.m_shape = CourtColliderShape::Z_CYLINDER;
+	collider.m_cylinderCenterXY = centerXY;
+	collider.m_cylinderMinMaxZ = minMaxZ;
+	collider.m_cylinderRadius = radius;
+	collider.m_elasticity = elasticity;
+	collider.m_friction = friction;
+	collider.m_bounds = AABB3(Vec3(centerXY.x - radius, centerXY.y - radius, minMaxZ.m_min), Vec3(centerXY.x + radius, centerXY.y + radius, minMaxZ.m_max));
+
+	m_colliders.push_back(collider);
+	return (int)m_colliders.size() - 1;
+}
+
+int CourtColliderBVH::AddBox(CourtColliderTag tag, AABB3 const& box, float elasticity, float friction)
+{
+	CourtCollider collider;
+	collider.m_tag = tag;
+	collider.m_shape = CourtColliderShape::BOX;
+	collider.m_box = box;
+	collider.m_bounds = box;
+	collider.m_elasticity = elasticity;
+	collider.m_friction = friction;
+
+	m_colliders.push_back(collider);
+	return (int)m_colliders.size() - 1;
+}
+
+void CourtColliderBVH::Build()
+{
+	m_nodes.clear();
+	m_leafColliders.resize(m_colliders.size());
+	for (int i = 0; i < (int)m_colliders.size(); i++)
+	{
+		m_leafColliders[i] = i;
+	}
+	if (!m_colliders.empty())
+	{
+		BuildNode(0, (int)m_colliders.size());
+	}
+}
+
+int CourtColliderBVH::BuildNode(int firstLeaf, int numLeaves)
+{
+	int nodeIndex = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+
+	AABB3 bounds = m_colliders[m_leafColliders[firstLeaf]].m_bounds;
+	AABB3 centerBounds = AABB3(bounds.GetCenter(), bounds.GetCenter());
+	for (int i = firstLeaf + 1; i < firstLeaf + numLeaves; i++)
+	{
+		AABB3 const& colliderBounds = m_colliders[m_leafColliders[i]].m_bounds;
+		bounds = GetUnion(bounds, colliderBounds);
+		centerBounds.StretchToIncludePoint(colliderBounds.GetCenter());
+	}
+	m_nodes[nodeIndex].m_bounds = bounds;
+
+	if (numLeaves <= MAX_COURT_COLLIDERS_PER_LEAF)
+	{
+		m_nodes[nodeIndex].m_firstLeaf = firstLeaf;
+		m_nodes[nodeIndex].m_numLeaves = numLeaves;
+		return nodeIndex;
+	}
+
+	// Median split along the axis the collider centers are most spread out on
+	Vec3 centerSpread = centerBounds.GetDimension();
+	int axis = 0;
+	if (centerSpread.y > centerSpread.x && centerSpread.y >= centerSpread.z)
+	{
+		axis = 1;
+	}
+	else if (centerSpread.z > centerSpread.x && centerSpread.z > centerSpread.y)
+	{
+		axis = 2;
+	}
+	int numLeft = numLeaves / 2;
+	std::nth_element(m_leafColliders.begin() + firstLeaf, m_leafColliders.begin() + firstLeaf + numLeft, m_leafColliders.begin() + firstLeaf + numLeaves,
+		[this, axis](int a, int b)
+		{
+			return GetAxis(m_colliders[a].m_bounds.GetCenter(), axis) < GetAxis(m_colliders[b].m_bounds.GetCenter(), axis);
+		});
+
+	int leftChild = BuildNode(firstLeaf, numLeft);
+	int rightChild = BuildNode(firstLeaf + numLeft, numLeaves - numLeft);
+	m_nodes[nodeIndex].m_leftChild = leftChild;
+	m_nodes[nodeIndex].m_rightChild = rightChild;
+	return nodeIndex;
+}
+
+int CourtColliderBVH::Query(AABB3 const& queryBounds, int* outIndexes, int maxIndexes) const
+{
+	if (m_nodes.empty())
+	{
+		return 0;
+	}
+
+	int numFound = 0;
+	int stack[MAX_COURT_BVH_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		Node const& node = m_nodes[stack[--stackSize]];
+		if (!DoAABBsTouch3D(node.m_bounds, queryBounds))
+		{
+			continue;
+		}
+		if (node.m_leftChild < 0)
+		{
+			for (int i = node.m_firstLeaf; i < node.m_firstLeaf + node.m_numLeaves; i++)
+			{
+				int colliderIndex = m_leafColliders[i];
+				if (numFound < maxIndexes && DoAABBsTouch3D(m_colliders[colliderIndex].m_bounds, queryBounds))
+				{
+					outIndexes[numFound++] = colliderIndex;
+				}
+			}
+			continue;
+		}
+		GUARANTEE_OR_DIE(stackSize + 2 <= MAX_COURT_BVH_DEPTH, "Court collider BVH is too deep");
+		stack[stackSize++] = node.m_rightChild;
+		stack[stackSize++] = node.m_leftChild;
+	}
+
+	// Insertion sort, a ball only ever touches a handful of colliders
+	for (int i = 1; i < numFound; i++)
+	{
+		int index = outIndexes[i];
+		int j = i - 1;
+		while (j >= 0 && outIndexes[j] > index)
+		{
+			outIndexes[j + 1] = outIndexes[j];
+			j--;
+		}
+		outIndexes[j + 1] = index;
+	}
+	return numFound;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/AABB3.hpp"
+#include "Engine/Math/Plane3.hpp"
+#include "Engine/Math/FloatRange.hpp"
+
+constexpr int MAX_COURT_COLLIDER_CANDIDATES = 32;
+
+enum class CourtColliderTag
+{
+	FLOOR,
+	WALL,
+	POLE,
+	BOARD,
+	RIM,
+	COUNT
+};
+
+enum class CourtColliderShape
+{
+	PLANE,
+	Z_CYLINDER,
+	BOX
+};
+
+// One piece of static court geometry. Balls bounce off GetNearestPoint with m_elasticity and m_friction.
+struct CourtCollider
+{
+	CourtColliderTag m_tag = CourtColliderTag::FLOOR;
+	CourtColliderShape m_shape = CourtColliderShape::BOX;
+	Plane3 m_plane;
+	Vec2 m_cylinderCenterXY;
+	FloatRange m_cylinderMinMaxZ;
+	float m_cylinderRadius = 0.f;
+	AABB3 m_box;
+	AABB3 m_bounds;
+	float m_elasticity = 0.7f;
+	float m_friction = 0.1f;
+
+	Vec3 GetNearestPoint(Vec3 const& referencePosition) const;
+	float GetSweptSphereImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius) const;
+};
+
+// Fraction of displacement at which a sphere moving from start first touches the box, or -1 if it doesn't.
+// Exact against the box rounded by the radius, so edges and corners are hit where the sphere really touches
+// them. A sphere already touching at start also returns -1, resolving that is the discrete bounce's job.
+float GetSweptSphereVsAABB3DImpactFraction(Vec3 const& start, Vec3 const& displacement, float radius, AABB3 const& box);
+
+// Bounding volume hierarchy over the static colliders, built once after the court is laid out.
+// Queries return collider indexes in the order they were added, which is the order balls resolve them in.
+class CourtColliderBVH
+{
+public:
+	void Clear();
+	int AddPlane(CourtColliderTag tag, Plane3 const& plane, float elasticity, float friction);
+	int AddZCylinder(CourtColliderTag tag, Vec2 const& centerXY, FloatRange const& minMaxZ, float radius, float elasticity, float friction);
+	int AddBox(CourtColliderTag tag, AABB3 const& box, float elasticity, float friction);
+	void Build();
+
+	// Fills outIndexes with every collider whose bounds touch queryBounds, in ascending index order
+	int Query(AABB3 const& queryBounds, int* outIndexes, int maxIndexes) const;
+
+	CourtCollider const& GetCollider(int index) const { return m_colliders[index]; }
+	int GetNumColliders() const { return (int)m_colliders.size(); }
+	int GetNumNodes() const { return (int)m_nodes.size(); }
+
+private:
+	struct Node
+	{
+		AABB3 m_bounds;
+		int m_leftChild = -1;
+		int m_rightChild = -1;
+		int m_firstLeaf = 0;
+		int m_numLeaves = 0;
+	};
+
+	int BuildNode(int firstLeaf, int numLeaves);
+
+	std::vector<CourtCollider> m_colliders;
+	std::vector<int> m_leafColliders;
+	std::vector<Node> m_nodes;
+};
@@ -0,0 +1,373 @@
+#include "Game/DynamicAABBTree.hpp"
+
+constexpr int MAX_DYNAMIC_AABB_TREE_QUERY_STACK = 256;
+
+namespace
+{
+	AABB3 GetUnion(AABB3 const& boxA, AABB3 const& boxB)
+	{
+		return AABB3(Vec3(fminf(boxA.m_mins.x, boxB.m_mins.x), fminf(boxA.m_mins.y, boxB.m_mins.y), fminf(boxA.m_mins.z, boxB.m_mins.z)),
+			Vec3(fmaxf(boxA.m_maxs.x, boxB.m_maxs.x), fmaxf(boxA.m_maxs.y, boxB.m_maxs.y), fmaxf(boxA.m_maxs.z, boxB.m_maxs.z)));
+	}
+
+	float GetSurfaceArea(AABB3 const& box)
+	{
+		Vec3 dimensions = box.GetDimension();
+		return 2.f * (dimensions.x * dimensions.y + dimensions.y * dimensions.z + dimensions.z * dimensions.x);
+	}
+
+	bool DoesContain(AABB3 const& outer, AABB3 const& inner)
+	{
+		return outer.m_mins.x <= inner.m_mins.x && outer.m_mins.y <= inner.m_mins.y && outer.m_mins.z <= inner.m_mins.z
+			&& outer.m_maxs.x >= inner.m_maxs.x && outer.m_maxs.y >= inner.m_maxs.y && outer.m_maxs.z >= inner.m_maxs.z;
+	}
+
+	bool DoAABBsTouch3D(AABB3 const& boxA, AABB3 const& boxB)
+	{
+		return boxA.m_mins.x <= boxB.m_maxs.x && boxA.m_maxs.x >= boxB.m_mins.x
+			&& boxA.m_mins.y <= boxB.m_maxs.y && boxA.m_maxs.y >= boxB.m_mins.y
+			&& boxA.m_mins.z <= boxB.m_maxs.z && boxA.m_maxs.z >= boxB.m_mins.z;
+	}
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin)
+	:m_margin(margin)
+{
+}
+
+void DynamicAABBTree::Clear()
+{
+	m_nodes.clear();
+	m_root = -1;
+	m_freeList = -1;
+	m_numProxies = 0;
+	m_numReinsertions = 0;
+}
+
+int DynamicAABBTree::CreateProxy(AABB3 const& tightBounds, int userData)
+{
+	int proxyId = AllocateNode();
+	Vec3 margin = Vec3(m_margin, m_margin, m_margin);
+	m_nodes[proxyId].m_bounds = AABB3(tightBounds.m_mins - margin, tightBounds.m_maxs + margin);
+	m_nodes[proxyId].m_userData = userData;
+	m_nodes[proxyId].m_height = 0;
+	InsertLeaf(proxyId);
+	m_numProxies++;
+	return proxyId;
+}
+
+void DynamicAABBTree::DestroyProxy(int proxyId)
+{
+	GUARANTEE_OR_DIE(proxyId >= 0 && proxyId < (int)m_nodes.size() && m_nodes[proxyId].IsLeaf(), "Destroying a node that is not a proxy");
+	RemoveLeaf(proxyId);
+	FreeNode(proxyId);
+	m_numProxies--;
+}
+
+bool DynamicAABBTree::MoveProxy(int proxyId, AABB3 const& tightBounds)
+{
+	GUARANTEE_OR_DIE(proxyId >= 0 && proxyId < (int)m_nodes.size() && m_nodes[proxyId].IsLeaf(), "Moving a node that is not a proxy");
+	// Also refit when the proxy has shrunk well inside its fat box, so a blocker that drops back down
+	// doesn't keep matching queries at its old height
+	Vec3 margin = Vec3(m_margin, m_margin, m_margin);
+	AABB3 const& fatBounds = m_nodes[proxyId].m_bounds;
+	AABB3 largestFatBounds = AABB3(tightBounds.m_mins - margin * 4.f, tightBounds.m_maxs + margin * 4.f);
+	if (DoesContain(fatBounds, tightBounds) && DoesContain(largestFatBounds, fatBounds))
+	{
+		return false;
+	}
+
+	RemoveLeaf(proxyId);
+	m_nodes[proxyId].m_bounds = AABB3(tightBounds.m_mins - margin, tightBounds.m_maxs + margin);
+	InsertLeaf(proxyId);
+	m_numReinsertions++;
+	return true;
+}
+
+void DynamicAABBTree::Query(AABB3 const& queryBounds, std::vector<int>& outUserData) const
+{
+	if (m_root < 0)
+	{
+		return;
+	}
+
+	int stack[MAX_DYNAMIC_AABB_TREE_QUERY_STACK];
+	int stackSize = 0;
+	stack[stackSize++] = m_root;
+	while (stackSize > 0)
+	{
+		Node const& node = m_nodes[stack[--stackSize]];
+		if (!DoAABBsTouch3D(node.m_bounds, queryBounds))
+		{
+			continue;
+		}
+		if (node.IsLeaf())
+		{
+			outUserData.push_back(node.m_userData);
+			continue;
+		}
+		GUARANTEE_OR_DIE(stackSize + 2 <= MAX_DYNAMIC_AABB_TREE_QUERY_STACK, "Dynamic AABB tree is too deep to query");
+		stack[stackSize++] = node.m_child1;
+		stack[stackSize++] = node.m_child2;
+	}
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+	int nodeIndex = m_freeList;
+	if (nodeIndex >= 0)
+	{
+		m_freeList = m_nodes[nodeIndex].m_nextFree;
+		m_nodes[nodeIndex] = Node();
+	}
+	else
+	{
+		nodeIndex = (int)m_nodes.size();
+		m_nodes.push_back(Node());
+	}
+	m_nodes[nodeIndex].m_height = 0;
+	return nodeIndex;
+}
+
+void DynamicAABBTree::FreeNode(int nodeIndex)
+{
+	m_nodes[nodeIndex].m_nextFree = m_freeList;
+	m_nodes[nodeIndex].m_height = -1;
+	m_freeList = nodeIndex;
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+	if (m_root < 0)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = -1;
+		return;
+	}
+
+	// Walk down towards the sibling that makes the tree's total surface area grow the least
+	AABB3 leafBounds = m_nodes[leaf].m_bounds;
+	int index = m_root;
+	while (!m_nodes[index].IsLeaf())
+	{
+		Node const& node = m_nodes[index];
+		float area = GetSurfaceArea(node.m_bounds);
+		float combinedArea = GetSurfaceArea(GetUnion(node.m_bounds, leafBounds));
+
+		// Cost of pairing the leaf with this node, and the growth every ancestor below here pays anyway
+		float cost = 2.f * combinedArea;
+		float inheritanceCost = 2.f * (combinedArea - area);
+
+		float childCosts[2];
+		int children[2] = { node.m_child1, node.m_child2 };
+		for (int childIndex = 0; childIndex < 2; childIndex++)
+		{
+			Node const& child = m_nodes[children[childIndex]];
+			float unionArea = GetSurfaceArea(GetUnion(leafBounds, child.m_bounds));
+			childCosts[childIndex] = (child.IsLeaf() ? unionArea : unionArea - GetSurfaceArea(child.m_bounds)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	int sibling = index;
+	int oldParent = m_nodes[sibling].m_parent;
+	int newParent = AllocateNode();
+	m_nodes[newParent].m_parent = oldParent;
+	m_nodes[newParent].m_bounds = GetUnion(leafBounds, m_nodes[sibling].m_bounds);
+	m_nodes[newParent].m_height = m_nodes[sibling].m_height + 1;
+	m_nodes[newParent].m_child1 = sibling;
+	m_nodes[newParent].m_child2 = leaf;
+	m_nodes[sibling].m_parent = newParent;
+	m_nodes[leaf].m_parent = newParent;
+
+	if (oldParent >= 0)
+	{
+		if (m_nodes[oldParent].m_child1 == sibling)
+		{
+			m_nodes[oldParent].m_child1 = newParent;
+		}
+		else
+		{
+			m_nodes[oldParent].m_child2 = newParent;
+		}
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	RefitAncestors(m_nodes[leaf].m_parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	int parent = m_nodes[leaf].m_parent;
+	int grandParent = m_nodes[parent].m_parent;
+	int sibling = m_nodes[parent].m_child1 == leaf ? m_nodes[parent].m_child2 : m_nodes[parent].m_child1;
+
+	if (grandParent >= 0)
+	{
+		if (m_nodes[grandParent].m_child1 == parent)
+		{
+			m_nodes[grandParent].m_child1 = sibling;
+		}
+		else
+		{
+			m_nodes[grandParent].m_child2 = sibling;
+		}
+		m_nodes[sibling].m_parent = grandParent;
+		FreeNode(parent);
+		RefitAncestors(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].m_parent = -1;
+		FreeNode(parent);
+	}
+	m_nodes[leaf].m_parent = -1;
+}
+
+void DynamicAABBTree::RefitAncestors(int nodeIndex)
+{
+	while (nodeIndex >= 0)
+	{
+		nodeIndex = Balance(nodeIndex);
+		Node& node = m_nodes[nodeIndex];
+		Node const& child1 = m_nodes[node.m_child1];
+		Node const& child2 = m_nodes[node.m_child2];
+		node.m_height = 1 + (child1.m_height > child2.m_height ? child1.m_height : child2.m_height);
+		node.m_bounds = GetUnion(child1.m_bounds, child2.m_bounds);
+		nodeIndex = node.m_parent;
+	}
+}
+
+// Rotates the taller grandchild up when A's children differ in height by more than one.
+// Returns the index of the node now at A's position.
+int DynamicAABBTree::Balance(int indexA)
+{
+	Node& nodeA = m_nodes[indexA];
+	if (nodeA.IsLeaf() || nodeA.m_height < 2)
+	{
+		return indexA;
+	}
+
+	int indexB = nodeA.m_child1;
+	int indexC = nodeA.m_child2;
+	Node& nodeB = m_nodes[indexB];
+	Node& nodeC = m_nodes[indexC];
+	int balance = nodeC.m_height - nodeB.m_height;
+
+	// Rotate C up
+	if (balance > 1)
+	{
+		int indexF = nodeC.m_child1;
+		int indexG = nodeC.m_child2;
+		Node& nodeF = m_nodes[indexF];
+		Node& nodeG = m_nodes[indexG];
+
+		nodeC.m_child1 = indexA;
+		nodeC.m_parent = nodeA.m_parent;
+		nodeA.m_parent = indexC;
+		if (nodeC.m_parent >= 0)
+		{
+			if (m_nodes[nodeC.m_parent].m_child1 == indexA)
+			{
+				m_nodes[nodeC.m_parent].m_child1 = indexC;
+			}
+			else
+			{
+				m_nodes[nodeC.m_parent].m_child2 = indexC;
+			}
+		}
+		else
+		{
+			m_root = indexC;
+		}
+
+		if (nodeF.m_height > nodeG.m_height)
+		{
+			nodeC.m_child2 = indexF;
+			nodeA.m_child2 = indexG;
+			nodeG.m_parent = indexA;
+			nodeA.m_bounds = GetUnion(nodeB.m_bounds, nodeG.m_bounds);
+			nodeC.m_bounds = GetUnion(nodeA.m_bounds, nodeF.m_bounds);
+			nodeA.m_height = 1 + (nodeB.m_height > nodeG.m_height ? nodeB.m_height : nodeG.m_height);
+			nodeC.m_height = 1 + (nodeA.m_height > nodeF.m_height ? nodeA.m_height : nodeF.m_height);
+		}
+		else
+		{
+			nodeC.m_child2 = indexG;
+			nodeA.m_child2 = indexF;
+			nodeF.m_parent = indexA;
+			nodeA.m_bounds = GetUnion(nodeB.m_bounds, nodeF.m_bounds);
+			nodeC.m_bounds = GetUnion(nodeA.m_bounds, nodeG.m_bounds);
+			nodeA.m_height = 1 + (nodeB.m_height > nodeF.m_height ? nodeB.m_height : nodeF.m_height);
+			nodeC.m_height = 1 + (nodeA.m_height > nodeG.m_height ? nodeA.m_height : nodeG.m_height);
+		}
+		return indexC;
+	}
+
+	// Rotate B up
+	if (balance < -1)
+	{
+		int indexD = nodeB.m_child1;
+		int indexE = nodeB.m_child2;
+		Node& nodeD = m_nodes[indexD];
+		Node& nodeE = m_nodes[indexE];
+
+		nodeB.m_child1 = indexA;
+		nodeB.m_parent = nodeA.m_parent;
+		nodeA.m_parent = indexB;
+		if (nodeB.m_parent >= 0)
+		{
+			if (m_nodes[nodeB.m_parent].m_child1 == indexA)
+			{
+				m_nodes[nodeB.m_parent].m_child1 = indexB;
+			}
+			else
+			{
+				m_nodes[nodeB.m_parent].m_child2 = indexB;
+			}
+		}
+		else
+		{
+			m_root = indexB;
+		}
+
+		if (nodeD.m_height > nodeE.m_height)
+		{
+			nodeB.m_child2 = indexD;
+			nodeA.m_child1 = indexE;
+			nodeE.m_parent = indexA;
+			nodeA.m_bounds = GetUnion(nodeC.m_bounds, nodeE.m_bounds);
+			nodeB.m_bounds = GetUnion(nodeA.m_bounds, nodeD.m_bounds);
+			nodeA.m_height = 1 + (nodeC.m_height > nodeE.m_height ? nodeC.m_height : nodeE.m_height);
+			nodeB.m_height = 1 + (nodeA.m_height > nodeD.m_height ? nodeA.m_height : nodeD.m_height);
+		}
+		else
+		{
+			nodeB.m_child2 = indexE;
+			nodeA.m_child1 = indexD;
+			nodeD.m_parent = indexA;
+			nodeA.m_bounds = GetUnion(nodeC.m_bounds, nodeD.m_bounds);
+			nodeB.m_bounds = GetUnion(nodeA.m_bounds, nodeE.m_bounds);
+			nodeA.m_height = 1 + (nodeC.m_height > nodeD.m_height ? nodeC.m_height : nodeD.m_height);
+			nodeB.m_height = 1 + (nodeA.m_height > nodeE.m_height ? nodeA.m_height : nodeE.m_height);
+		}
+		return indexB;
+	}
+
+	return indexA;
+}
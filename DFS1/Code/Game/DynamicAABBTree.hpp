@@ -0,0 +1,57 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/AABB3.hpp"
+
+// Incrementally updated AABB tree for objects that move or change size. Each proxy stores a fat box,
+// its tight box grown by m_margin, so small changes don't touch the tree; MoveProxy only reinserts a
+// proxy once its tight box leaves the fat one, or has shrunk far enough inside it. Insertion picks the sibling with the least growth and the
+// tree is kept balanced with rotations, so queries stay logarithmic in the number of proxies.
+class DynamicAABBTree
+{
+public:
+	explicit DynamicAABBTree(float margin = 1.f);
+
+	void Clear();
+	int CreateProxy(AABB3 const& tightBounds, int userData);
+	void DestroyProxy(int proxyId);
+	// Returns true if the proxy was reinserted
+	bool MoveProxy(int proxyId, AABB3 const& tightBounds);
+
+	// Appends the user data of every proxy whose fat box touches queryBounds, in no particular order
+	void Query(AABB3 const& queryBounds, std::vector<int>& outUserData) const;
+
+	AABB3 const& GetFatBounds(int proxyId) const { return m_nodes[proxyId].m_bounds; }
+	int GetUserData(int proxyId) const { return m_nodes[proxyId].m_userData; }
+	int GetNumProxies() const { return m_numProxies; }
+	int GetHeight() const { return m_root < 0 ? 0 : m_nodes[m_root].m_height; }
+	int GetNumReinsertions() const { return m_numReinsertions; }
+	int GetNodeCapacity() const { return (int)m_nodes.capacity(); }
+
+private:
+	struct Node
+	{
+		AABB3 m_bounds;
+		int m_parent = -1;
+		int m_child1 = -1;
+		int m_child2 = -1;
+		int m_height = -1; // 0 for leaves, -1 for free nodes
+		int m_userData = -1;
+		int m_nextFree = -1;
+
+		bool IsLeaf() const { return m_child1 < 0; }
+	};
+
+	int AllocateNode();
+	void FreeNode(int nodeIndex);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int nodeIndex);
+	void RefitAncestors(int nodeIndex);
+
+	float m_margin = 1.f;
+	std::vector<Node> m_nodes;
+	int m_root = -1;
+	int m_freeList = -1;
+	int m_numProxies = 0;
+	int m_numReinsertions = 0;
+};
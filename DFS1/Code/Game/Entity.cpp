@@ -2,6 +2,28 @@
 
 Entity::Entity(BasketballCourt* map)
 	:m_map(map)
+	,m_position(m_ownedPosition)
+	,m_velocity(m_ownedVelocity)
+	,m_acceleration(m_ownedAcceleration)
+	,m_angularVelocity(m_ownedAngularVelocity)
+	,m_isGravityEnabled(m_ownedIsGravityEnabled)
+	,m_drag(m_ownedDrag)
+	,m_mass(m_ownedMass)
+	,m_angularAcceleration(m_ownedAngularAcceleration)
+{
+}
+
+Entity::Entity(BasketballCourt* map, Vec3& position, Vec3& velocity, Vec3& acceleration, Vec3& angularVelocity, Vec3& angularAcceleration,
+	bool& isGravityEnabled, float& drag, float& mass)
+	:m_map(map)
+	,m_position(position)
+	,m_velocity(velocity)
+	,m_acceleration(acceleration)
+	,m_isGravityEnabled(isGravityEnabled)
+	,m_drag(drag)
+	,m_mass(mass)
+	,m_angularVelocity(angularVelocity)
+	,m_angularAcceleration(angularAcceleration)
 {
 }
 
@@ -76,6 +98,11 @@ FloatRange Entity::GetHeightRange() const
 	return FloatRange(m_position.z, m_position.z + m_height);
 }
 
+float Entity::GetBoundingRadius() const
+{
+	return sqrtf(m_radius * m_radius + m_height * m_height);
+}
+
 Mat44 Entity::GetModeMatrix() const
 {
 	Mat44 modelMat = Mat44();
@@ -11,7 +11,8 @@ public:
 	
 	virtual void Update(float deltaSeconds) = 0;
 	virtual void UpdatePhysics(float fixedDeltaSeconds);
-	virtual void Render() const = 0;
+	// Adds the entity's draws to the frame's queue, the court submits them all at once
+	virtual void Render(RenderQueue& queue) const = 0;
 
 	void AddForce(Vec3 force);
 	void AddImpulse(Vec3 impulse);
@@ -24,22 +25,41 @@ public:
 	Vec2 GetPositionXY() const;
 	FloatRange GetHeightRange() const;
 	virtual Mat44 GetModeMatrix() const;
+	// Radius of a sphere around m_position holding everything Render draws, whatever the orientation.
+	// By default that's a cylinder of m_radius and m_height standing on m_position
+	virtual float GetBoundingRadius() const;
+
+protected:
+	// Balls keep their motion state and the physics properties the integration kernels read in the
+	// court's BallStateArrays, other entities own theirs
+	Entity(BasketballCourt* map, Vec3& position, Vec3& velocity, Vec3& acceleration, Vec3& angularVelocity, Vec3& angularAcceleration,
+		bool& isGravityEnabled, float& drag, float& mass);
+
+private:
+	Vec3 m_ownedPosition = Vec3::ZERO;
+	Vec3 m_ownedVelocity = Vec3::ZERO;
+	Vec3 m_ownedAcceleration = Vec3::ZERO;
+	Vec3 m_ownedAngularVelocity = Vec3::ZERO;
+	Vec3 m_ownedAngularAcceleration = Vec3::ZERO;
+	bool m_ownedIsGravityEnabled = true;
+	float m_ownedDrag = 9.f;
+	float m_ownedMass = 1.f;
 
 public:
 	BasketballCourt* m_map = nullptr;
-	Vec3 m_position = Vec3::ZERO;
-	Vec3 m_velocity = Vec3::ZERO;
-	Vec3 m_acceleration = Vec3::ZERO;
-	bool m_isGravityEnabled = true;
+	Vec3& m_position;
+	Vec3& m_velocity;
+	Vec3& m_acceleration;
+	bool& m_isGravityEnabled;
 	bool m_isDead = false;
 	bool m_isStatic = false;
-	float m_drag = 9.f;
-	float m_mass = 1.f;
+	float& m_drag;
+	float& m_mass;
 	float m_radius = 1.f;
 	float m_height = 1.f;
 	EulerAngles m_orientationDegrees = EulerAngles();
-	Vec3 m_angularVelocity = Vec3::ZERO;
-	Vec3 m_angularAcceleration = Vec3::ZERO;
+	Vec3& m_angularVelocity;
+	Vec3& m_angularAcceleration;
 	Rgba8 m_color = Rgba8::COLOR_WHITE;
 public:
 };
\ No newline at end of file
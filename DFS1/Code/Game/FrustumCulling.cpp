@@ -0,0 +1,194 @@
+#include "Game/FrustumCulling.hpp"
+#include <xmmintrin.h>
+
+void CullingSpheres::Clear()
+{
+	m_xs.clear();
+	m_ys.clear();
+	m_zs.clear();
+	m_radii.clear();
+	m_numSpheres = 0;
+}
+
+void CullingSpheres::AddSphere(Vec3 const& center, float radius)
+{
+	m_xs.push_back(center.x);
+	m_ys.push_back(center.y);
+	m_zs.push_back(center.z);
+	m_radii.push_back(radius);
+	m_numSpheres++;
+}
+
+void CullingSpheres::Finish()
+{
+	// Padding is tested like any sphere, its results are never read
+	int paddedSize = (m_numSpheres + CULLING_SIMD_WIDTH - 1) / CULLING_SIMD_WIDTH * CULLING_SIMD_WIDTH;
+	m_xs.resize(paddedSize, 0.f);
+	m_ys.resize(paddedSize, 0.f);
+	m_zs.resize(paddedSize, 0.f);
+	m_radii.resize(paddedSize, 0.f);
+}
+
+void CullSpheresScalar(Frustum const& frustum, CullingSpheres const& spheres, int begin, int end, unsigned char* out_isVisible)
+{
+	for (int i = begin; i < end; i++)
+	{
+		Vec3 center = Vec3(spheres.m_xs[i], spheres.m_ys[i], spheres.m_zs[i]);
+		out_isVisible[i] = frustum.IsSphereOutside(center, spheres.m_radii[i]) ? 0 : 1;
+	}
+}
+
+void CullSpheresSIMD(Frustum const& frustum, CullingSpheres const& spheres, int begin, int end, unsigned char* out_isVisible)
+{
+	__m128 normalXs[NUM_FRUSTUM_PLANES];
+	__m128 normalYs[NUM_FRUSTUM_PLANES];
+	__m128 normalZs[NUM_FRUSTUM_PLANES];
+	__m128 distances[NUM_FRUSTUM_PLANES];
+	for (int planeIndex = 0; planeIndex < NUM_FRUSTUM_PLANES; planeIndex++)
+	{
+		Plane3 const& plane = frustum.m_planes[planeIndex];
+		normalXs[planeIndex] = _mm_set1_ps(plane.m_normal.x);
+		normalYs[planeIndex] = _mm_set1_ps(plane.m_normal.y);
+		normalZs[planeIndex] = _mm_set1_ps(plane.m_normal.z);
+		distances[planeIndex] = _mm_set1_ps(plane.m_distanceFromOrigin);
+	}
+	__m128 const zero = _mm_setzero_ps();
+
+	// The whole groups, then whatever is left over the scalar way
+	int simdEnd = begin + (end - begin) / CULLING_SIMD_WIDTH * CULLING_SIMD_WIDTH;
+	for (int i = begin; i < simdEnd; i += CULLING_SIMD_WIDTH)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.m_xs[i]);
+		__m128 y = _mm_loadu_ps(&spheres.m_ys[i]);
+		__m128 z = _mm_loadu_ps(&spheres.m_zs[i]);
+		__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(&spheres.m_radii[i]));
+		__m128 isOutside = _mm_setzero_ps();
+		for (int planeIndex = 0; planeIndex < NUM_FRUSTUM_PLANES; planeIndex++)
+		{
+			// Same operations in the same order as Plane3::GetAltitudeOfPoint, so the lanes round like it does
+			__m128 altitude = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, normalXs[planeIndex]), _mm_mul_ps(y, normalYs[planeIndex])), _mm_mul_ps(z, normalZs[planeIndex]));
+			altitude = _mm_sub_ps(altitude, distances[planeIndex]);
+			isOutside = _mm_or_ps(isOutside, _mm_cmplt_ps(altitude, negativeRadius));
+		}
+		int outsideBits = _mm_movemask_ps(isOutside);
+		for (int lane = 0; lane < CULLING_SIMD_WIDTH; lane++)
+		{
+			out_isVisible[i + lane] = (outsideBits >> lane) & 1 ? 0 : 1;
+		}
+	}
+	CullSpheresScalar(frustum, spheres, simdEnd, end, out_isVisible);
+}
+
+void BuildVisibleList(Frustum const& frustum, CullingSpheres const& spheres, JobSystem* jobSystem, std::vector<unsigned char>& scratchIsVisible, std::vector<int>& out_visibleIndexes)
+{
+	int numSpheres = spheres.m_numSpheres;
+	scratchIsVisible.resize(numSpheres);
+	if (jobSystem && numSpheres > CULLING_GRAIN)
+	{
+		jobSystem->ParallelForRange(0, numSpheres, CULLING_GRAIN, [&frustum, &spheres, &scratchIsVisible](int chunkBegin, int chunkEnd)
+			{
+				CullSpheresSIMD(frustum, spheres, chunkBegin, chunkEnd, scratchIsVisible.data());
+			});
+	}
+	else
+	{
+		CullSpheresSIMD(frustum, spheres, 0, numSpheres, scratchIsVisible.data());
+	}
+
+	out_visibleIndexes.clear();
+	for (int i = 0; i < numSpheres; i++)
+	{
+		if (scratchIsVisible[i])
+		{
+			out_visibleIndexes.push_back(i);
+		}
+	}
+}
+
+bool Command_FrustumCullingBenchmark(EventArgs& args)
+{
+	int numObjects = args.GetValue("objects", 10000);
+	int numCameras = args.GetValue("cameras", 16);
+	int numRepeats = args.GetValue("repeats", 20);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	numObjects = numObjects < 1 ? 1 : numObjects;
+	numCameras = numCameras < 1 ? 1 : numCameras;
+	numRepeats = numRepeats < 1 ? 1 : numRepeats;
+
+	// Balls, blockers and props all fall within these sizes
+	RandomNumberGenerator rng(seed);
+	CullingSpheres spheres;
+	for (int i = 0; i < numObjects; i++)
+	{
+		Vec3 center = Vec3(rng.RollRandomFloatInRange(-60.f, 60.f), rng.RollRandomFloatInRange(-60.f, 60.f), rng.RollRandomFloatInRange(0.f, 30.f));
+		spheres.AddSphere(center, rng.RollRandomFloatInRange(0.5f, 6.f));
+	}
+	spheres.Finish();
+
+	std::vector<Frustum> frustums;
+	Camera camera;
+	camera.SetPerspectiveView(2.f, 60.f, 0.1f, 200.f);
+	camera.SetRenderBasis(Vec3(0.f, 0.f, 1.f), Vec3(-1.f, 0.f, 0.f), Vec3(0.f, 1.f, 0.f));
+	for (int i = 0; i < numCameras; i++)
+	{
+		Vec3 position = Vec3(rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(1.f, 10.f));
+		camera.SetTransform(position, EulerAngles(rng.RollRandomFloatInRange(0.f, 360.f), rng.RollRandomFloatInRange(-30.f, 30.f), 0.f));
+		frustums.push_back(camera.GetWorldFrustum());
+	}
+
+	// Every way has to keep exactly the same spheres for every camera
+	std::vector<unsigned char> scalarIsVisible(numObjects);
+	std::vector<unsigned char> simdIsVisible(numObjects);
+	std::vector<unsigned char> scratchIsVisible;
+	std::vector<int> scalarVisible;
+	std::vector<int> parallelVisible;
+	long long numVisible = 0;
+	int numMismatches = 0;
+	for (int cameraIndex = 0; cameraIndex < numCameras; cameraIndex++)
+	{
+		CullSpheresScalar(frustums[cameraIndex], spheres, 0, numObjects, scalarIsVisible.data());
+		CullSpheresSIMD(frustums[cameraIndex], spheres, 0, numObjects, simdIsVisible.data());
+		BuildVisibleList(frustums[cameraIndex], spheres, g_theJobSystem, scratchIsVisible, parallelVisible);
+		scalarVisible.clear();
+		for (int i = 0; i < numObjects; i++)
+		{
+			numMismatches += scalarIsVisible[i] != simdIsVisible[i] ? 1 : 0;
+			if (scalarIsVisible[i])
+			{
+				scalarVisible.push_back(i);
+			}
+		}
+		numMismatches += scalarVisible != parallelVisible ? 1 : 0;
+		numVisible += (long long)scalarVisible.size();
+	}
+
+	double timings[3] = {};
+	for (int repeat = 0; repeat < numRepeats; repeat++)
+	{
+		for (int cameraIndex = 0; cameraIndex < numCameras; cameraIndex++)
+		{
+			double startTime = GetCurrentTimeSeconds();
+			CullSpheresScalar(frustums[cameraIndex], spheres, 0, numObjects, scalarIsVisible.data());
+			double simdStartTime = GetCurrentTimeSeconds();
+			CullSpheresSIMD(frustums[cameraIndex], spheres, 0, numObjects, simdIsVisible.data());
+			double parallelStartTime = GetCurrentTimeSeconds();
+			BuildVisibleList(frustums[cameraIndex], spheres, g_theJobSystem, scratchIsVisible, parallelVisible);
+			double endTime = GetCurrentTimeSeconds();
+			timings[0] += simdStartTime - startTime;
+			timings[1] += parallelStartTime - simdStartTime;
+			timings[2] += endTime - parallelStartTime;
+		}
+	}
+
+	double numCulls = (double)numRepeats * (double)numCameras;
+	double averageVisible = (double)numVisible / (double)numCameras;
+	g_theDevConsole->AddLine(numMismatches > 0 ? DevConsole::ERROR : DevConsole::INFO_MAJOR, Stringf("Frustum culling: %d objects, %d cameras, %.0f visible and %.0f culled per camera%s",
+		numObjects, numCameras, averageVisible, (double)numObjects - averageVisible, numMismatches > 0 ? Stringf(", %d MISMATCHES", numMismatches).c_str() : ""));
+	char const* names[3] = { "scalar", "SIMD", "SIMD jobs" };
+	for (int i = 0; i < 3; i++)
+	{
+		double seconds = timings[i] / numCulls;
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %-9s %8.3f ms per camera, %6.2f ns per object, %.2fx scalar", names[i], seconds * 1000.0, seconds * 1000000000.0 / (double)numObjects, timings[i] > 0.0 ? timings[0] / timings[i] : 0.0));
+	}
+	return false;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/Frustum.hpp"
+
+constexpr int CULLING_SIMD_WIDTH = 4;
+constexpr int CULLING_GRAIN = 1024; // multiple of CULLING_SIMD_WIDTH
+
+// Bounding spheres packed one array per component for culling, padded to a whole number of
+// CULLING_SIMD_WIDTH groups. A sphere's index is the order it was added in, callers keep their own
+// mapping from it back to the object
+struct CullingSpheres
+{
+	void Clear();
+	void AddSphere(Vec3 const& center, float radius);
+	// Pads the last group, call it after the last AddSphere
+	void Finish();
+
+	std::vector<float> m_xs;
+	std::vector<float> m_ys;
+	std::vector<float> m_zs;
+	std::vector<float> m_radii;
+	int m_numSpheres = 0;
+};
+
+// [begin, end) are sphere indexes, the SIMD kernel needs begin to be a multiple of CULLING_SIMD_WIDTH.
+// Both write 1 for a sphere Frustum::IsSphereOutside keeps and 0 for one it culls, and agree exactly
+void CullSpheresScalar(Frustum const& frustum, CullingSpheres const& spheres, int begin, int end, unsigned char* out_isVisible);
+void CullSpheresSIMD(Frustum const& frustum, CullingSpheres const& spheres, int begin, int end, unsigned char* out_isVisible);
+
+// Indexes of the visible spheres in ascending order. With a job system the spheres are tested in
+// chunks of CULLING_GRAIN on its workers, the list comes out the same either way
+void BuildVisibleList(Frustum const& frustum, CullingSpheres const& spheres, JobSystem* jobSystem, std::vector<unsigned char>& scratchIsVisible, std::vector<int>& out_visibleIndexes);
+
+// Random spheres over and around the court seen from random cameras inside it, culled scalar, SIMD
+// and SIMD on the job system. Keys: objects, cameras, repeats, seed
+bool Command_FrustumCullingBenchmark(EventArgs& args);
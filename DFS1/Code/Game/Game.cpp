@@ -12,6 +12,7 @@ Game::Game()
 {
 	m_screenCamera.SetOrthographicView(Vec2(0, 0), Vec2(g_gameConfigBlackboard.GetValue("screenSizeX", 1600.f), g_gameConfigBlackboard.GetValue("screenSizeY", 800.f)));
 	m_clock = new Clock(*Clock::s_theSystemClock);
+	m_fixedTimeStep = 1.f / g_gameConfigBlackboard.GetValue("physicsHz", 1.f / m_fixedTimeStep);
 }
 //..............................
 Game::~Game()
@@ -381,7 +382,7 @@ void Game::EnterCurrentState()
 		break;
 	case GameState::PLAY_MODE:
 		g_theInput->SetCursorMode(true, true);
-		m_map = new BasketballCourt();
+		m_map = new BasketballCourt(g_gameConfigBlackboard.GetValue("maxBalls", DEFAULT_COURT_BALL_CAPACITY));
 		m_map->Startup();
 		m_currentGameMusicIndex = g_theRNG->RollRandomIntInRange(0, 4);
 		PlayMusic(m_gameMusics[m_currentGameMusicIndex], false);
@@ -444,6 +445,10 @@ void Game::PlaySoundUI(SoundID sound)
 
 void Game::PlaySound(SoundID sound, bool overlapCurrentSound)
 {
+	if (!g_theAudio)
+	{
+		return;
+	}
 	float vol = g_gameConfigBlackboard.GetValue("sound", 1.f);
 	if (g_gameConfigBlackboard.GetValue("debugMuteAll", false))
 	{
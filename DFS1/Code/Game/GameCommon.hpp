@@ -13,6 +13,7 @@
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Renderer/Renderer.hpp"
+#include "Engine/Renderer/RenderQueue.hpp"
 #include "Engine/Renderer/DebugRender.hpp"
 #include "Engine/Renderer/Camera.hpp"
 #include "Engine/Math/MathUtils.hpp"
@@ -49,6 +50,24 @@ constexpr float SHAKE_REDUCTION_PER_SEC = 7.f;
 
 constexpr float BALL_RADIUS = 0.5f;
 constexpr float BALL_MASS = 58.f;
+// What the ball has always used: 2/5 m r^2 with the Entity defaults of mass 1 and radius 1, not BALL_MASS
+// and BALL_RADIUS. The shot feel is tuned against this value
+constexpr float BALL_INERTIA = 0.4f;
+constexpr int BALL_INTEGRATION_GRAIN = 64; // multiple of BALL_SIMD_WIDTH
+constexpr int MAX_BALLS = 16384; // largest ball capacity a court can have, the played court's comes from maxBalls in GameConfig
+constexpr int DEFAULT_COURT_BALL_CAPACITY = 2048;
+constexpr int BALL_COLLISION_GRAIN = 256;
+constexpr int BALL_ISLAND_GRAIN = 16;
+constexpr float BALL_GRID_CELL_SIZE = 2.f;
+constexpr float BALL_GRID_HALF_EXTENT = 50.f;
+constexpr float BLOCKER_TREE_MARGIN = 0.5f;
+constexpr float BALL_SLEEP_LINEAR_SPEED = 0.5f;
+constexpr float BALL_SLEEP_ANGULAR_SPEED = 1.f;
+constexpr float BALL_SLEEP_SECONDS = 0.5f;
+constexpr int BALL_CCD_MAX_IMPACTS = 4;
+constexpr int BALL_POOL_PAGE_SIZE = 256;
+constexpr int COURT_POOL_PAGE_SIZE = 64;
+constexpr int RENDER_RECORD_GRAIN = 32;
 
 constexpr float FORCE_RATE = 40.f;
 constexpr float SPIN_RATE = 500.f;
@@ -8,9 +8,23 @@ int WINAPI WinMain( _In_ HINSTANCE applicationInstanceHandle, _In_opt_ HINSTANCE
 {
 	UNUSED(applicationInstanceHandle);
 	UNUSED(previousInstance);
-	UNUSED(commandLineString);		
 	UNUSED(nShpwCmd);		
 
+	if (App::IsHeadlessCommandLine(commandLineString))
+	{
+		// Report to the console that launched us, if any
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			FILE* consoleOut = nullptr;
+			freopen_s(&consoleOut, "CONOUT$", "w", stdout);
+		}
+		g_theApp = new App();
+		int exitCode = g_theApp->RunHeadless(commandLineString);
+		delete g_theApp;
+		g_theApp = nullptr;
+		return exitCode;
+	}
+
 	g_theApp = new App();
 	g_theApp->Startup();
 	g_theApp->Run();
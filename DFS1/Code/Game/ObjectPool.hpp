@@ -0,0 +1,130 @@
+#pragma once
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed-size blocks for one type, carved out of pages that live as long as the pool. A destroyed object's
+// block goes on a free list and the next Create reuses it, so once the pool has grown to the most objects
+// it ever held at once, creating and destroying no longer touches the heap. m_numPageAllocations counts
+// every time it did.
+template<typename T>
+class ObjectPool
+{
+public:
+	explicit ObjectPool(int objectsPerPage = 64);
+	~ObjectPool();
+	ObjectPool(ObjectPool const& copy) = delete;
+
+	template<typename... Args>
+	T* Create(Args&&... args);
+	void Destroy(T* object);
+	// Destroys every live object and keeps the pages for whatever comes next
+	void DestroyAll();
+
+	int GetNumLiveObjects() const { return m_numLiveObjects; }
+	int GetCapacity() const { return (int)m_pages.size() * m_objectsPerPage; }
+	int GetNumPageAllocations() const { return m_numPageAllocations; }
+
+private:
+	// The object sits at the start of its block, so a T* is also its Block*
+	struct Block
+	{
+		alignas(T) unsigned char m_storage[sizeof(T)];
+		Block* m_nextFree = nullptr;
+		bool m_isLive = false;
+	};
+
+	void AllocatePage();
+
+	int m_objectsPerPage = 64;
+	std::vector<Block*> m_pages;
+	Block* m_freeList = nullptr;
+	int m_numLiveObjects = 0;
+	int m_numPageAllocations = 0;
+};
+
+template<typename T>
+ObjectPool<T>::ObjectPool(int objectsPerPage)
+	:m_objectsPerPage(objectsPerPage > 0 ? objectsPerPage : 1)
+{
+}
+
+template<typename T>
+ObjectPool<T>::~ObjectPool()
+{
+	DestroyAll();
+	for (size_t pageIndex = 0; pageIndex < m_pages.size(); pageIndex++)
+	{
+		delete[] m_pages[pageIndex];
+	}
+	m_pages.clear();
+}
+
+template<typename T>
+template<typename... Args>
+T* ObjectPool<T>::Create(Args&&... args)
+{
+	if (!m_freeList)
+	{
+		AllocatePage();
+	}
+	Block* block = m_freeList;
+	m_freeList = block->m_nextFree;
+	block->m_nextFree = nullptr;
+	block->m_isLive = true;
+	m_numLiveObjects++;
+	return new (block->m_storage) T(std::forward<Args>(args)...);
+}
+
+template<typename T>
+void ObjectPool<T>::Destroy(T* object)
+{
+	if (!object)
+	{
+		return;
+	}
+	Block* block = reinterpret_cast<Block*>(object);
+	GUARANTEE_OR_DIE(block->m_isLive, "Destroying an object that is not live in this pool");
+	object->~T();
+	block->m_isLive = false;
+	block->m_nextFree = m_freeList;
+	m_freeList = block;
+	m_numLiveObjects--;
+}
+
+template<typename T>
+void ObjectPool<T>::DestroyAll()
+{
+	// Rebuilt back to front so the next objects come out of the first page in order
+	m_freeList = nullptr;
+	for (int pageIndex = (int)m_pages.size() - 1; pageIndex >= 0; pageIndex--)
+	{
+		Block* page = m_pages[pageIndex];
+		for (int blockIndex = m_objectsPerPage - 1; blockIndex >= 0; blockIndex--)
+		{
+			Block& block = page[blockIndex];
+			if (block.m_isLive)
+			{
+				reinterpret_cast<T*>(block.m_storage)->~T();
+				block.m_isLive = false;
+			}
+			block.m_nextFree = m_freeList;
+			m_freeList = &block;
+		}
+	}
+	m_numLiveObjects = 0;
+}
+
+template<typename T>
+void ObjectPool<T>::AllocatePage()
+{
+	Block* page = new Block[m_objectsPerPage];
+	m_pages.push_back(page);
+	m_numPageAllocations++;
+	for (int blockIndex = m_objectsPerPage - 1; blockIndex >= 0; blockIndex--)
+	{
+		page[blockIndex].m_nextFree = m_freeList;
+		m_freeList = &page[blockIndex];
+	}
+}
@@ -0,0 +1,1084 @@
+#include "Game/PhysicsBenchmark.hpp"
+#include "Game/BasketballCourt.hpp"
+#include "Game/Ball.hpp"
+#include "Game/Blocker.hpp"
+#include "Game/Player.hpp"
+#include "Game/Prop.hpp"
+
+double PhysicsScenarioResult::GetStepsPerSecond() const
+{
+	return m_seconds > 0.0 ? (double)m_numSteps / m_seconds : 0.0;
+}
+
+double PhysicsScenarioResult::GetNanosecondsPerBallStep() const
+{
+	return m_numBallSteps > 0 ? m_seconds * 1000000000.0 / (double)m_numBallSteps : 0.0;
+}
+
+PhysicsScenarioConfig ParsePhysicsScenarioConfig(EventArgs& args)
+{
+	PhysicsScenarioConfig config;
+	config.m_seed = (unsigned int)args.GetValue("seed", (int)config.m_seed);
+	config.m_numBalls = args.GetValue("balls", config.m_numBalls);
+	config.m_numBlockers = args.GetValue("blockers", config.m_numBlockers);
+	config.m_numShots = args.GetValue("shots", config.m_numShots);
+	config.m_stepsPerShot = args.GetValue("shotsteps", config.m_stepsPerShot);
+	config.m_numSteps = args.GetValue("steps", config.m_numSteps);
+	config.m_isMultithreaded = args.GetValue("multithreaded", config.m_isMultithreaded);
+
+	config.m_numBalls = config.m_numBalls < 0 ? 0 : config.m_numBalls;
+	config.m_numShots = config.m_numShots < 0 ? 0 : config.m_numShots;
+	if (config.m_numBalls + config.m_numShots > MAX_BALLS)
+	{
+		config.m_numShots = MAX_BALLS - config.m_numBalls;
+	}
+	config.m_stepsPerShot = config.m_stepsPerShot < 1 ? 1 : config.m_stepsPerShot;
+	config.m_numSteps = config.m_numSteps < 1 ? 1 : config.m_numSteps;
+	return config;
+}
+
+PhysicsScenarioResult RunPhysicsScenario(PhysicsScenarioConfig const& config)
+{
+	// Scoring in TIMER and OBSTACLE mode moves the player and respawns blockers from g_theRNG
+	GameMode previousGameMode = g_theGame->m_currentGameMode;
+	g_theGame->m_currentGameMode = CREATIVE;
+
+	BasketballCourt* court = new BasketballCourt();
+	court->m_isPhysicsMultithreaded = config.m_isMultithreaded;
+	court->InitializeCourt();
+	court->m_player = court->CreatePlayer(Vec3(-3.f, -3.f, 1.f));
+
+	RandomNumberGenerator rng(config.m_seed);
+	if (config.m_numBlockers > 0)
+	{
+		court->SpawnRandomBlockers(config.m_numBlockers, rng);
+	}
+	for (int i = 0; i < config.m_numBalls; i++)
+	{
+		Ball* ball = court->CreateBall(Vec3(rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(5.f, 30.f)));
+		ball->m_velocity = Vec3(rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne()) * 15.f;
+	}
+
+	// Shots are aimed to land in hoop A after flightSeconds without drag, with some spread
+	Vec3 const hoopTarget = Vec3(40.8f, 0.f, 12.7f);
+	float const gravity = MODIFIED_GRAVITY_RATE;
+	float const deltaSeconds = g_theGame->m_fixedTimeStep;
+
+	PhysicsScenarioResult result;
+	int numShotsFired = 0;
+	for (int step = 0; step < config.m_numSteps; step++)
+	{
+		if (numShotsFired < config.m_numShots && step % config.m_stepsPerShot == 0)
+		{
+			Vec3 shotPosition = Vec3(rng.RollRandomFloatInRange(0.f, 30.f), rng.RollRandomFloatInRange(-20.f, 20.f), 7.f);
+			float flightSeconds = rng.RollRandomFloatInRange(0.8f, 1.6f);
+			Vec3 displacement = hoopTarget - shotPosition;
+			Ball* ball = court->CreateBall(shotPosition);
+			ball->m_velocity = Vec3(displacement.x / flightSeconds, displacement.y / flightSeconds, displacement.z / flightSeconds - 0.5f * gravity * flightSeconds);
+			ball->m_angularVelocity = Vec3(0.f, rng.RollRandomFloatInRange(-10.f, 0.f), 0.f);
+			numShotsFired++;
+		}
+
+		result.m_numBallSteps += court->m_balls.GetNumBalls();
+
+		bool wasHoopColliding = court->m_hoopA->m_isColliding;
+		double startTime = GetCurrentTimeSeconds();
+		court->UpdatePhysics(deltaSeconds);
+		result.m_seconds += GetCurrentTimeSeconds() - startTime;
+		if (!wasHoopColliding && court->m_hoopA->m_isColliding)
+		{
+			result.m_numScores++;
+		}
+	}
+	result.m_numSteps = config.m_numSteps;
+
+	// FNV-1a over the final ball states, so a CI run can also tell when the simulation itself changed
+	unsigned int checksum = 2166136261u;
+	for (int i = 0; i < court->m_balls.GetNumBalls(); i++)
+	{
+		Ball const* ball = court->m_balls[i];
+		result.m_numBallsAtEnd++;
+		float const values[6] = { ball->m_position.x, ball->m_position.y, ball->m_position.z, ball->m_velocity.x, ball->m_velocity.y, ball->m_velocity.z };
+		unsigned char const* bytes = (unsigned char const*)values;
+		for (size_t byteIndex = 0; byteIndex < sizeof(values); byteIndex++)
+		{
+			checksum = (checksum ^ bytes[byteIndex]) * 16777619u;
+		}
+	}
+	result.m_checksum = checksum;
+	result.m_numSleepingBallsAtEnd = court->m_numSleepingBalls;
+
+	// Without a renderer this only records the requests, which is what a headless run can check. Culling
+	// is off so every ball is an instance, wherever the player happens to look
+	RenderQueue renderQueue;
+	court->m_isFrustumCullingEnabled = false;
+	court->BuildRenderQueue(renderQueue);
+	result.m_ballRenderRecord = court->m_ballRenderRecord;
+
+	delete court;
+
+	g_theGame->m_currentGameMode = previousGameMode;
+	return result;
+}
+
+std::string FormatPhysicsScenarioReport(PhysicsScenarioConfig const& config, PhysicsScenarioResult const& result)
+{
+	return Stringf("seed=%u balls=%d blockers=%d shots=%d steps=%d multithreaded=%s workers=%d: %.1f steps/sec, %.1f ns per ball-step, %d balls at end (%d asleep), %d hoop entries, checksum %08x, ball rendering %d mesh uploads, %d instance uploads, %d draw calls",
+		config.m_seed, config.m_numBalls, config.m_numBlockers, config.m_numShots, config.m_numSteps, config.m_isMultithreaded ? "true" : "false",
+		g_theJobSystem->GetNumWorkers(), result.GetStepsPerSecond(), result.GetNanosecondsPerBallStep(), result.m_numBallsAtEnd, result.m_numSleepingBallsAtEnd, result.m_numScores, result.m_checksum,
+		result.m_ballRenderRecord.m_numMeshUploads, result.m_ballRenderRecord.m_numInstanceUploads, result.m_ballRenderRecord.m_numDrawCalls);
+}
+
+bool Command_PhysicsBenchmark(EventArgs& args)
+{
+	PhysicsScenarioConfig config = ParsePhysicsScenarioConfig(args);
+	PhysicsScenarioResult result = RunPhysicsScenario(config);
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, "Physics benchmark " + FormatPhysicsScenarioReport(config, result));
+	return false;
+}
+
+TunnelingTestResult RunTunnelingTest(unsigned int seed, int numShots, float physicsHz, bool isContinuousCollisionEnabled)
+{
+	GameMode previousGameMode = g_theGame->m_currentGameMode;
+	float previousFixedTimeStep = g_theGame->m_fixedTimeStep;
+	g_theGame->m_currentGameMode = CREATIVE;
+	g_theGame->m_fixedTimeStep = 1.f / physicsHz;
+	float const deltaSeconds = g_theGame->m_fixedTimeStep;
+
+	BasketballCourt* court = new BasketballCourt();
+	court->m_isPhysicsMultithreaded = false;
+	court->m_isContinuousCollisionEnabled = isContinuousCollisionEnabled;
+	court->InitializeCourt();
+	court->m_player = court->CreatePlayer(Vec3(-3.f, -3.f, 1.f));
+
+	// Aim at the board face above the rim and inside the board's edges, from close enough that drag barely matters
+	Prop const* board = court->m_hoopBoardA;
+	AABB3 boardBox = AABB3(board->m_position, board->m_height, 0.1f, board->m_radius);
+	float const throwSpeed = THROW_MAX_FORCE / BALL_MASS;
+	float const gravity = MODIFIED_GRAVITY_RATE;
+
+	TunnelingTestResult result;
+	result.m_physicsHz = physicsHz;
+	result.m_isContinuousCollisionEnabled = isContinuousCollisionEnabled;
+	result.m_numShots = numShots;
+
+	RandomNumberGenerator rng(seed);
+	for (int shot = 0; shot < numShots; shot++)
+	{
+		Vec3 target = Vec3(boardBox.m_mins.x, rng.RollRandomFloatInRange(boardBox.m_mins.y + 1.f, boardBox.m_maxs.y - 1.f), rng.RollRandomFloatInRange(14.f, boardBox.m_maxs.z - 0.5f));
+		Vec3 shotPosition = Vec3(rng.RollRandomFloatInRange(34.f, 40.f), target.y + rng.RollRandomFloatMinusOneToOne(), target.z + rng.RollRandomFloatInRange(-0.5f, 0.5f));
+		Vec3 displacement = target - shotPosition;
+		float flightSeconds = displacement.GetLength() / throwSpeed;
+
+		Ball* ball = court->CreateBall(shotPosition);
+		ball->m_velocity = Vec3(displacement.x / flightSeconds, displacement.y / flightSeconds, displacement.z / flightSeconds - 0.5f * gravity * flightSeconds);
+
+		// A second is long enough to reach the board and bounce well clear of it
+		int numSteps = (int)ceilf(physicsHz);
+		for (int step = 0; step < numSteps; step++)
+		{
+			court->UpdatePhysics(deltaSeconds);
+			if (ball->m_position.x > boardBox.m_maxs.x)
+			{
+				result.m_numPassThroughs++;
+				break;
+			}
+		}
+
+		court->DestroyBall(ball);
+	}
+
+	// Past the top edge the board grown by the ball's radius has a square corner the ball's real reach doesn't.
+	// Each near miss crosses that corner in one step, closest to the edge halfway through, and is fast enough to
+	// be swept. The same step with continuous collision off is where the ball should end up.
+	if (isContinuousCollisionEnabled)
+	{
+		result.m_numNearMisses = numShots;
+		Vec3 const awayFromEdge = Vec3(-1.f, 0.f, 1.f).GetNormalized();
+		float const stepLength = 4.f * BALL_RADIUS;
+		for (int nearMiss = 0; nearMiss < result.m_numNearMisses; nearMiss++)
+		{
+			Vec3 pointOnEdge = Vec3(boardBox.m_mins.x, rng.RollRandomFloatInRange(boardBox.m_mins.y + 1.f, boardBox.m_maxs.y - 1.f), boardBox.m_maxs.z);
+			Vec3 closestPosition = pointOnEdge + awayFromEdge * (BALL_RADIUS * rng.RollRandomFloatInRange(1.05f, 1.35f));
+			Vec3 direction = Vec3(1.f, rng.RollRandomFloatInRange(-0.3f, 0.3f), 1.f).GetNormalized();
+			Vec3 startPosition = closestPosition - direction * (0.5f * stepLength);
+
+			Vec3 endPositions[2];
+			for (int pass = 0; pass < 2; pass++)
+			{
+				court->m_isContinuousCollisionEnabled = pass == 0;
+				Ball* ball = court->CreateBall(startPosition);
+				ball->m_velocity = direction * (stepLength * physicsHz);
+				court->UpdatePhysics(deltaSeconds);
+				endPositions[pass] = ball->m_position;
+				court->DestroyBall(ball);
+			}
+			court->m_isContinuousCollisionEnabled = true;
+			if (endPositions[0] != endPositions[1])
+			{
+				result.m_numFalseHits++;
+			}
+		}
+	}
+
+	delete court;
+
+	g_theGame->m_currentGameMode = previousGameMode;
+	g_theGame->m_fixedTimeStep = previousFixedTimeStep;
+	return result;
+}
+
+std::vector<TunnelingTestResult> RunTunnelingTests(EventArgs& args)
+{
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	int numShots = args.GetValue("shots", 200);
+	float requestedHz = args.GetValue("hz", 0.f);
+	std::vector<float> rates;
+	if (requestedHz > 0.f)
+	{
+		rates.push_back(requestedHz);
+	}
+	else
+	{
+		rates = { 200.f, 120.f, 60.f };
+	}
+
+	std::vector<TunnelingTestResult> results;
+	for (size_t rateIndex = 0; rateIndex < rates.size(); rateIndex++)
+	{
+		results.push_back(RunTunnelingTest(seed, numShots, rates[rateIndex], false));
+		results.push_back(RunTunnelingTest(seed, numShots, rates[rateIndex], true));
+	}
+	return results;
+}
+
+std::string FormatTunnelingTestReport(TunnelingTestResult const& result)
+{
+	return Stringf("hz=%.0f ccd=%s: %d max-force shots at the backboard, %d passed through, %d near misses past its top edge, %d hit it%s", result.m_physicsHz,
+		result.m_isContinuousCollisionEnabled ? "on" : "off", result.m_numShots, result.m_numPassThroughs, result.m_numNearMisses, result.m_numFalseHits, result.HasFailed() ? " FAILED" : "");
+}
+
+bool HasTunnelingTestFailed(std::vector<TunnelingTestResult> const& results)
+{
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if (results[i].HasFailed())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Command_TunnelingTest(EventArgs& args)
+{
+	std::vector<TunnelingTestResult> results = RunTunnelingTests(args);
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, "Tunneling test");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		g_theDevConsole->AddLine(results[i].HasFailed() ? DevConsole::ERROR : DevConsole::INFO_MINOR, "  " + FormatTunnelingTestReport(results[i]));
+	}
+	return false;
+}
+
+// A court with a player, random blockers and balls scattered over it. The caller puts the game in
+// OBSTACLE mode, the one that draws blockers
+static BasketballCourt* CreateRenderTestCourt(unsigned int seed, int numBalls, int numBlockers)
+{
+	BasketballCourt* court = new BasketballCourt();
+	court->InitializeCourt();
+	court->m_player = court->CreatePlayer(Vec3(-3.f, -3.f, 1.f));
+
+	RandomNumberGenerator rng(seed);
+	if (numBlockers > 0)
+	{
+		court->SpawnRandomBlockers(numBlockers, rng);
+	}
+	for (int i = 0; i < numBalls; i++)
+	{
+		court->CreateBall(Vec3(rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(-45.f, 45.f), rng.RollRandomFloatInRange(1.f, 30.f)));
+	}
+	return court;
+}
+
+RenderQueueTestResult RunRenderQueueTest(EventArgs& args)
+{
+	RenderQueueTestResult result;
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	result.m_numBalls = args.GetValue("balls", 200);
+	result.m_numBlockers = args.GetValue("blockers", 20);
+	result.m_numBalls = result.m_numBalls < 0 ? 0 : (result.m_numBalls > MAX_BALLS ? MAX_BALLS : result.m_numBalls);
+
+	// OBSTACLE is the mode that draws blockers, nothing is simulated so scoring can't move anything
+	GameMode previousGameMode = g_theGame->m_currentGameMode;
+	g_theGame->m_currentGameMode = OBSTACLE;
+
+	BasketballCourt* court = CreateRenderTestCourt(seed, result.m_numBalls, result.m_numBlockers);
+
+	RenderQueue queue;
+	court->BuildRenderQueue(queue);
+	result.m_unsorted = queue.Submit(nullptr, false);
+	result.m_sorted = queue.Submit(nullptr, true);
+	result.m_isSortedDeterministic = queue.Submit(nullptr, true).m_checksum == result.m_sorted.m_checksum;
+
+	delete court;
+
+	g_theGame->m_currentGameMode = previousGameMode;
+	return result;
+}
+
+bool RenderQueueTestResult::HasFailed() const
+{
+	bool isSameOutput = m_unsorted.m_numDraws == m_sorted.m_numDraws && m_unsorted.m_numInstancesDrawn == m_sorted.m_numInstancesDrawn
+		&& m_unsorted.m_numImmediateBytes == m_sorted.m_numImmediateBytes;
+	return !isSameOutput || m_sorted.GetNumStateChanges() > m_unsorted.GetNumStateChanges() || !m_isSortedDeterministic;
+}
+
+std::string FormatRenderQueueTestReport(RenderQueueTestResult const& result)
+{
+	RenderQueueStats const& unsorted = result.m_unsorted;
+	RenderQueueStats const& sorted = result.m_sorted;
+	return Stringf("balls=%d blockers=%d: %d packets, %d draws (%d instances), state changes unsorted %d (%d texture, %d rasterizer, %d model constants), sorted %d (%d texture, %d rasterizer, %d model constants), sorted checksum %08x%s",
+		result.m_numBalls, result.m_numBlockers, sorted.m_numPackets, sorted.m_numDraws, sorted.m_numInstancesDrawn,
+		unsorted.GetNumStateChanges(), unsorted.m_numTextureBinds, unsorted.m_numRasterizerChanges, unsorted.m_numModelConstantUpdates,
+		sorted.GetNumStateChanges(), sorted.m_numTextureBinds, sorted.m_numRasterizerChanges, sorted.m_numModelConstantUpdates,
+		sorted.m_checksum, result.HasFailed() ? " FAILED" : "");
+}
+
+bool Command_RenderQueueTest(EventArgs& args)
+{
+	RenderQueueTestResult result = RunRenderQueueTest(args);
+	g_theDevConsole->AddLine(result.HasFailed() ? DevConsole::ERROR : DevConsole::INFO_MAJOR, "Render queue test " + FormatRenderQueueTestReport(result));
+	return false;
+}
+
+RenderRecordingTestResult RunRenderRecordingTest(EventArgs& args)
+{
+	RenderRecordingTestResult result;
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	result.m_numBalls = args.GetValue("balls", 200);
+	result.m_numBlockers = args.GetValue("blockers", 2000);
+	result.m_numRepeats = args.GetValue("repeats", 50);
+	int maxWorkers = args.GetValue("workers", (int)std::thread::hardware_concurrency() - 1);
+	result.m_numBalls = result.m_numBalls < 0 ? 0 : (result.m_numBalls > MAX_BALLS ? MAX_BALLS : result.m_numBalls);
+	result.m_numRepeats = result.m_numRepeats < 1 ? 1 : result.m_numRepeats;
+	maxWorkers = maxWorkers < 1 ? 1 : maxWorkers;
+
+	GameMode previousGameMode = g_theGame->m_currentGameMode;
+	g_theGame->m_currentGameMode = OBSTACLE;
+
+	BasketballCourt* court = CreateRenderTestCourt(seed, result.m_numBalls, result.m_numBlockers);
+
+	RenderQueue serialQueue;
+	double serialStartTime = GetCurrentTimeSeconds();
+	for (int repeat = 0; repeat < result.m_numRepeats; repeat++)
+	{
+		court->BuildRenderQueue(serialQueue);
+	}
+	result.m_serialSeconds = (GetCurrentTimeSeconds() - serialStartTime) / (double)result.m_numRepeats;
+	result.m_numPackets = serialQueue.GetNumPackets();
+	result.m_checksum = serialQueue.Submit(nullptr, true).m_checksum;
+
+	std::vector<int> workerCounts;
+	for (int numWorkers = 1; numWorkers < maxWorkers; numWorkers *= 2)
+	{
+		workerCounts.push_back(numWorkers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	RenderQueue parallelQueue;
+	for (size_t countIndex = 0; countIndex < workerCounts.size(); countIndex++)
+	{
+		RenderRecordingRun run;
+		run.m_numWorkers = workerCounts[countIndex];
+		JobSystemConfig config;
+		config.m_numWorkers = run.m_numWorkers;
+		JobSystem system(config);
+		system.CreateWorkers(run.m_numWorkers);
+
+		double startTime = GetCurrentTimeSeconds();
+		for (int repeat = 0; repeat < result.m_numRepeats; repeat++)
+		{
+			court->BuildRenderQueueParallel(parallelQueue, &system);
+		}
+		run.m_seconds = (GetCurrentTimeSeconds() - startTime) / (double)result.m_numRepeats;
+		run.m_isSameAsSerial = parallelQueue.IsSameAs(serialQueue) && parallelQueue.Submit(nullptr, true).m_checksum == result.m_checksum;
+		result.m_runs.push_back(run);
+
+		system.Shutdown();
+	}
+
+	delete court;
+
+	g_theGame->m_currentGameMode = previousGameMode;
+	return result;
+}
+
+bool RenderRecordingTestResult::HasFailed() const
+{
+	for (size_t i = 0; i < m_runs.size(); i++)
+	{
+		if (!m_runs[i].m_isSameAsSerial)
+		{
+			return true;
+		}
+	}
+	return m_runs.empty();
+}
+
+std::string FormatRenderRecordingTestReport(RenderRecordingTestResult const& result)
+{
+	std::string report = Stringf("balls=%d blockers=%d: %d packets, sorted checksum %08x, serial %.3f ms per build%s",
+		result.m_numBalls, result.m_numBlockers, result.m_numPackets, result.m_checksum, result.m_serialSeconds * 1000.0, result.HasFailed() ? " FAILED" : "");
+	for (size_t i = 0; i < result.m_runs.size(); i++)
+	{
+		RenderRecordingRun const& run = result.m_runs[i];
+		double speedup = run.m_seconds > 0.0 ? result.m_serialSeconds / run.m_seconds : 0.0;
+		report += Stringf("\n  %2d workers: %.3f ms per build (%.2fx serial), %s", run.m_numWorkers, run.m_seconds * 1000.0, speedup, run.m_isSameAsSerial ? "same as serial" : "DIFFERS from serial");
+	}
+	return report;
+}
+
+bool Command_RenderRecordingTest(EventArgs& args)
+{
+	RenderRecordingTestResult result = RunRenderRecordingTest(args);
+	Strings lines = SplitStringOnDelimiter(FormatRenderRecordingTestReport(result), '\n');
+	g_theDevConsole->AddLine(result.HasFailed() ? DevConsole::ERROR : DevConsole::INFO_MAJOR, "Render recording test " + lines[0]);
+	for (size_t i = 1; i < lines.size(); i++)
+	{
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, lines[i]);
+	}
+	return false;
+}
+
+MatchedCourts::MatchedCourts(int numCourts)
+{
+	for (int i = 0; i < numCourts; i++)
+	{
+		m_courts.push_back(new BasketballCourt());
+	}
+}
+
+MatchedCourts::~MatchedCourts()
+{
+	for (size_t i = 0; i < m_courts.size(); i++)
+	{
+		delete m_courts[i];
+		m_courts[i] = nullptr;
+	}
+}
+
+void MatchedCourts::CreatePlayers(Vec3 const& position)
+{
+	for (size_t i = 0; i < m_courts.size(); i++)
+	{
+		m_courts[i]->m_player = m_courts[i]->CreatePlayer(position);
+	}
+}
+
+void MatchedCourts::SpawnBalls(MatchedBallSpawn const& spawn)
+{
+	RandomNumberGenerator rng(spawn.m_seed);
+	for (int i = 0; i < spawn.m_numBalls; i++)
+	{
+		Vec3 position = Vec3(rng.RollRandomFloatInRange(spawn.m_bounds.m_mins.x, spawn.m_bounds.m_maxs.x),
+			rng.RollRandomFloatInRange(spawn.m_bounds.m_mins.y, spawn.m_bounds.m_maxs.y), rng.RollRandomFloatInRange(spawn.m_bounds.m_mins.z, spawn.m_bounds.m_maxs.z));
+		Vec3 velocity = Vec3(rng.RollRandomFloatMinusOneToOne() * spawn.m_velocityScale.x, rng.RollRandomFloatMinusOneToOne() * spawn.m_velocityScale.y,
+			rng.RollRandomFloatMinusOneToOne() * spawn.m_velocityScale.z);
+		Vec3 angularVelocity = Vec3::ZERO;
+		if (spawn.m_angularSpeed > 0.f)
+		{
+			angularVelocity = Vec3(rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne()) * spawn.m_angularSpeed;
+		}
+		for (size_t courtIndex = 0; courtIndex < m_courts.size(); courtIndex++)
+		{
+			Ball* ball = m_courts[courtIndex]->CreateBall(position);
+			if (ball)
+			{
+				ball->m_velocity = velocity;
+				ball->m_angularVelocity = angularVelocity;
+			}
+		}
+	}
+}
+
+int MatchedCourts::CountBallMismatches(int expectedCourtIndex, int actualCourtIndex) const
+{
+	// A score can clear either court, then the ball counts differ and every missing ball is a mismatch
+	BallSlotMap const& expectedBalls = m_courts[expectedCourtIndex]->m_balls;
+	BallSlotMap const& actualBalls = m_courts[actualCourtIndex]->m_balls;
+	int numCommonBalls = expectedBalls.GetNumBalls() < actualBalls.GetNumBalls() ? expectedBalls.GetNumBalls() : actualBalls.GetNumBalls();
+	int numMismatches = abs(expectedBalls.GetNumBalls() - actualBalls.GetNumBalls());
+	for (int i = 0; i < numCommonBalls; i++)
+	{
+		if (!IsSameBallStateExactly(expectedBalls[i], actualBalls[i]))
+		{
+			numMismatches++;
+		}
+	}
+	return numMismatches;
+}
+
+bool IsSameVec3Exactly(Vec3 const& a, Vec3 const& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+bool IsSameBallStateExactly(Ball const* a, Ball const* b)
+{
+	return IsSameVec3Exactly(a->m_position, b->m_position) && IsSameVec3Exactly(a->m_velocity, b->m_velocity) && IsSameVec3Exactly(a->m_angularVelocity, b->m_angularVelocity)
+		&& a->m_rotation.i == b->m_rotation.i && a->m_rotation.j == b->m_rotation.j && a->m_rotation.k == b->m_rotation.k && a->m_rotation.w == b->m_rotation.w;
+}
+
+bool Command_BallBroadphaseBenchmark(EventArgs& args)
+{
+	int numSteps = args.GetValue("steps", 5);
+	int requestedBalls = args.GetValue("balls", 0);
+	std::vector<int> ballCounts;
+	if (requestedBalls > 0)
+	{
+		ballCounts.push_back(requestedBalls < MAX_BALLS ? requestedBalls : MAX_BALLS);
+	}
+	else
+	{
+		ballCounts = { 100, 1000, 10000 };
+	}
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball broadphase benchmark: %d steps, all-pairs vs grid", numSteps));
+
+	for (size_t countIndex = 0; countIndex < ballCounts.size(); countIndex++)
+	{
+		int numBalls = ballCounts[countIndex];
+
+		// Every 17th ball is destroyed again, so the live balls have been reordered and leave free slots
+		// behind like a court that has been played on
+		MatchedCourts courts(2);
+		BasketballCourt& bruteForceCourt = *courts.m_courts[0];
+		BasketballCourt& gridCourt = *courts.m_courts[1];
+		MatchedBallSpawn spawn;
+		spawn.m_numBalls = numBalls;
+		courts.SpawnBalls(spawn);
+		for (int i = numBalls - 1; i >= 0; i -= 17)
+		{
+			bruteForceCourt.DestroyBall(bruteForceCourt.m_balls[i]);
+			gridCourt.DestroyBall(gridCourt.m_balls[i]);
+		}
+
+		double bruteForceSeconds = 0.0;
+		double gridSeconds = 0.0;
+		for (int step = 0; step < numSteps; step++)
+		{
+			double startTime = GetCurrentTimeSeconds();
+			bruteForceCourt.BounceBallsOffBallsBruteForce();
+			bruteForceSeconds += GetCurrentTimeSeconds() - startTime;
+
+			startTime = GetCurrentTimeSeconds();
+			gridCourt.BounceBallsOffBalls();
+			gridSeconds += GetCurrentTimeSeconds() - startTime;
+
+			for (int i = 0; i < bruteForceCourt.m_balls.GetNumBalls(); i++)
+			{
+				bruteForceCourt.m_balls[i]->UpdatePhysics(g_theGame->m_fixedTimeStep);
+				gridCourt.m_balls[i]->UpdatePhysics(g_theGame->m_fixedTimeStep);
+			}
+		}
+
+		int numMismatches = courts.CountBallMismatches(0, 1);
+		double speedup = gridSeconds > 0.0 ? bruteForceSeconds / gridSeconds : 0.0;
+		g_theDevConsole->AddLine(numMismatches == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+			Stringf("  %6d balls: all-pairs %9.3f ms/step, grid %7.3f ms/step (%.1fx), %d mismatches",
+				numBalls, bruteForceSeconds * 1000.0 / numSteps, gridSeconds * 1000.0 / numSteps, speedup, numMismatches));
+	}
+
+	return false;
+}
+
+bool Command_BallIntegrationBenchmark(EventArgs& args)
+{
+	int numSteps = args.GetValue("steps", 200);
+	int requestedBalls = args.GetValue("balls", 0);
+	std::vector<int> ballCounts;
+	if (requestedBalls > 0)
+	{
+		ballCounts.push_back(requestedBalls < MAX_BALLS ? requestedBalls : MAX_BALLS);
+	}
+	else
+	{
+		ballCounts = { 1000, 10000 };
+	}
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball integration benchmark: %d steps, single thread, per-object vs scalar slots vs SIMD slots", numSteps));
+
+	for (size_t countIndex = 0; countIndex < ballCounts.size(); countIndex++)
+	{
+		int numBalls = ballCounts[countIndex];
+
+		// Spinning balls, every 13th one not simulating like a ball the player holds
+		MatchedCourts courts(3);
+		BasketballCourt& objectCourt = *courts.m_courts[0];
+		BasketballCourt& scalarCourt = *courts.m_courts[1];
+		BasketballCourt& simdCourt = *courts.m_courts[2];
+		MatchedBallSpawn spawn;
+		spawn.m_numBalls = numBalls;
+		spawn.m_angularSpeed = 20.f;
+		courts.SpawnBalls(spawn);
+		for (int courtIndex = 0; courtIndex < 3; courtIndex++)
+		{
+			for (int i = 0; i < numBalls; i += 13)
+			{
+				courts.m_courts[courtIndex]->m_balls[i]->m_isSimulatingPhysics = false;
+			}
+		}
+
+		float deltaSeconds = g_theGame->m_fixedTimeStep;
+		double startTime = GetCurrentTimeSeconds();
+		for (int step = 0; step < numSteps; step++)
+		{
+			for (int i = 0; i < objectCourt.m_balls.GetNumBalls(); i++)
+			{
+				objectCourt.m_balls[i]->UpdatePhysics(deltaSeconds);
+			}
+		}
+		double objectSeconds = GetCurrentTimeSeconds() - startTime;
+
+		startTime = GetCurrentTimeSeconds();
+		for (int step = 0; step < numSteps; step++)
+		{
+			IntegrateBallStatesScalar(scalarCourt.m_ballStates, 0, numBalls, deltaSeconds);
+		}
+		double scalarSeconds = GetCurrentTimeSeconds() - startTime;
+
+		startTime = GetCurrentTimeSeconds();
+		for (int step = 0; step < numSteps; step++)
+		{
+			IntegrateBallStatesSIMD(simdCourt.m_ballStates, 0, numBalls, deltaSeconds);
+		}
+		double simdSeconds = GetCurrentTimeSeconds() - startTime;
+
+		int numMismatches = courts.CountBallMismatches(0, 1) + courts.CountBallMismatches(0, 2);
+		g_theDevConsole->AddLine(numMismatches == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+			Stringf("  %6d balls: per-object %7.3f ms/step, scalar %7.3f ms/step, SIMD %7.3f ms/step (%.1fx), %d mismatches",
+				numBalls, objectSeconds * 1000.0 / numSteps, scalarSeconds * 1000.0 / numSteps, simdSeconds * 1000.0 / numSteps,
+				simdSeconds > 0.0 ? objectSeconds / simdSeconds : 0.0, numMismatches));
+	}
+
+	return false;
+}
+
+bool Command_PhysicsStepBenchmark(EventArgs& args)
+{
+	int numSteps = args.GetValue("steps", 200);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	int requestedBalls = args.GetValue("balls", 0);
+	std::vector<int> ballCounts;
+	if (requestedBalls > 0)
+	{
+		ballCounts.push_back(requestedBalls < MAX_BALLS ? requestedBalls : MAX_BALLS);
+	}
+	else
+	{
+		ballCounts = { 1000, 4000, 10000 };
+	}
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Physics step benchmark: %d steps, seed %u, serial vs %d workers", numSteps, seed, g_theJobSystem->GetNumWorkers()));
+
+	for (size_t countIndex = 0; countIndex < ballCounts.size(); countIndex++)
+	{
+		int numBalls = ballCounts[countIndex];
+
+		// The same player and the same pile of balls, one court stepped serially
+		MatchedCourts courts(2);
+		BasketballCourt& serialCourt = *courts.m_courts[0];
+		BasketballCourt& parallelCourt = *courts.m_courts[1];
+		serialCourt.m_isPhysicsMultithreaded = false;
+		parallelCourt.m_isPhysicsMultithreaded = true;
+		courts.CreatePlayers(Vec3(-3.f, -3.f, 1.f));
+		MatchedBallSpawn spawn;
+		spawn.m_seed = seed;
+		spawn.m_numBalls = numBalls;
+		spawn.m_bounds = AABB3(Vec3(-30.f, -30.f, BALL_RADIUS), Vec3(30.f, 30.f, 8.f));
+		spawn.m_angularSpeed = 5.f;
+		courts.SpawnBalls(spawn);
+
+		double serialSeconds = 0.0;
+		double parallelSeconds = 0.0;
+		for (int step = 0; step < numSteps; step++)
+		{
+			double startTime = GetCurrentTimeSeconds();
+			serialCourt.UpdatePhysics(g_theGame->m_fixedTimeStep);
+			serialSeconds += GetCurrentTimeSeconds() - startTime;
+
+			startTime = GetCurrentTimeSeconds();
+			parallelCourt.UpdatePhysics(g_theGame->m_fixedTimeStep);
+			parallelSeconds += GetCurrentTimeSeconds() - startTime;
+		}
+
+		int numMismatches = courts.CountBallMismatches(0, 1);
+		BallContactIslands const& islands = parallelCourt.m_ballContactIslands;
+		g_theDevConsole->AddLine(numMismatches == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+			Stringf("  %6d balls: serial %7.3f ms/step, parallel %7.3f ms/step (%.1fx), %d islands, largest %d pairs, %d mismatches",
+				numBalls, serialSeconds * 1000.0 / numSteps, parallelSeconds * 1000.0 / numSteps, parallelSeconds > 0.0 ? serialSeconds / parallelSeconds : 0.0,
+				islands.m_numIslands, islands.m_largestIslandPairs, numMismatches));
+	}
+
+	return false;
+}
+
+bool Command_StaticColliderBenchmark(EventArgs& args)
+{
+	BasketballCourt const* court = g_theGame->m_map;
+	if (!court)
+	{
+		g_theDevConsole->AddLine(DevConsole::ERROR, "Start a game first, the benchmark uses the current court");
+		return false;
+	}
+	int numQueries = args.GetValue("queries", 1000000);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	CourtColliderBVH const& colliders = court->m_staticColliders;
+
+	// Ball positions spread over the whole court and up to the top of the backboards
+	std::vector<Vec3> positions;
+	positions.reserve(numQueries);
+	RandomNumberGenerator rng(seed);
+	for (int i = 0; i < numQueries; i++)
+	{
+		positions.push_back(Vec3(rng.RollRandomFloatInRange(-50.f, 50.f), rng.RollRandomFloatInRange(-50.f, 50.f), rng.RollRandomFloatInRange(0.f, 18.f)));
+	}
+
+	// Every collider against every position, the way the hard-coded checks worked
+	long long bruteTests = 0;
+	long long bruteHits = 0;
+	double startTime = GetCurrentTimeSeconds();
+	for (int i = 0; i < numQueries; i++)
+	{
+		for (int colliderIndex = 0; colliderIndex < colliders.GetNumColliders(); colliderIndex++)
+		{
+			Vec3 nearestPoint = colliders.GetCollider(colliderIndex).GetNearestPoint(positions[i]);
+			bruteTests++;
+			if (GetDistanceSquared3D(nearestPoint, positions[i]) < BALL_RADIUS * BALL_RADIUS)
+			{
+				bruteHits++;
+			}
+		}
+	}
+	double bruteSeconds = GetCurrentTimeSeconds() - startTime;
+
+	long long bvhTests = 0;
+	long long bvhHits = 0;
+	float const queryHalfExtent = 2.f * BALL_RADIUS;
+	Vec3 const halfExtents = Vec3(queryHalfExtent, queryHalfExtent, queryHalfExtent);
+	startTime = GetCurrentTimeSeconds();
+	for (int i = 0; i < numQueries; i++)
+	{
+		int colliderIndexes[MAX_COURT_COLLIDER_CANDIDATES];
+		int numCandidates = colliders.Query(AABB3(positions[i] - halfExtents, positions[i] + halfExtents), colliderIndexes, MAX_COURT_COLLIDER_CANDIDATES);
+		for (int candidate = 0; candidate < numCandidates; candidate++)
+		{
+			Vec3 nearestPoint = colliders.GetCollider(colliderIndexes[candidate]).GetNearestPoint(positions[i]);
+			bvhTests++;
+			if (GetDistanceSquared3D(nearestPoint, positions[i]) < BALL_RADIUS * BALL_RADIUS)
+			{
+				bvhHits++;
+			}
+		}
+	}
+	double bvhSeconds = GetCurrentTimeSeconds() - startTime;
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Static collider benchmark: %d positions, %d colliders, %d BVH nodes", numQueries, colliders.GetNumColliders(), colliders.GetNumNodes()));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  all colliders: %7.2f ms, %lld narrowphase tests, %lld hits", bruteSeconds * 1000.0, bruteTests, bruteHits));
+	g_theDevConsole->AddLine(bvhHits == bruteHits ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+		Stringf("  BVH:           %7.2f ms, %lld narrowphase tests, %lld hits", bvhSeconds * 1000.0, bvhTests, bvhHits));
+	return false;
+}
+
+bool Command_BlockerTreeBenchmark(EventArgs& args)
+{
+	int level = args.GetValue("level", 60);
+	int numBalls = args.GetValue("balls", 500);
+	int numSteps = args.GetValue("steps", 200);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	numBalls = numBalls < MAX_BALLS ? numBalls : MAX_BALLS;
+
+	// The same obstacle level and the same balls, one court checking every blocker for every ball.
+	// Both run serially so the timings only differ by the blocker broadphase
+	MatchedCourts courts(2);
+	BasketballCourt& treeCourt = *courts.m_courts[0];
+	BasketballCourt& bruteCourt = *courts.m_courts[1];
+	treeCourt.m_isPhysicsMultithreaded = false;
+	bruteCourt.m_isPhysicsMultithreaded = false;
+	bruteCourt.m_isBlockerTreeEnabled = false;
+	courts.CreatePlayers(Vec3(-7.f, -7.f, 1.f));
+	for (int courtIndex = 0; courtIndex < 2; courtIndex++)
+	{
+		RandomNumberGenerator blockerRng(seed);
+		courts.m_courts[courtIndex]->SpawnRandomBlockers(level + 2, blockerRng);
+	}
+
+	// Balls dropped over the half of the court the blockers spawn on
+	MatchedBallSpawn spawn;
+	spawn.m_seed = seed + 1;
+	spawn.m_numBalls = numBalls;
+	spawn.m_bounds = AABB3(Vec3(0.f, -27.f, BALL_RADIUS), Vec3(22.f, 27.f, 20.f));
+	spawn.m_velocityScale = Vec3(10.f, 10.f, 10.f);
+	courts.SpawnBalls(spawn);
+
+	// Blocker timers run on the system clock, which doesn't move during the benchmark, so heights are
+	// driven here instead. Each moving blocker sweeps between its min and max height once per its period
+	double treeSeconds = 0.0;
+	double bruteSeconds = 0.0;
+	for (int step = 0; step < numSteps; step++)
+	{
+		float stepSeconds = (float)step * g_theGame->m_fixedTimeStep;
+		for (int courtIndex = 0; courtIndex < 2; courtIndex++)
+		{
+			std::vector<Blocker*>& blockers = courts.m_courts[courtIndex]->m_blockerList;
+			for (size_t i = 0; i < blockers.size(); i++)
+			{
+				if (blockers[i]->m_type != BlockerType::STATIC_BLOCK)
+				{
+					float fraction = 0.5f + 0.5f * SinDegrees(360.f * stepSeconds / blockers[i]->m_timer.m_period + 37.f * (float)i);
+					blockers[i]->m_height = Interpolate(blockers[i]->m_minHeight, blockers[i]->m_maxHeight, fraction);
+				}
+			}
+		}
+
+		double startTime = GetCurrentTimeSeconds();
+		treeCourt.UpdatePhysics(g_theGame->m_fixedTimeStep);
+		treeSeconds += GetCurrentTimeSeconds() - startTime;
+
+		startTime = GetCurrentTimeSeconds();
+		bruteCourt.UpdatePhysics(g_theGame->m_fixedTimeStep);
+		bruteSeconds += GetCurrentTimeSeconds() - startTime;
+	}
+
+	int numMismatches = courts.CountBallMismatches(1, 0);
+	DynamicAABBTree const& tree = treeCourt.m_blockerTree;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Blocker tree benchmark: level %d, %d blockers, %d balls, %d steps, seed %u",
+		level, tree.GetNumProxies(), numBalls, numSteps, seed));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  every blocker: %7.3f ms/step", bruteSeconds * 1000.0 / numSteps));
+	g_theDevConsole->AddLine(numMismatches == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+		Stringf("  blocker tree:  %7.3f ms/step (%.1fx), height %d, %d reinsertions, %d mismatches",
+			treeSeconds * 1000.0 / numSteps, treeSeconds > 0.0 ? bruteSeconds / treeSeconds : 0.0, tree.GetHeight(), tree.GetNumReinsertions(), numMismatches));
+	return false;
+}
+
+bool Command_BallSleepBenchmark(EventArgs& args)
+{
+	int numBalls = args.GetValue("balls", 4000);
+	int numSettleSteps = args.GetValue("settle", 1000);
+	int numSteps = args.GetValue("steps", 200);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	numBalls = numBalls < MAX_BALLS ? numBalls : MAX_BALLS;
+
+	// The same balls dropped just above the floor, one court never lets them sleep.
+	// Both settle first, then the steps of a court full of idle balls are timed
+	MatchedCourts courts(2);
+	BasketballCourt& sleepingCourt = *courts.m_courts[0];
+	BasketballCourt& awakeCourt = *courts.m_courts[1];
+	awakeCourt.m_isBallSleepEnabled = false;
+	courts.CreatePlayers(Vec3(-3.f, -3.f, 1.f));
+	MatchedBallSpawn spawn;
+	spawn.m_seed = seed;
+	spawn.m_numBalls = numBalls;
+	spawn.m_bounds = AABB3(Vec3(-45.f, -45.f, BALL_RADIUS), Vec3(45.f, 45.f, 3.f));
+	spawn.m_velocityScale = Vec3(1.f, 1.f, 0.f);
+	courts.SpawnBalls(spawn);
+
+	double settleSeconds[2] = { 0.0, 0.0 };
+	double idleSeconds[2] = { 0.0, 0.0 };
+	for (int step = 0; step < numSettleSteps + numSteps; step++)
+	{
+		for (int courtIndex = 0; courtIndex < 2; courtIndex++)
+		{
+			double startTime = GetCurrentTimeSeconds();
+			courts.m_courts[courtIndex]->UpdatePhysics(g_theGame->m_fixedTimeStep);
+			double seconds = GetCurrentTimeSeconds() - startTime;
+			if (step < numSettleSteps)
+			{
+				settleSeconds[courtIndex] += seconds;
+			}
+			else
+			{
+				idleSeconds[courtIndex] += seconds;
+			}
+		}
+	}
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball sleep benchmark: %d balls, %d settling steps, %d timed steps, seed %u", numBalls, numSettleSteps, numSteps, seed));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  sleep off: settling %7.3f ms/step, idle %7.3f ms/step, %d awake, %d asleep",
+		settleSeconds[1] * 1000.0 / (numSettleSteps > 0 ? numSettleSteps : 1), idleSeconds[1] * 1000.0 / (numSteps > 0 ? numSteps : 1), awakeCourt.m_numAwakeBalls, awakeCourt.m_numSleepingBalls));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  sleep on:  settling %7.3f ms/step, idle %7.3f ms/step, %d awake, %d asleep",
+		settleSeconds[0] * 1000.0 / (numSettleSteps > 0 ? numSettleSteps : 1), idleSeconds[0] * 1000.0 / (numSteps > 0 ? numSteps : 1), sleepingCourt.m_numAwakeBalls, sleepingCourt.m_numSleepingBalls));
+	return false;
+}
+
+bool Command_ObstacleLevelAllocationTest(EventArgs& args)
+{
+	int firstLevel = args.GetValue("level", 1);
+	int numLevels = args.GetValue("levels", 50);
+	int numBallsPerLevel = args.GetValue("balls", 20);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	firstLevel = firstLevel > 0 ? firstLevel : 0;
+	numLevels = numLevels > 1 ? numLevels : 1;
+	numBallsPerLevel = numBallsPerLevel < MAX_BALLS ? numBallsPerLevel : MAX_BALLS;
+
+	BasketballCourt court;
+	court.m_player = court.CreatePlayer(Vec3(-7.f, -7.f, 1.f));
+	RandomNumberGenerator rng(seed);
+
+	// What scoring does in obstacle mode: the player has thrown some balls, the next level's blockers
+	// replace the old ones and every ball the player isn't holding goes
+	auto changeLevel = [&court, &rng, numBallsPerLevel](int level)
+		{
+			for (int i = 0; i < numBallsPerLevel; i++)
+			{
+				court.CreateBall(Vec3(rng.RollRandomFloatInRange(0.f, 22.f), rng.RollRandomFloatInRange(-27.f, 27.f), 10.f));
+			}
+			court.SpawnRandomBlockers(level + 2, rng);
+			court.DeleteAllBallsThatPlayerNotHolding();
+		};
+
+	// Building the biggest level once is the only time the court should need memory, every level
+	// change after that reuses it
+	changeLevel(firstLevel + numLevels - 1);
+	int warmUpPageAllocations = court.GetNumObjectPoolPageAllocations();
+	size_t blockerListCapacity = court.m_blockerList.capacity();
+	int blockerTreeCapacity = court.m_blockerTree.GetNodeCapacity();
+
+	double startTime = GetCurrentTimeSeconds();
+	for (int level = firstLevel; level < firstLevel + numLevels; level++)
+	{
+		changeLevel(level);
+	}
+	double seconds = GetCurrentTimeSeconds() - startTime;
+
+	int numPageAllocations = court.GetNumObjectPoolPageAllocations() - warmUpPageAllocations;
+	int numContainerGrowths = (court.m_blockerList.capacity() != blockerListCapacity ? 1 : 0) + (court.m_blockerTree.GetNodeCapacity() != blockerTreeCapacity ? 1 : 0);
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Obstacle level allocation test: levels %d to %d, %d balls thrown per level, seed %u",
+		firstLevel, firstLevel + numLevels - 1, numBallsPerLevel, seed));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  warm-up: %d pool pages, room for %d blockers and %d balls",
+		warmUpPageAllocations, court.m_blockerPool.GetCapacity(), court.m_ballPool.GetCapacity()));
+	g_theDevConsole->AddLine(numPageAllocations == 0 && numContainerGrowths == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+		Stringf("  %d level changes: %.3f ms each, %d pool page allocations, %d blocker list or tree growths",
+			numLevels, seconds * 1000.0 / numLevels, numPageAllocations, numContainerGrowths));
+	return false;
+}
+
+bool Command_BallRaycastBenchmark(EventArgs& args)
+{
+	int numBalls = args.GetValue("balls", 10000);
+	int numRays = args.GetValue("rays", 2000);
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	numBalls = numBalls < MAX_BALLS ? numBalls : MAX_BALLS;
+
+	// Balls standing still, rays are rolled separately so the balls match any other run with the same seed
+	MatchedCourts courts(1);
+	BasketballCourt& court = *courts.m_courts[0];
+	MatchedBallSpawn spawn;
+	spawn.m_seed = seed;
+	spawn.m_numBalls = numBalls;
+	spawn.m_bounds = AABB3(Vec3(-48.f, -48.f, BALL_RADIUS), Vec3(48.f, 48.f, 20.f));
+	spawn.m_velocityScale = Vec3::ZERO;
+	courts.SpawnBalls(spawn);
+	RandomNumberGenerator rng(seed + 1);
+
+	double startTime = GetCurrentTimeSeconds();
+	court.RebuildBallGrid();
+	court.BuildBallRayBatch();
+	double buildSeconds = GetCurrentTimeSeconds() - startTime;
+
+	std::vector<Vec3> startPositions;
+	std::vector<Vec3> fwdNormals;
+	for (int i = 0; i < numRays; i++)
+	{
+		startPositions.push_back(Vec3(rng.RollRandomFloatInRange(-50.f, 50.f), rng.RollRandomFloatInRange(-50.f, 50.f), rng.RollRandomFloatInRange(0.f, 20.f)));
+		fwdNormals.push_back(Vec3(rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne()).GetNormalized());
+	}
+
+	// The player's pick ray, and a long ray against balls of their real size. The reference tests every
+	// ball in dense order with RaycastVsSphere3D and keeps the first of the closest hits
+	float const maxDists[2] = { RAY_CAST_LENGTH, 100.f };
+	float const sphereRadii[2] = { RAY_CAST_RADIUS, BALL_RADIUS };
+	char const* rayNames[2] = { "pick ray", "long ray" };
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Ball raycast benchmark: %d balls, %d rays, seed %u, batch built in %.3f ms",
+		numBalls, numRays, seed, buildSeconds * 1000.0));
+	for (int rayType = 0; rayType < 2; rayType++)
+	{
+		float maxDist = maxDists[rayType];
+		float sphereRadius = sphereRadii[rayType];
+		std::vector<BallRayHit> expectedHits(numRays);
+		std::vector<BallRayHit> scalarHits(numRays);
+		std::vector<BallRayHit> simdHits(numRays);
+
+		startTime = GetCurrentTimeSeconds();
+		for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+		{
+			BallRayHit& hit = expectedHits[rayIndex];
+			for (int i = 0; i < court.m_balls.GetNumBalls(); i++)
+			{
+				RaycastResult3D ray = RaycastVsSphere3D(startPositions[rayIndex], fwdNormals[rayIndex], maxDist, court.m_balls[i]->m_position, sphereRadius);
+				if (ray.m_didImpact && (hit.m_ballIndex < 0 || ray.m_impactDist < hit.m_distance))
+				{
+					hit.m_ballIndex = i;
+					hit.m_distance = ray.m_impactDist;
+				}
+			}
+		}
+		double bruteSeconds = GetCurrentTimeSeconds() - startTime;
+
+		startTime = GetCurrentTimeSeconds();
+		for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+		{
+			scalarHits[rayIndex] = RaycastVsBallRayBatchScalar(court.m_ballRayBatch, startPositions[rayIndex], fwdNormals[rayIndex], maxDist, sphereRadius);
+		}
+		double scalarSeconds = GetCurrentTimeSeconds() - startTime;
+
+		startTime = GetCurrentTimeSeconds();
+		for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+		{
+			simdHits[rayIndex] = RaycastVsBallRayBatchSIMD(court.m_ballRayBatch, startPositions[rayIndex], fwdNormals[rayIndex], maxDist, sphereRadius);
+		}
+		double simdSeconds = GetCurrentTimeSeconds() - startTime;
+
+		int numHits = 0;
+		int numScalarMismatches = 0;
+		int numSIMDMismatches = 0;
+		for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+		{
+			BallRayHit const& expected = expectedHits[rayIndex];
+			numHits += expected.m_ballIndex >= 0 ? 1 : 0;
+			if (scalarHits[rayIndex].m_ballIndex != expected.m_ballIndex || (expected.m_ballIndex >= 0 && scalarHits[rayIndex].m_distance != expected.m_distance))
+			{
+				numScalarMismatches++;
+			}
+			if (simdHits[rayIndex].m_ballIndex != expected.m_ballIndex || (expected.m_ballIndex >= 0 && simdHits[rayIndex].m_distance != expected.m_distance))
+			{
+				numSIMDMismatches++;
+			}
+		}
+
+		// RaycastVsBall has to agree with the reference too, it only runs the pick ray
+		int numCourtMismatches = 0;
+		if (rayType == 0)
+		{
+			for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+			{
+				GameRaycast3D expected = court.RaycastVsBallBruteForce(startPositions[rayIndex], fwdNormals[rayIndex]);
+				GameRaycast3D actual = court.RaycastVsBall(startPositions[rayIndex], fwdNormals[rayIndex]);
+				if (expected.m_hitBall != actual.m_hitBall || expected.m_impactDist != actual.m_impactDist)
+				{
+					numCourtMismatches++;
+				}
+			}
+		}
+
+		int numMismatches = numScalarMismatches + numSIMDMismatches + numCourtMismatches;
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %s: length %.1f, radius %.2f, %d hits", rayNames[rayType], maxDist, sphereRadius, numHits));
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("    every ball:   %8.4f ms/ray", bruteSeconds * 1000.0 / numRays));
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("    batch scalar: %8.4f ms/ray (%.1fx)", scalarSeconds * 1000.0 / numRays, scalarSeconds > 0.0 ? bruteSeconds / scalarSeconds : 0.0));
+		g_theDevConsole->AddLine(numMismatches == 0 ? DevConsole::INFO_MINOR : DevConsole::ERROR,
+			Stringf("    batch SIMD:   %8.4f ms/ray (%.1fx), %d scalar, %d SIMD and %d RaycastVsBall mismatches",
+				simdSeconds * 1000.0 / numRays, simdSeconds > 0.0 ? bruteSeconds / simdSeconds : 0.0, numScalarMismatches, numSIMDMismatches, numCourtMismatches));
+	}
+	return false;
+}
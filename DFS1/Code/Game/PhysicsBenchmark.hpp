@@ -0,0 +1,165 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Game/BasketballCourt.hpp"
+
+// A repeatable court workload: balls dropped onto the court, blockers, and shots at hoop A fired
+// every m_stepsPerShot steps. Everything comes from m_seed, so two runs with the same config simulate
+// the same thing and end with the same checksum.
+struct PhysicsScenarioConfig
+{
+	unsigned int m_seed = 1234;
+	int m_numBalls = 1000;
+	int m_numBlockers = 0;
+	int m_numShots = 100;
+	int m_stepsPerShot = 20;
+	int m_numSteps = 2000;
+	bool m_isMultithreaded = true;
+};
+
+struct PhysicsScenarioResult
+{
+	int m_numSteps = 0;
+	long long m_numBallSteps = 0;
+	double m_seconds = 0.0;
+	int m_numBallsAtEnd = 0;
+	int m_numSleepingBallsAtEnd = 0;
+	int m_numScores = 0;
+	unsigned int m_checksum = 0;
+	BallRenderRecord m_ballRenderRecord;
+
+	double GetStepsPerSecond() const;
+	double GetNanosecondsPerBallStep() const;
+};
+
+// Keys: seed, balls, blockers, shots, shotsteps, steps, multithreaded
+PhysicsScenarioConfig ParsePhysicsScenarioConfig(EventArgs& args);
+// Only needs g_theGame, g_theJobSystem and the system clock; renderer, audio and window may be null
+PhysicsScenarioResult RunPhysicsScenario(PhysicsScenarioConfig const& config);
+std::string FormatPhysicsScenarioReport(PhysicsScenarioConfig const& config, PhysicsScenarioResult const& result);
+
+bool Command_PhysicsBenchmark(EventArgs& args);
+
+// Shots at full throwing speed straight at hoop A's backboard. A shot passes through if the ball ever
+// gets behind the board, which continuous collision has to prevent at any fixed step rate. With it on,
+// as many fast balls also skim diagonally past the board's top edge without touching it, and any that
+// the sweep stops anyway are false hits.
+struct TunnelingTestResult
+{
+	float m_physicsHz = 0.f;
+	bool m_isContinuousCollisionEnabled = false;
+	int m_numShots = 0;
+	int m_numPassThroughs = 0;
+	int m_numNearMisses = 0;
+	int m_numFalseHits = 0;
+
+	bool HasFailed() const { return m_isContinuousCollisionEnabled && (m_numPassThroughs > 0 || m_numFalseHits > 0); }
+};
+
+TunnelingTestResult RunTunnelingTest(unsigned int seed, int numShots, float physicsHz, bool isContinuousCollisionEnabled);
+// Keys: seed, shots, hz (200, 120 and 60 when missing). Every rate runs with continuous collision off and on
+std::vector<TunnelingTestResult> RunTunnelingTests(EventArgs& args);
+std::string FormatTunnelingTestReport(TunnelingTestResult const& result);
+bool HasTunnelingTestFailed(std::vector<TunnelingTestResult> const& results);
+
+bool Command_TunnelingTest(EventArgs& args);
+
+// The court's world pass for one frame, recorded with no renderer in the order it was filled and sorted.
+// Sorting has to draw the same things with no more state changes, and come out the same every time
+struct RenderQueueTestResult
+{
+	int m_numBalls = 0;
+	int m_numBlockers = 0;
+	RenderQueueStats m_unsorted;
+	RenderQueueStats m_sorted;
+	bool m_isSortedDeterministic = false;
+
+	bool HasFailed() const;
+};
+
+// Keys: seed, balls, blockers
+RenderQueueTestResult RunRenderQueueTest(EventArgs& args);
+std::string FormatRenderQueueTestReport(RenderQueueTestResult const& result);
+
+bool Command_RenderQueueTest(EventArgs& args);
+
+// The court's world pass recorded serially and then in parallel with 1, 2, 4... workers, each timed over
+// m_numRepeats builds. Every merged queue has to be the serial one, packet for packet and vertex for vertex
+struct RenderRecordingRun
+{
+	int m_numWorkers = 0;
+	double m_seconds = 0.0;
+	bool m_isSameAsSerial = false;
+};
+
+struct RenderRecordingTestResult
+{
+	int m_numBalls = 0;
+	int m_numBlockers = 0;
+	int m_numRepeats = 0;
+	int m_numPackets = 0;
+	unsigned int m_checksum = 0;
+	double m_serialSeconds = 0.0;
+	std::vector<RenderRecordingRun> m_runs;
+
+	bool HasFailed() const;
+};
+
+// Keys: seed, balls, blockers, repeats, workers (the most workers to try)
+RenderRecordingTestResult RunRenderRecordingTest(EventArgs& args);
+std::string FormatRenderRecordingTestReport(RenderRecordingTestResult const& result);
+
+bool Command_RenderRecordingTest(EventArgs& args);
+
+// Benchmarks that step the same balls two or more ways start from courts set up identically here and
+// compare them bit for bit afterwards
+struct MatchedBallSpawn
+{
+	unsigned int m_seed = 1234;
+	int m_numBalls = 1000;
+	AABB3 m_bounds = AABB3(Vec3(-49.f, -49.f, BALL_RADIUS), Vec3(49.f, 49.f, 6.f));
+	Vec3 m_velocityScale = Vec3(5.f, 5.f, 5.f);
+	float m_angularSpeed = 0.f; // 0 leaves the balls without spin
+};
+
+struct MatchedCourts
+{
+	explicit MatchedCourts(int numCourts);
+	~MatchedCourts();
+	MatchedCourts(MatchedCourts const& copy) = delete;
+
+	void CreatePlayers(Vec3 const& position);
+	// Every court gets the same balls in the same order, rolled once from spawn.m_seed
+	void SpawnBalls(MatchedBallSpawn const& spawn);
+	// Balls whose position, velocity, spin or rotation differ at all, by dense index. Balls only one court has count too
+	int CountBallMismatches(int expectedCourtIndex, int actualCourtIndex) const;
+
+	std::vector<BasketballCourt*> m_courts;
+};
+
+// Vec3::operator== has a tolerance, these compare every bit
+bool IsSameVec3Exactly(Vec3 const& a, Vec3 const& b);
+bool IsSameBallStateExactly(Ball const* a, Ball const* b);
+
+// Keys: steps, balls (100, 1000 and 10000 when missing)
+bool Command_BallBroadphaseBenchmark(EventArgs& args);
+
+// Keys: steps, balls (1000 and 10000 when missing). Single thread, per-object vs scalar slots vs SIMD slots
+bool Command_BallIntegrationBenchmark(EventArgs& args);
+
+// Keys: steps, seed, balls (1000, 4000 and 10000 when missing). Serial vs the JobSystem's workers
+bool Command_PhysicsStepBenchmark(EventArgs& args);
+
+// Keys: queries, seed. Every collider vs the BVH, over the current game's court
+bool Command_StaticColliderBenchmark(EventArgs& args);
+
+// Keys: level, balls, steps, seed. The blocker tree vs every blocker for every ball, both serial
+bool Command_BlockerTreeBenchmark(EventArgs& args);
+
+// Keys: balls, settle, steps, seed. Idle steps of a settled court with ball sleep on vs off
+bool Command_BallSleepBenchmark(EventArgs& args);
+
+// Keys: level, levels, balls, seed. Obstacle level changes after the first may not allocate
+bool Command_ObstacleLevelAllocationTest(EventArgs& args);
+
+// Keys: balls, rays, seed. Every ball vs the packed batch, scalar and SIMD, and RaycastVsBall
+bool Command_BallRaycastBenchmark(EventArgs& args);
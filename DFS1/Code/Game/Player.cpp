@@ -3,6 +3,8 @@
 #include "Game/Prop.hpp"
 #include "Game/Ball.hpp"
 #include "Game/BasketballCourt.hpp"
+#include "Game/ShotSolver.hpp"
+#include <climits>
 
 bool g_gameplayMode = true;
 
@@ -15,12 +17,15 @@ Player::Player(BasketballCourt* map)
 	m_mass = 2.f;
 	m_isGravityEnabled = true;
 	m_playerCamera = new Camera();
-	m_playerCamera->SetPerspectiveView(Window::GetMainWindowInstance()->GetAspect(), 60.f, 0.1f, 200.f);
+	Window* window = Window::GetMainWindowInstance();
+	m_playerCamera->SetPerspectiveView(window ? window->GetAspect() : g_gameConfigBlackboard.GetValue("aspectRation", 2.f), 60.f, 0.1f, 200.f);
 	m_playerCamera->SetRenderBasis(Vec3(0.f, 0.f, 1.f), Vec3(-1.f, 0.f, 0.f), Vec3(0.f, 1.f, 0.f));
 }
 
 Player::~Player()
 {
+	delete m_playerCamera;
+	m_playerCamera = nullptr;
 }
 
 void Player::Update(float deltaSeconds)
@@ -34,7 +39,7 @@ void Player::Update(float deltaSeconds)
 	BallThrowingConstraint();
 }
 
-void Player::Render() const
+void Player::Render(RenderQueue& queue) const
 {
 	if (g_gameplayMode)
 	{
@@ -45,16 +50,15 @@ void Player::Render() const
 
 	AddVertsForZCylinder3D(verts, Vec2(0, 0), FloatRange(0, m_height), m_radius, 16);
 
-	g_theRenderer->BindShader(nullptr);
-	g_theRenderer->BindTexture(nullptr);
-	g_theRenderer->SetModelConstants(GetModelMatrix(), m_color);
-	g_theRenderer->SetDepthStencilMode(DepthMode::ENABLED);
-	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_BACK);
-	g_theRenderer->DrawVertexArray((int)verts.size(), verts.data());
+	RenderDrawState state;
+	state.m_modelMatrix = GetModelMatrix();
+	state.m_modelColor = m_color;
+	queue.AddVertexArray(state, verts.size(), verts.data());
 }
 
 void Player::RenderUI() const
 {
+	g_theRenderer->SetBlendMode(BlendMode::ALPHA);
 	g_theRenderer->SetRasterizerMode(RasterizerMode::SOLID_CULL_NONE);
 	g_theRenderer->BindShader(nullptr);
 	g_theRenderer->SetModelConstants();
@@ -196,21 +200,26 @@ void Player::PlayerDataUpdateEveryFrame()
 		{
 			m_isJumped = false;
 		}
-		if (m_isHoldingBall && m_currentBall)
+		Ball* currentBall = GetCurrentBall();
+		if (m_isHoldingBall && currentBall)
 		{
-			m_currentBall->m_position = m_refPos;
-			m_currentBall->m_rotation = Quaternion(EulerAngles(m_orientationDegrees.m_yawDegrees, m_orientationDegrees.m_pitchDegrees, 90.f));
+			currentBall->m_position = m_refPos;
+			currentBall->m_rotation = Quaternion(EulerAngles(m_orientationDegrees.m_yawDegrees, m_orientationDegrees.m_pitchDegrees, 90.f));
 		}
 		if (g_theGame->m_currentGameMode == TIMER)
 		{
 			if (!m_isHoldingBall)
 			{
 				m_timeSinceThrowBall += g_theGame->m_clock->GetDeltaSeconds();
-				if (m_timeSinceThrowBall > 0.5f && !m_currentBall)
+				if (m_timeSinceThrowBall > 0.5f && !currentBall)
 				{
-					m_currentBall = m_map->CreateBall(m_position);
-					m_isHoldingBall = true;
-					m_currentBall->m_isSimulatingPhysics = false;
+					currentBall = m_map->CreateBall(m_position);
+					if (currentBall)
+					{
+						m_currentBall = m_map->m_balls.GetHandle(currentBall);
+						m_isHoldingBall = true;
+						currentBall->m_isSimulatingPhysics = false;
+					}
 				}
 			}
 			else
@@ -315,7 +324,7 @@ void Player::DebugDataPrint()
 			DebugAddScreenText(Stringf("Spin Force Z: %.f", m_spinForce.z), Vec2(20.f, 440.f), 20.f, Rgba8::COLOR_DARK_GRAY);
 		}
 
-		DebugAddScreenText(Stringf("Total balls : %i", m_map->m_ballList.size()), Vec2(20, 20), 20);
+		DebugAddScreenText(Stringf("Total balls : %i", m_map->m_balls.GetNumBalls()), Vec2(20, 20), 20);
 	}
 	else
 	{
@@ -341,47 +350,78 @@ void Player::BallThrowingConstraint()
 
 void Player::Shoot()
 {
-	if (!m_currentBall)
+	Ball* currentBall = GetCurrentBall();
+	if (!currentBall)
 	{
 		return;
 	}
-	m_currentBall->m_isSimulatingPhysics = true;
-	m_currentBall->AddImpulse(m_throwDirection * m_throwForce);
-	m_currentBall->AddTorque(m_currentBall->m_position - GetModelMatrix().GetIBasis3D(), Vec3(0.f, -m_spinPosition.x, m_spinPosition.y) * m_spinForce);
+	currentBall->m_isSimulatingPhysics = true;
+	currentBall->AddImpulse(m_throwDirection * m_throwForce);
+	currentBall->AddTorque(currentBall->m_position - GetModelMatrix().GetIBasis3D(), Vec3(0.f, -m_spinPosition.x, m_spinPosition.y) * m_spinForce);
 	if (g_gameplayMode)
 	{
 		m_isHoldingBall = false;
-		m_currentBall = nullptr;
+		m_currentBall = BallHandle();
 	}
 }
 
+void Player::ShootWithAimAssist()
+{
+	Ball* currentBall = GetCurrentBall();
+	if (!currentBall)
+	{
+		return;
+	}
+	Hoop* hoop = m_map->m_hoopA;
+	if (m_map->m_hoopB && GetDistanceSquared3D(m_position, m_map->m_hoopB->m_collider.GetCenter()) < GetDistanceSquared3D(m_position, hoop->m_collider.GetCenter()))
+	{
+		hoop = m_map->m_hoopB;
+	}
+
+	ShotSolverConfig config;
+	config.m_seed = g_theRNG->RollRandomUnsignedIntInRange(0, 0x7fffffff);
+	config.m_budgetSeconds = (double)g_gameConfigBlackboard.GetValue("shotSolverBudgetMs", 2.f) / 1000.0;
+	config.m_maxCandidates = INT_MAX;
+	config.m_fixedDeltaSeconds = g_theGame->m_fixedTimeStep;
+	config.m_isMultithreaded = m_map->m_isPhysicsMultithreaded;
+	ShotSolverResult result = SolveShot(MakeShotSolverBall(currentBall, this), MakeShotSolverTarget(m_map, hoop), config);
+
+	// With nothing that scores, the closest miss still goes up
+	m_throwDirection = result.m_bestShot.m_throwDirection;
+	m_throwForce = result.m_bestShot.m_throwForce;
+	m_spinPosition = result.m_bestShot.m_spinPosition;
+	m_spinForce = result.m_bestShot.m_spinForce;
+	Shoot();
+}
+
 void Player::Dribble()
 {
-	if (!m_currentBall)
+	Ball* currentBall = GetCurrentBall();
+	if (!currentBall)
 	{
 		return;
 	}
-	m_currentBall->m_isSimulatingPhysics = true;
+	currentBall->m_isSimulatingPhysics = true;
 	float power = Vec2(m_velocity.x, m_velocity.y).GetLength() * 0.1f;
-	m_currentBall->AddImpulse(Vec3(GetModelMatrix().GetIBasis3D().x * power, GetModelMatrix().GetIBasis3D().y * power, -1) * 1700.f);
+	currentBall->AddImpulse(Vec3(GetModelMatrix().GetIBasis3D().x * power, GetModelMatrix().GetIBasis3D().y * power, -1) * 1700.f);
 	Vec3 spin = Vec3(g_theRNG->RollRandomFloatMinusOneToOne(), g_theRNG->RollRandomFloatMinusOneToOne(), g_theRNG->RollRandomFloatMinusOneToOne());
-	m_currentBall->AddImpulseTorque(spin * 1.5f);
+	currentBall->AddImpulseTorque(spin * 1.5f);
 	m_isHoldingBall = false;
-	m_currentBall = nullptr;
+	m_currentBall = BallHandle();
 }
 
 void Player::PickUpBallWithRaycast()
 {
 	GameRaycast3D ray = m_map->RaycastVsBall(m_refPos, GetModelMatrix().GetIBasis3D());
-	if (!m_currentBall)
+	if (!GetCurrentBall())
 	{
 		if (ray.m_didImpact)
 		{
 			if (g_theInput->WasKeyJustPressed(KEYCODE_RIGHT_MOUSE) || g_theInput->WasKeyJustPressed('F'))
 			{
-				m_currentBall = ray.m_hitBall;
+				m_currentBall = m_map->m_balls.GetHandle(ray.m_hitBall);
 				m_isHoldingBall = true;
-				m_currentBall->m_isSimulatingPhysics = false;
+				ray.m_hitBall->m_isSimulatingPhysics = false;
 			}
 		}
 	}
@@ -401,7 +441,7 @@ void Player::AdjustAngle()
 
 void Player::AdjustForce()
 {
-	if (!m_currentBall)
+	if (!GetCurrentBall())
 	{
 		return;
 	}
@@ -410,7 +450,7 @@ void Player::AdjustForce()
 
 void Player::DebugOptionControl()
 {
-	if (g_theInput->WasKeyJustPressed(KEYCODE_LEFT_MOUSE) && m_currentBall)
+	if (g_theInput->WasKeyJustPressed(KEYCODE_LEFT_MOUSE) && GetCurrentBall())
 	{
 		Shoot();
 	}
@@ -420,7 +460,7 @@ void Player::DebugOptionControl()
 	}
 	if (g_theInput->WasKeyJustPressed('N'))
 	{
-		m_currentBall = m_map->CreateBall(Vec3(0, 0, 2));
+		m_currentBall = m_map->m_balls.GetHandle(m_map->CreateBall(Vec3(0, 0, 2)));
 	}
 	if (g_theInput->WasMouseWheelScrolledDown())
 	{
@@ -571,6 +611,10 @@ void Player::DebugOptionControl()
 			float randYPos = g_theRNG->RollRandomFloatInRange(-10.f, 10.f);
 			float randZPos = g_theRNG->RollRandomFloatInRange(25.f, 30.f);
 			Ball* ball = m_map->CreateBall(Vec3(randXPos, randYPos, randZPos));
+			if (!ball)
+			{
+				break;
+			}
 
 			float randXVel = g_theRNG->RollRandomFloatInRange(-15.f, 15.f);
 			float randYVel = g_theRNG->RollRandomFloatInRange(-15.f, 15.f);
@@ -590,12 +634,16 @@ void Player::GameplayOptionControl()
 	{
 		if (g_theInput->WasKeyJustPressed('N'))
 		{
-			if (!m_currentBall)
+			if (!GetCurrentBall())
 			{
-				m_currentBall = m_map->CreateBall(m_position);
-				m_isHoldingBall = true;
+				m_currentBall = m_map->m_balls.GetHandle(m_map->CreateBall(m_position));
+				m_isHoldingBall = GetCurrentBall() != nullptr;
 			}
 		}
+		if (g_theInput->WasKeyJustPressed('G') && GetCurrentBall())
+		{
+			ShootWithAimAssist();
+		}
 
 		if (g_theInput->IsKeyDown(KEYCODE_LEFT_MOUSE))
 		{
@@ -603,11 +651,11 @@ void Player::GameplayOptionControl()
 		}
 		else
 		{
-			if (g_theInput->WasKeyJustPressed(KEYCODE_RIGHT_MOUSE) && m_currentBall)
+			if (g_theInput->WasKeyJustPressed(KEYCODE_RIGHT_MOUSE) && GetCurrentBall())
 			{
 				Dribble();
 			}
-			if (g_theInput->WasKeyJustReleased(KEYCODE_LEFT_MOUSE) && m_currentBall)
+			if (g_theInput->WasKeyJustReleased(KEYCODE_LEFT_MOUSE) && GetCurrentBall())
 			{
 				Shoot();
 			}
@@ -623,11 +671,11 @@ void Player::GameplayOptionControl()
 		}
 		else
 		{
-			if (g_theInput->WasKeyJustPressed(KEYCODE_RIGHT_MOUSE) && m_currentBall)
+			if (g_theInput->WasKeyJustPressed(KEYCODE_RIGHT_MOUSE) && GetCurrentBall())
 			{
 				Dribble();
 			}
-			if (g_theInput->WasKeyJustReleased(KEYCODE_LEFT_MOUSE) && m_currentBall)
+			if (g_theInput->WasKeyJustReleased(KEYCODE_LEFT_MOUSE) && GetCurrentBall())
 			{
 				Shoot();
 			}
@@ -695,4 +743,9 @@ Mat44 Player::GetModelMatrix() const
 	modelMat = m_orientationDegrees.GetAsMatrix_IFwd_JLeft_KUp();
 	modelMat.SetTranslation3D(m_position);
 	return modelMat;
+}
+
+Ball* Player::GetCurrentBall() const
+{
+	return m_map->m_balls.Get(m_currentBall);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "Game/GameCommon.hpp"
 #include "Game/Entity.hpp"
+#include "Game/BallSlotMap.hpp"
 
 class Prop;
 class Ball;
@@ -26,13 +27,15 @@ public:
 	virtual ~Player();
 
 	virtual void Update(float deltaSeconds) override;
-	virtual void Render() const override;
+	virtual void Render(RenderQueue& queue) const override;
 	void RenderUI() const;
 
 	Camera* GetCamera();
 	Mat44 GetModelMatrix() const;
+	// Null once the ball has been deleted, the handle never dangles
+	Ball* GetCurrentBall() const;
 public:
-	Ball* m_currentBall = nullptr;
+	BallHandle m_currentBall;
 	float m_throwForce = 500.f;
 	Vec3 m_throwDirection = Vec3(0, 0, 0.7f);
 	float m_eyeHeight = 5.f;
@@ -56,6 +59,8 @@ private:
 
 	void BallThrowingConstraint();
 	void Shoot();
+	// Shoots the held ball with the shot the solver finds most likely to score on the nearer hoop
+	void ShootWithAimAssist();
 	void Dribble();
 	void PickUpBallWithRaycast();
 	void AdjustForce();
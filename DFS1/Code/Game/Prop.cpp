@@ -15,11 +15,27 @@ void Prop::Update(float deltaSeconds)
 	UNUSED(deltaSeconds);
 }
 
-void Prop::Render() const
+void Prop::Render(RenderQueue& queue) const
 {
-	g_theRenderer->SetBlendMode(BlendMode::ALPHA);
-	g_theRenderer->SetDepthStencilMode(DepthMode::ENABLED);
-	g_theRenderer->BindTexture(m_texture);
-	g_theRenderer->SetModelConstants(GetModeMatrix(), m_color);
-	g_theRenderer->DrawVertexArray((int)m_vertexes.size(), m_vertexes.data());
+	RenderDrawState state;
+	state.m_texture = m_texture;
+	state.m_modelMatrix = GetModeMatrix();
+	state.m_modelColor = m_color;
+	queue.AddVertexArray(state, m_vertexes.size(), m_vertexes.data());
+}
+
+float Prop::GetBoundingRadius() const
+{
+	return m_boundingRadius;
+}
+
+void Prop::UpdateBoundingRadius()
+{
+	float maxLengthSquared = 0.f;
+	for (size_t i = 0; i < m_vertexes.size(); i++)
+	{
+		float lengthSquared = m_vertexes[i].m_position.GetLengthSquared();
+		maxLengthSquared = lengthSquared > maxLengthSquared ? lengthSquared : maxLengthSquared;
+	}
+	m_boundingRadius = sqrtf(maxLengthSquared);
 }
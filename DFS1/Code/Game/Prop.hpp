@@ -9,9 +9,13 @@ public:
 	virtual ~Prop();
 	
 	virtual void Update(float deltaSeconds) override;
-	virtual void Render() const override;
+	virtual void Render(RenderQueue& queue) const override;
+	// Cached by UpdateBoundingRadius, which has to be called again whenever m_vertexes changes
+	virtual float GetBoundingRadius() const override;
+	void UpdateBoundingRadius();
 public:
 	std::vector<Vertex_PCU>		m_vertexes;
+	float						m_boundingRadius = 0.f;
 	Rgba8						m_color = Rgba8::COLOR_WHITE;
 	Texture*					m_texture = nullptr;
 };
\ No newline at end of file
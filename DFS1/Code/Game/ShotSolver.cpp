@@ -0,0 +1,415 @@
+#include "Game/ShotSolver.hpp"
+#include "Game/BasketballCourt.hpp"
+#include "Game/Ball.hpp"
+#include "Game/Player.hpp"
+#include <cfloat>
+#include <climits>
+
+// Rolls reserved per candidate before its trials, so candidate i reads the same numbers in every run
+constexpr int SHOT_SOLVER_ROLLS_PER_CANDIDATE = 16;
+constexpr int SHOT_SOLVER_ROLLS_PER_TRIAL = 4;
+constexpr float SHOT_SOLVER_YAW_SPREAD_DEGREES = 4.f;
+
+struct ShotFlight
+{
+	bool m_didScore = false;
+	float m_closestDistance = 0.f;
+	int m_numSteps = 0;
+};
+
+struct ShotCandidate
+{
+	ShotParameters m_shot;
+	int m_numScores = 0;
+	float m_closestDistance = 0.f;
+	int m_numSteps = 0;
+	int m_numFlights = 0;
+};
+
+float ShotSolverResult::GetBestScoreChance(int numTrialsPerCandidate) const
+{
+	return numTrialsPerCandidate > 0 ? (float)m_bestNumScores / (float)numTrialsPerCandidate : 0.f;
+}
+
+double ShotSolverResult::GetSamplesPerSecond() const
+{
+	return m_seconds > 0.0 ? (double)m_numSamples / m_seconds : 0.0;
+}
+
+bool IsShotScoringPosition(Vec3 const& position, AABB3 const& hoop)
+{
+	return position.z > hoop.GetCenter().z + 0.9f
+		&& FloatRange(hoop.m_mins.x, hoop.m_maxs.x).IsOnRange(position.x)
+		&& FloatRange(hoop.m_mins.y, hoop.m_maxs.y).IsOnRange(position.y);
+}
+
+// Player::Shoot, then the court's integration step by step with the same operations in the same order as
+// IntegrateBallStatesScalar. Only the rotation is left out, nothing here depends on it. Flights end at the hoop,
+// a blocker or the floor, once the ball falls below the hoop, or at the time limit
+static ShotFlight FlyShot(ShotSolverBall const& ball, ShotSolverTarget const& target, ShotParameters const& shot, float fixedDeltaSeconds, int maxSteps)
+{
+	Vec3 startVelocity = ball.m_velocity + (shot.m_throwDirection * shot.m_throwForce) / ball.m_mass;
+	Vec3 toPos = (ball.m_position - ball.m_shooterForward) - ball.m_position;
+	Vec3 spinAcceleration = CrossProduct3D(toPos, Vec3(0.f, -shot.m_spinPosition.x, shot.m_spinPosition.y) * shot.m_spinForce);
+
+	float positionX = ball.m_position.x;
+	float positionY = ball.m_position.y;
+	float positionZ = ball.m_position.z;
+	float velocityX = startVelocity.x;
+	float velocityY = startVelocity.y;
+	float velocityZ = startVelocity.z;
+	float angularVelocityX = ball.m_angularVelocity.x;
+	float angularVelocityY = ball.m_angularVelocity.y;
+	float angularVelocityZ = ball.m_angularVelocity.z;
+	float mass = ball.m_mass;
+	float inverseMass = 1.f / mass;
+	float negativeDrag = -ball.m_drag;
+	float negativeInertia = -ball.m_inertia;
+	float gravityAcceleration = (ball.m_gravity * mass) * inverseMass;
+
+	// Scoring needs the ball just above the rim, so that is where misses are measured from
+	Vec3 hoopCenter = target.m_hoop.GetCenter();
+	float aimX = hoopCenter.x;
+	float aimY = hoopCenter.y;
+	float aimZ = hoopCenter.z + 0.95f;
+	float closestDistanceSquared = FLT_MAX;
+	float minZ = target.m_floorZ + ball.m_radius;
+	float belowHoopZ = target.m_hoop.m_mins.z - ball.m_radius;
+	// The hoop and its blockers are only tested once the ball gets near them
+	AABB3 nearHoopBounds = target.m_hoop;
+	for (int blockerIndex = 0; blockerIndex < target.m_numBlockers; blockerIndex++)
+	{
+		nearHoopBounds.StretchToIncludePoint(target.m_blockers[blockerIndex].m_mins);
+		nearHoopBounds.StretchToIncludePoint(target.m_blockers[blockerIndex].m_maxs);
+	}
+	Vec3 radiusExtents = Vec3(ball.m_radius, ball.m_radius, ball.m_radius);
+	nearHoopBounds = AABB3(nearHoopBounds.m_mins - radiusExtents, nearHoopBounds.m_maxs + radiusExtents);
+
+	ShotFlight flight;
+	for (int step = 1; step <= maxSteps; step++)
+	{
+		float accelerationX = (velocityX * negativeDrag) * inverseMass;
+		float accelerationY = (velocityY * negativeDrag) * inverseMass;
+		float accelerationZ = gravityAcceleration + (velocityZ * negativeDrag) * inverseMass;
+		float angularAccelerationX = angularVelocityX * negativeInertia;
+		float angularAccelerationY = angularVelocityY * negativeInertia;
+		float angularAccelerationZ = angularVelocityZ * negativeInertia;
+		if (step == 1)
+		{
+			angularAccelerationX = spinAcceleration.x + angularAccelerationX;
+			angularAccelerationY = spinAcceleration.y + angularAccelerationY;
+			angularAccelerationZ = spinAcceleration.z + angularAccelerationZ;
+		}
+		float crossX = angularVelocityY * velocityZ - angularVelocityZ * velocityY;
+		float crossY = -(angularVelocityX * velocityZ - angularVelocityZ * velocityX);
+		float crossZ = angularVelocityX * velocityY - angularVelocityY * velocityX;
+		accelerationX += (crossX * 0.47f) * inverseMass;
+		accelerationY += (crossY * 0.47f) * inverseMass;
+		accelerationZ += (crossZ * 0.47f) * inverseMass;
+
+		angularVelocityX += angularAccelerationX * fixedDeltaSeconds;
+		angularVelocityY += angularAccelerationY * fixedDeltaSeconds;
+		angularVelocityZ += angularAccelerationZ * fixedDeltaSeconds;
+		velocityX += accelerationX * fixedDeltaSeconds;
+		velocityY += accelerationY * fixedDeltaSeconds;
+		velocityZ += accelerationZ * fixedDeltaSeconds;
+		positionX += velocityX * fixedDeltaSeconds;
+		positionY += velocityY * fixedDeltaSeconds;
+		positionZ += velocityZ * fixedDeltaSeconds;
+
+		flight.m_numSteps = step;
+		float toAimX = aimX - positionX;
+		float toAimY = aimY - positionY;
+		float toAimZ = aimZ - positionZ;
+		float distanceSquared = (toAimX * toAimX) + (toAimY * toAimY) + (toAimZ * toAimZ);
+		closestDistanceSquared = distanceSquared < closestDistanceSquared ? distanceSquared : closestDistanceSquared;
+
+		if (positionZ < minZ || (velocityZ < 0.f && positionZ < belowHoopZ))
+		{
+			break;
+		}
+		if (positionX < nearHoopBounds.m_mins.x || positionX > nearHoopBounds.m_maxs.x
+			|| positionY < nearHoopBounds.m_mins.y || positionY > nearHoopBounds.m_maxs.y
+			|| positionZ < nearHoopBounds.m_mins.z || positionZ > nearHoopBounds.m_maxs.z)
+		{
+			continue;
+		}
+
+		Vec3 position = Vec3(positionX, positionY, positionZ);
+		if (DoSphereAndAABBOverlap3D(position, ball.m_radius, target.m_hoop))
+		{
+			flight.m_didScore = IsShotScoringPosition(position, target.m_hoop);
+			break;
+		}
+		bool isBlocked = false;
+		for (int blockerIndex = 0; blockerIndex < target.m_numBlockers && !isBlocked; blockerIndex++)
+		{
+			isBlocked = DoSphereAndAABBOverlap3D(position, ball.m_radius, target.m_blockers[blockerIndex]);
+		}
+		if (isBlocked)
+		{
+			break;
+		}
+	}
+	flight.m_closestDistance = flight.m_didScore ? 0.f : sqrtf(closestDistanceSquared);
+	return flight;
+}
+
+static void ClampShot(ShotParameters& shot)
+{
+	shot.m_throwDirection.z = Clamp(shot.m_throwDirection.z, 0.f, 1.f);
+	shot.m_throwForce = Clamp(shot.m_throwForce, 0.f, THROW_MAX_FORCE);
+	shot.m_spinPosition.x = Clamp(shot.m_spinPosition.x, -BALL_RADIUS, BALL_RADIUS);
+	shot.m_spinPosition.y = Clamp(shot.m_spinPosition.y, -BALL_RADIUS, BALL_RADIUS);
+	float spinForce = Clamp(shot.m_spinForce.x, 0.f, SPIN_MAX_FORCE);
+	shot.m_spinForce = Vec3(spinForce, spinForce, spinForce);
+}
+
+// Directions keep a unit XY part like a level player's forward, spin is set the way the CTRL drag sets it,
+// one force on all three axes. Near candidates stay within spread of the best shot so far
+static ShotParameters RollCandidate(RandomNumberGenerator& rng, ShotSolverBall const& ball, ShotSolverTarget const& target, ShotParameters const* bestShot, float spread)
+{
+	ShotParameters shot;
+	if (bestShot)
+	{
+		float yawDegrees = Atan2Degrees(bestShot->m_throwDirection.y, bestShot->m_throwDirection.x) + rng.RollRandomFloatMinusOneToOne() * spread;
+		shot.m_throwDirection = Vec3(CosDegrees(yawDegrees), SinDegrees(yawDegrees), bestShot->m_throwDirection.z + rng.RollRandomFloatMinusOneToOne() * 0.05f * spread);
+		shot.m_throwForce = bestShot->m_throwForce * (1.f + rng.RollRandomFloatMinusOneToOne() * 0.05f * spread);
+		shot.m_spinPosition = bestShot->m_spinPosition + Vec3(rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne(), 0.f) * 0.1f * spread;
+		shot.m_spinForce = bestShot->m_spinForce + Vec3(1.f, 1.f, 1.f) * rng.RollRandomFloatMinusOneToOne() * 2000.f * spread;
+	}
+	else
+	{
+		Vec3 toHoop = target.m_hoop.GetCenter() - ball.m_position;
+		float yawDegrees = Atan2Degrees(toHoop.y, toHoop.x) + rng.RollRandomFloatMinusOneToOne() * SHOT_SOLVER_YAW_SPREAD_DEGREES;
+		shot.m_throwDirection = Vec3(CosDegrees(yawDegrees), SinDegrees(yawDegrees), rng.RollRandomFloatZeroToOne());
+		shot.m_throwForce = rng.RollRandomFloatInRange(0.f, THROW_MAX_FORCE);
+		if (rng.RollRandomChance(0.5f))
+		{
+			shot.m_spinPosition = Vec3(rng.RollRandomFloatInRange(-BALL_RADIUS, BALL_RADIUS), rng.RollRandomFloatInRange(-BALL_RADIUS, BALL_RADIUS), 0.f);
+			float spinForce = rng.RollRandomFloatInRange(0.f, SPIN_MAX_FORCE);
+			shot.m_spinForce = Vec3(spinForce, spinForce, spinForce);
+		}
+	}
+	ClampShot(shot);
+	return shot;
+}
+
+static bool IsBetterCandidate(ShotCandidate const& candidate, ShotCandidate const& best)
+{
+	if (candidate.m_numScores != best.m_numScores)
+	{
+		return candidate.m_numScores > best.m_numScores;
+	}
+	return candidate.m_closestDistance < best.m_closestDistance;
+}
+
+ShotSolverResult SolveShot(ShotSolverBall const& ball, ShotSolverTarget const& target, ShotSolverConfig const& config)
+{
+	ShotSolverResult result;
+	double startTime = GetCurrentTimeSeconds();
+	int numTrials = config.m_numTrialsPerCandidate > 0 ? config.m_numTrialsPerCandidate : 1;
+	int rollsPerCandidate = SHOT_SOLVER_ROLLS_PER_CANDIDATE + numTrials * SHOT_SOLVER_ROLLS_PER_TRIAL;
+	int maxSteps = (int)ceilf(config.m_maxFlightSeconds / config.m_fixedDeltaSeconds);
+
+	std::vector<ShotCandidate> candidates(SHOT_SOLVER_BATCH_SIZE);
+	ShotCandidate best;
+	bool hasBest = false;
+	float spread = 1.f;
+	while (result.m_numCandidates < config.m_maxCandidates)
+	{
+		int batchBegin = result.m_numCandidates;
+		int batchSize = config.m_maxCandidates - batchBegin < SHOT_SOLVER_BATCH_SIZE ? config.m_maxCandidates - batchBegin : SHOT_SOLVER_BATCH_SIZE;
+		// After the first batch every other candidate searches near the best shot so far, the rest keep exploring
+		ShotParameters const* nearShot = hasBest ? &best.m_shot : nullptr;
+		auto evaluateCandidates = [&](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+				{
+					int candidateIndex = batchBegin + i;
+					RandomNumberGenerator rng(config.m_seed);
+					rng.m_position = candidateIndex * rollsPerCandidate;
+					ShotCandidate& candidate = candidates[i];
+					candidate = ShotCandidate();
+					candidate.m_shot = RollCandidate(rng, ball, target, (candidateIndex & 1) ? nearShot : nullptr, spread);
+
+					rng.m_position = candidateIndex * rollsPerCandidate + SHOT_SOLVER_ROLLS_PER_CANDIDATE;
+					float closestDistanceSum = 0.f;
+					for (int trial = 0; trial < numTrials; trial++)
+					{
+						// Trial 0 is the shot as rolled, the others miss the release a little like a player would
+						ShotParameters release = candidate.m_shot;
+						float forceJitter = rng.RollRandomFloatMinusOneToOne();
+						Vec3 directionJitter = Vec3(rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne(), rng.RollRandomFloatMinusOneToOne());
+						if (trial > 0)
+						{
+							release.m_throwForce *= 1.f + forceJitter * config.m_forceJitterFraction;
+							release.m_throwDirection += directionJitter * config.m_directionJitter;
+						}
+						ShotFlight flight = FlyShot(ball, target, release, config.m_fixedDeltaSeconds, maxSteps);
+						candidate.m_numScores += flight.m_didScore ? 1 : 0;
+						candidate.m_numSteps += flight.m_numSteps;
+						candidate.m_numFlights++;
+						closestDistanceSum += flight.m_closestDistance;
+						if (trial == 0 && flight.m_closestDistance > config.m_maxTrialMissDistance)
+						{
+							break;
+						}
+					}
+					candidate.m_closestDistance = closestDistanceSum / (float)candidate.m_numFlights;
+				}
+			};
+		if (config.m_isMultithreaded && g_theJobSystem)
+		{
+			g_theJobSystem->ParallelForRange(0, batchSize, SHOT_SOLVER_GRAIN, evaluateCandidates);
+		}
+		else
+		{
+			evaluateCandidates(0, batchSize);
+		}
+
+		// Ranked in candidate order, so ties go to the earliest candidate however the batch was split up
+		bool didImprove = false;
+		for (int i = 0; i < batchSize; i++)
+		{
+			result.m_numSteps += candidates[i].m_numSteps;
+			result.m_numSamples += candidates[i].m_numFlights;
+			if (!hasBest || IsBetterCandidate(candidates[i], best))
+			{
+				best = candidates[i];
+				hasBest = true;
+				didImprove = true;
+			}
+		}
+		spread = didImprove ? 1.f : (spread > 0.0625f ? spread * 0.5f : spread);
+		result.m_numCandidates += batchSize;
+
+		if (config.m_budgetSeconds > 0.0 && GetCurrentTimeSeconds() - startTime >= config.m_budgetSeconds)
+		{
+			break;
+		}
+	}
+
+	result.m_seconds = GetCurrentTimeSeconds() - startTime;
+	if (hasBest)
+	{
+		result.m_bestShot = best.m_shot;
+		result.m_didFindShot = best.m_numScores > 0;
+		result.m_bestNumScores = best.m_numScores;
+		result.m_bestClosestDistance = best.m_closestDistance;
+	}
+	return result;
+}
+
+ShotSolverBall MakeShotSolverBall(Ball const* ball, Player const* shooter)
+{
+	ShotSolverBall solverBall;
+	solverBall.m_position = ball->m_position;
+	solverBall.m_velocity = ball->m_velocity;
+	solverBall.m_angularVelocity = ball->m_angularVelocity;
+	solverBall.m_mass = ball->m_mass;
+	solverBall.m_drag = ball->m_drag;
+	solverBall.m_inertia = ball->m_inertia;
+	solverBall.m_radius = ball->m_radius;
+	solverBall.m_gravity = ball->m_isGravityEnabled ? MODIFIED_GRAVITY_RATE : 0.f;
+	solverBall.m_shooterForward = shooter->GetModelMatrix().GetIBasis3D();
+	return solverBall;
+}
+
+ShotSolverTarget MakeShotSolverTarget(BasketballCourt const* court, Hoop const* hoop)
+{
+	ShotSolverTarget target;
+	target.m_hoop = hoop->m_collider;
+	target.m_floorZ = court->m_gameFloor.m_distanceFromOrigin;
+
+	// The board and rims are the boxes near this hoop, the other hoop's are half a court away
+	Vec3 hoopCenter = hoop->m_collider.GetCenter();
+	CourtColliderBVH const& colliders = court->m_staticColliders;
+	for (int i = 0; i < colliders.GetNumColliders() && target.m_numBlockers < MAX_SHOT_SOLVER_BLOCKERS; i++)
+	{
+		CourtCollider const& collider = colliders.GetCollider(i);
+		if ((collider.m_tag == CourtColliderTag::BOARD || collider.m_tag == CourtColliderTag::RIM)
+			&& GetDistanceSquared3D(collider.m_box.GetCenter(), hoopCenter) < 25.f)
+		{
+			target.m_blockers[target.m_numBlockers++] = collider.m_box;
+		}
+	}
+	return target;
+}
+
+static bool IsSameShot(ShotSolverResult const& a, ShotSolverResult const& b)
+{
+	ShotParameters const& shotA = a.m_bestShot;
+	ShotParameters const& shotB = b.m_bestShot;
+	return a.m_numCandidates == b.m_numCandidates && a.m_bestNumScores == b.m_bestNumScores && a.m_bestClosestDistance == b.m_bestClosestDistance
+		&& shotA.m_throwForce == shotB.m_throwForce
+		&& shotA.m_throwDirection.x == shotB.m_throwDirection.x && shotA.m_throwDirection.y == shotB.m_throwDirection.y && shotA.m_throwDirection.z == shotB.m_throwDirection.z
+		&& shotA.m_spinPosition.x == shotB.m_spinPosition.x && shotA.m_spinPosition.y == shotB.m_spinPosition.y
+		&& shotA.m_spinForce.x == shotB.m_spinForce.x;
+}
+
+bool Command_ShotSolverBenchmark(EventArgs& args)
+{
+	ShotSolverConfig config;
+	config.m_seed = (unsigned int)args.GetValue("seed", (int)config.m_seed);
+	config.m_maxCandidates = args.GetValue("candidates", 4096);
+	config.m_numTrialsPerCandidate = args.GetValue("trials", config.m_numTrialsPerCandidate);
+	config.m_fixedDeltaSeconds = g_theGame->m_fixedTimeStep;
+	Vec3 shotPosition = Vec3(args.GetValue("x", 25.f), args.GetValue("y", 6.f), args.GetValue("z", 6.4f));
+	double budgetSeconds = (double)args.GetValue("budget", 2.f) / 1000.0;
+	bool isMultithreaded = args.GetValue("multithreaded", true);
+
+	// Scoring in TIMER and OBSTACLE mode moves the player and respawns blockers
+	GameMode previousGameMode = g_theGame->m_currentGameMode;
+	g_theGame->m_currentGameMode = CREATIVE;
+	BasketballCourt* court = new BasketballCourt();
+	court->InitializeCourt();
+	// Far enough behind the ball that the replay doesn't bounce it off the shooter
+	court->m_player = court->CreatePlayer(Vec3(shotPosition.x - 2.f, shotPosition.y, 0.f));
+	Ball* ball = court->CreateBall(shotPosition);
+	ShotSolverBall solverBall = MakeShotSolverBall(ball, court->m_player);
+	ShotSolverTarget target = MakeShotSolverTarget(court, court->m_hoopA);
+
+	// A fixed number of candidates, serially and on the JobSystem twice, has to pick the same shot every time
+	config.m_budgetSeconds = 0.0;
+	config.m_isMultithreaded = false;
+	ShotSolverResult serialResult = SolveShot(solverBall, target, config);
+	config.m_isMultithreaded = isMultithreaded;
+	ShotSolverResult parallelResult = SolveShot(solverBall, target, config);
+	ShotSolverResult repeatResult = SolveShot(solverBall, target, config);
+	bool isDeterministic = IsSameShot(serialResult, parallelResult) && IsSameShot(parallelResult, repeatResult);
+
+	config.m_budgetSeconds = budgetSeconds;
+	config.m_maxCandidates = INT_MAX;
+	ShotSolverResult budgetResult = SolveShot(solverBall, target, config);
+
+	// Replays the fixed-count shot through the court's real physics, rims and board included
+	ShotParameters const& shot = parallelResult.m_bestShot;
+	ball->m_isSimulatingPhysics = true;
+	ball->AddImpulse(shot.m_throwDirection * shot.m_throwForce);
+	ball->AddTorque(ball->m_position - solverBall.m_shooterForward, Vec3(0.f, -shot.m_spinPosition.x, shot.m_spinPosition.y) * shot.m_spinForce);
+	bool didReplayScore = false;
+	int maxSteps = (int)ceilf(config.m_maxFlightSeconds / config.m_fixedDeltaSeconds);
+	for (int step = 0; step < maxSteps && !didReplayScore; step++)
+	{
+		bool wasHoopColliding = court->m_hoopA->m_isColliding;
+		court->UpdatePhysics(config.m_fixedDeltaSeconds);
+		didReplayScore = !wasHoopColliding && court->m_hoopA->m_isColliding && IsShotScoringPosition(ball->m_position, court->m_hoopA->m_collider);
+	}
+	delete court;
+	g_theGame->m_currentGameMode = previousGameMode;
+
+	int numTrials = config.m_numTrialsPerCandidate;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Shot solver benchmark: from (%.1f, %.1f, %.1f), seed %u, %d trials per candidate, %d workers",
+		shotPosition.x, shotPosition.y, shotPosition.z, config.m_seed, numTrials, g_theJobSystem ? g_theJobSystem->GetNumWorkers() : 0));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  serial:   %d candidates in %7.2f ms, %10.0f samples/sec, %.0f ns per step",
+		serialResult.m_numCandidates, serialResult.m_seconds * 1000.0, serialResult.GetSamplesPerSecond(), serialResult.m_numSteps > 0 ? serialResult.m_seconds * 1000000000.0 / (double)serialResult.m_numSteps : 0.0));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  parallel: %d candidates in %7.2f ms, %10.0f samples/sec (%.1fx)",
+		parallelResult.m_numCandidates, parallelResult.m_seconds * 1000.0, parallelResult.GetSamplesPerSecond(), parallelResult.m_seconds > 0.0 ? serialResult.m_seconds / parallelResult.m_seconds : 0.0));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %.2f ms budget: %d candidates in %.2f ms, best scores %.0f%% of trials",
+		budgetSeconds * 1000.0, budgetResult.m_numCandidates, budgetResult.m_seconds * 1000.0, 100.f * budgetResult.GetBestScoreChance(numTrials)));
+	g_theDevConsole->AddLine(isDeterministic ? DevConsole::INFO_MINOR : DevConsole::ERROR, Stringf("  best: force %.0f, direction (%.3f, %.3f, %.3f), spin (%.2f, %.2f) x %.0f, scores %.0f%% of trials, %s, %s in the court",
+		shot.m_throwForce, shot.m_throwDirection.x, shot.m_throwDirection.y, shot.m_throwDirection.z, shot.m_spinPosition.x, shot.m_spinPosition.y, shot.m_spinForce.x,
+		100.f * parallelResult.GetBestScoreChance(numTrials), isDeterministic ? "same for every run" : "differs between runs", didReplayScore ? "scores" : "misses"));
+	return false;
+}
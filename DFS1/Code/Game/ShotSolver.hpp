@@ -0,0 +1,94 @@
+#pragma once
+#include "Game/GameCommon.hpp"
+#include "Engine/Math/AABB3.hpp"
+
+class BasketballCourt;
+class Ball;
+class Player;
+struct Hoop;
+
+constexpr int SHOT_SOLVER_BATCH_SIZE = 64;
+constexpr int SHOT_SOLVER_GRAIN = 4;
+constexpr int MAX_SHOT_SOLVER_BLOCKERS = 8;
+
+// What Player::Shoot applies to the held ball
+struct ShotParameters
+{
+	Vec3 m_throwDirection;
+	float m_throwForce = 0.f;
+	Vec3 m_spinPosition;
+	Vec3 m_spinForce;
+};
+
+// The held ball as Ball::UpdatePhysics sees it, plus the shooter's forward, which sets the spin axis
+struct ShotSolverBall
+{
+	Vec3 m_position;
+	Vec3 m_velocity;
+	Vec3 m_angularVelocity;
+	float m_mass = BALL_MASS;
+	float m_drag = 0.f;
+	float m_inertia = 0.f;
+	float m_radius = BALL_RADIUS;
+	float m_gravity = MODIFIED_GRAVITY_RATE;
+	Vec3 m_shooterForward = Vec3(1.f, 0.f, 0.f);
+};
+
+// One hoop reduced to what decides a shot: the score volume IsBallAScore checks, and the board and rim
+// boxes around it. Touching a blocker ends the flight as a miss, bank shots and rim rolls are not modeled
+struct ShotSolverTarget
+{
+	AABB3 m_hoop;
+	AABB3 m_blockers[MAX_SHOT_SOLVER_BLOCKERS];
+	int m_numBlockers = 0;
+	float m_floorZ = 0.f;
+};
+
+struct ShotSolverConfig
+{
+	unsigned int m_seed = 1234;
+	// Candidates come in batches of SHOT_SOLVER_BATCH_SIZE. The solver stops after the first batch that
+	// ends past the budget, 0 means no budget, or once it has tried m_maxCandidates
+	double m_budgetSeconds = 0.002;
+	int m_maxCandidates = 4096;
+	// Every candidate flies this many times with a jittered release, its score is the fraction that goes in.
+	// A candidate whose own shot misses the scoring point by more than m_maxTrialMissDistance skips the rest
+	int m_numTrialsPerCandidate = 8;
+	float m_maxTrialMissDistance = 1.5f;
+	float m_forceJitterFraction = 0.03f;
+	float m_directionJitter = 0.02f;
+	float m_maxFlightSeconds = 4.f;
+	float m_fixedDeltaSeconds = 0.005f;
+	bool m_isMultithreaded = true;
+};
+
+struct ShotSolverResult
+{
+	ShotParameters m_bestShot;
+	bool m_didFindShot = false;
+	int m_bestNumScores = 0;
+	float m_bestClosestDistance = 0.f;
+	int m_numCandidates = 0;
+	long long m_numSamples = 0; // flights simulated
+	long long m_numSteps = 0;
+	double m_seconds = 0.0;
+
+	float GetBestScoreChance(int numTrialsPerCandidate) const;
+	double GetSamplesPerSecond() const;
+};
+
+// Monte Carlo search over shot parameters from one position. Candidates aim toward the hoop with random
+// elevation, force and spin; after the first batch, half of every batch samples near the best so far.
+// Candidate i always rolls the same numbers for a seed, and a batch's candidates are ranked after the
+// whole batch is done, so a run is deterministic for a given number of batches on any number of workers.
+// With a time budget the number of batches depends on the machine; set m_budgetSeconds to 0 to pin it.
+ShotSolverResult SolveShot(ShotSolverBall const& ball, ShotSolverTarget const& target, ShotSolverConfig const& config);
+
+// The same test IsBallAScore makes on the step a ball first touches the hoop
+bool IsShotScoringPosition(Vec3 const& position, AABB3 const& hoop);
+
+ShotSolverBall MakeShotSolverBall(Ball const* ball, Player const* shooter);
+ShotSolverTarget MakeShotSolverTarget(BasketballCourt const* court, Hoop const* hoop);
+
+// Keys: seed, candidates, trials, x, y, z, budget (ms), multithreaded
+bool Command_ShotSolverBenchmark(EventArgs& args);
@@ -19,10 +19,14 @@ Clock::Clock(Clock& parent)
 
 Clock::~Clock()
 {
-	m_parent = nullptr;
-	m_parent->RemoveChild(this);
+	if (m_parent != nullptr)
+	{
+		m_parent->RemoveChild(this);
+		m_parent = nullptr;
+	}
 	for (size_t i = 0; i < m_children.size(); i++)
 	{
+		m_children[i]->m_parent = nullptr;
 		m_children[i] = nullptr;
 	}
 }
@@ -1,40 +1,433 @@
 #include "Engine/Core/JobSystem.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EventSystem.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include <typeinfo>
+
+static thread_local JobWorker* s_currentWorker = nullptr;
+static JobSystem* s_commandJobSystem = nullptr;
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// JOB DEQUE
+
+JobDeque::JobDeque(int capacity)
+{
+	long long roundedCapacity = 1;
+	while (roundedCapacity < capacity)
+	{
+		roundedCapacity <<= 1;
+	}
+	m_mask = roundedCapacity - 1;
+	m_buffer = new std::atomic<Job*>[roundedCapacity];
+	for (long long i = 0; i < roundedCapacity; i++)
+	{
+		m_buffer[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+JobDeque::~JobDeque()
+{
+	delete[] m_buffer;
+	m_buffer = nullptr;
+}
+
+bool JobDeque::Push(Job* job)
+{
+	long long bottom = m_bottom.load(std::memory_order_relaxed);
+	long long top = m_top.load(std::memory_order_acquire);
+	if (bottom - top > m_mask)
+	{
+		return false;
+	}
+
+	m_buffer[bottom & m_mask].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* JobDeque::Pop()
+{
+	long long bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job left, race the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobDeque::Steal()
+{
+	long long top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	Job* job = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return job;
+}
+
+bool JobDeque::IsEmpty() const
+{
+	long long top = m_top.load(std::memory_order_acquire);
+	long long bottom = m_bottom.load(std::memory_order_acquire);
+	return top >= bottom;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// JOB RING
+
+JobRing::JobRing(int capacity)
+{
+	size_t roundedCapacity = 2;
+	while (roundedCapacity < (size_t)capacity)
+	{
+		roundedCapacity <<= 1;
+	}
+	m_mask = roundedCapacity - 1;
+	m_cells = new Cell[roundedCapacity];
+	for (size_t i = 0; i < roundedCapacity; i++)
+	{
+		m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+JobRing::~JobRing()
+{
+	delete[] m_cells;
+	m_cells = nullptr;
+}
+
+bool JobRing::TryPush(Job* job)
+{
+	Cell* cell = nullptr;
+	size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &m_cells[position & m_mask];
+		size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+		long long difference = (long long)sequence - (long long)position;
+		if (difference == 0)
+		{
+			if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The consumer a lap behind has not freed this cell yet, the ring is full
+			return false;
+		}
+		else
+		{
+			position = m_enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->m_job = job;
+	cell->m_sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+Job* JobRing::TryPop()
+{
+	Cell* cell = nullptr;
+	size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &m_cells[position & m_mask];
+		size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+		long long difference = (long long)sequence - (long long)(position + 1);
+		if (difference == 0)
+		{
+			if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			return nullptr;
+		}
+		else
+		{
+			position = m_dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	Job* job = cell->m_job;
+	cell->m_sequence.store(position + m_mask + 1, std::memory_order_release);
+	return job;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// JOB ALLOCATOR
+//
+// Small jobs are carved out of 64KB slabs owned by the allocating thread, so a frame's worth of jobs
+// costs no heap traffic once the slabs are warm. A block freed on its owner thread goes straight back
+// to that thread's free list; a block freed anywhere else is pushed onto the owner's lock-free remote
+// list, which the owner takes over in one exchange the next time its local list runs dry.
+// Caches outlive their threads: an exiting thread hands its cache to the next thread that needs one.
+
+constexpr int NUM_JOB_SIZE_CLASSES = 4;
+constexpr size_t JOB_SIZE_CLASSES[NUM_JOB_SIZE_CLASSES] = { 64, 128, 256, 512 };
+constexpr size_t JOB_SLAB_SIZE = 64 * 1024;
+
+struct JobAllocatorCache;
+
+struct alignas(16) JobBlockHeader
+{
+	JobAllocatorCache* m_owner = nullptr;
+	JobBlockHeader* m_nextFree = nullptr;
+};
+
+struct JobAllocatorCache
+{
+	JobBlockHeader* m_freeBlocks[NUM_JOB_SIZE_CLASSES] = {};
+	std::atomic<JobBlockHeader*> m_remoteFreeBlocks[NUM_JOB_SIZE_CLASSES] = {};
+	unsigned char* m_slabCursor[NUM_JOB_SIZE_CLASSES] = {};
+	unsigned char* m_slabEnd[NUM_JOB_SIZE_CLASSES] = {};
+	JobAllocatorCache* m_nextOrphan = nullptr;
+};
+
+static std::mutex s_orphanedJobAllocatorCachesMutex;
+static JobAllocatorCache* s_orphanedJobAllocatorCaches = nullptr;
+
+struct JobAllocatorCacheOwner
+{
+	~JobAllocatorCacheOwner()
+	{
+		if (m_cache)
+		{
+			s_orphanedJobAllocatorCachesMutex.lock();
+			m_cache->m_nextOrphan = s_orphanedJobAllocatorCaches;
+			s_orphanedJobAllocatorCaches = m_cache;
+			s_orphanedJobAllocatorCachesMutex.unlock();
+			m_cache = nullptr;
+		}
+	}
+
+	JobAllocatorCache* m_cache = nullptr;
+};
+
+static thread_local JobAllocatorCacheOwner s_jobAllocatorCache;
+
+static int GetJobSizeClass(size_t size)
+{
+	for (int sizeClass = 0; sizeClass < NUM_JOB_SIZE_CLASSES; sizeClass++)
+	{
+		if (size <= JOB_SIZE_CLASSES[sizeClass])
+		{
+			return sizeClass;
+		}
+	}
+	return -1;
+}
+
+static JobAllocatorCache* GetThreadJobAllocatorCache()
+{
+	if (!s_jobAllocatorCache.m_cache)
+	{
+		s_orphanedJobAllocatorCachesMutex.lock();
+		JobAllocatorCache* cache = s_orphanedJobAllocatorCaches;
+		if (cache)
+		{
+			s_orphanedJobAllocatorCaches = cache->m_nextOrphan;
+			cache->m_nextOrphan = nullptr;
+		}
+		s_orphanedJobAllocatorCachesMutex.unlock();
+
+		s_jobAllocatorCache.m_cache = cache ? cache : new JobAllocatorCache();
+	}
+	return s_jobAllocatorCache.m_cache;
+}
+
+void* Job::operator new(size_t size)
+{
+	int sizeClass = GetJobSizeClass(size);
+	if (sizeClass < 0)
+	{
+		return ::operator new(size);
+	}
+
+	JobAllocatorCache* cache = GetThreadJobAllocatorCache();
+	JobBlockHeader* block = cache->m_freeBlocks[sizeClass];
+	if (!block)
+	{
+		block = cache->m_remoteFreeBlocks[sizeClass].exchange(nullptr, std::memory_order_acquire);
+	}
+	if (block)
+	{
+		cache->m_freeBlocks[sizeClass] = block->m_nextFree;
+		block->m_nextFree = nullptr;
+		return block + 1;
+	}
+
+	// Slabs are never returned; the pool only grows to the peak number of live jobs
+	size_t blockSize = sizeof(JobBlockHeader) + JOB_SIZE_CLASSES[sizeClass];
+	if (cache->m_slabCursor[sizeClass] + blockSize > cache->m_slabEnd[sizeClass] || !cache->m_slabCursor[sizeClass])
+	{
+		cache->m_slabCursor[sizeClass] = new unsigned char[JOB_SLAB_SIZE];
+		cache->m_slabEnd[sizeClass] = cache->m_slabCursor[sizeClass] + JOB_SLAB_SIZE;
+	}
+	block = new (cache->m_slabCursor[sizeClass]) JobBlockHeader();
+	block->m_owner = cache;
+	cache->m_slabCursor[sizeClass] += blockSize;
+	return block + 1;
+}
+
+void Job::operator delete(void* pointer, size_t size)
+{
+	if (!pointer)
+	{
+		return;
+	}
+
+	int sizeClass = GetJobSizeClass(size);
+	if (sizeClass < 0)
+	{
+		::operator delete(pointer);
+		return;
+	}
+
+	JobBlockHeader* block = (JobBlockHeader*)pointer - 1;
+	JobAllocatorCache* owner = block->m_owner;
+	if (owner == s_jobAllocatorCache.m_cache)
+	{
+		block->m_nextFree = owner->m_freeBlocks[sizeClass];
+		owner->m_freeBlocks[sizeClass] = block;
+		return;
+	}
+
+	std::atomic<JobBlockHeader*>& remoteFreeBlocks = owner->m_remoteFreeBlocks[sizeClass];
+	JobBlockHeader* remoteHead = remoteFreeBlocks.load(std::memory_order_relaxed);
+	do
+	{
+		block->m_nextFree = remoteHead;
+	} while (!remoteFreeBlocks.compare_exchange_weak(remoteHead, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// JOB WORKER
 
 JobWorker::JobWorker(int id, JobSystem* system)
 {
 	m_id = id;
 	m_system = system;
-	m_thread = new std::thread(&JobWorker::ThreadMain, this);
+	m_localJobs = new JobDeque(system->m_config.m_localQueueCapacity);
+	m_stealSeed = 0x9E3779B9u * (unsigned int)(id + 1);
 }
 
 JobWorker::~JobWorker()
 {
-	m_thread->join();
+	if (m_thread->joinable())
+	{
+		m_thread->join();
+	}
+	delete m_thread;
+	m_thread = nullptr;
+	delete m_localJobs;
+	m_localJobs = nullptr;
 }
 
 void JobWorker::ThreadMain()
 {
+	s_currentWorker = this;
+
+	int numFailedClaims = 0;
 	while (!m_system->m_isShuttingDown)
 	{
+		unsigned int observedWakeCount = m_system->m_wakeCount.load();
 		Job* jobToExecute = m_system->ClaimJob(this);
 		if (jobToExecute)
 		{
-			jobToExecute->Execute();
+			numFailedClaims = 0;
+			if (m_system->m_isProfiling.load(std::memory_order_relaxed))
+			{
+				// Recorded before CompleteJob, the job may be deleted the moment it completes
+				JobProfileEvent profileEvent;
+				profileEvent.m_name = typeid(*jobToExecute).name();
+				profileEvent.m_bitflags = jobToExecute->m_Bitflags;
+				profileEvent.m_workerId = m_id;
+				profileEvent.m_queuedTime = jobToExecute->m_queuedTime;
+				profileEvent.m_startTime = GetCurrentTimeSeconds();
+				jobToExecute->Execute();
+				profileEvent.m_endTime = GetCurrentTimeSeconds();
+
+				m_profileEventsMutex.lock();
+				m_profileEvents.push_back(profileEvent);
+				m_profileEventsMutex.unlock();
+			}
+			else
+			{
+				jobToExecute->Execute();
+			}
 			m_system->CompleteJob(jobToExecute);
 		}
+		else if (numFailedClaims < m_system->m_config.m_numSpinsBeforeSleep)
+		{
+			numFailedClaims++;
+			std::this_thread::yield();
+		}
 		else
 		{
-			std::this_thread::sleep_for(std::chrono::microseconds(1));
+			m_system->WaitForWork(observedWakeCount);
+			numFailedClaims = 0;
 		}
 	}
+
+	s_currentWorker = nullptr;
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------------
+// JOB SYSTEM
+
 JobSystem::JobSystem(JobSystemConfig config)
 	:m_config(config)
 {
 
 }
 
+JobSystem::~JobSystem()
+{
+	int numTypeQueues = m_numJobTypeQueues.load();
+	for (int i = 0; i < numTypeQueues; i++)
+	{
+		delete m_queuedJobsByType[i]->m_ring;
+		delete m_queuedJobsByType[i];
+		m_queuedJobsByType[i] = nullptr;
+	}
+	m_numJobTypeQueues = 0;
+}
+
 void JobSystem::Startup()
 {
 	if (m_config.m_numWorkers < 0)
@@ -42,35 +435,120 @@ void JobSystem::Startup()
 		m_config.m_numWorkers = std::thread::hardware_concurrency() - 1;
 	}
 	CreateWorkers(m_config.m_numWorkers);
+	SetProfilingEnabled(m_config.m_isProfilingEnabled);
+
+	if (g_theEventSystem)
+	{
+		s_commandJobSystem = this;
+		g_theEventSystem->SubscribeEventCallbackFunction("jobprofile", JobSystem::Command_JobProfile);
+		g_theEventSystem->SubscribeEventCallbackFunction("jobbenchmark", JobSystem::Command_JobBenchmark);
+		g_theEventSystem->SubscribeEventCallbackFunction("jobframebenchmark", JobSystem::Command_JobFrameBenchmark);
+		g_theEventSystem->SubscribeEventCallbackFunction("parallelforbenchmark", JobSystem::Command_ParallelForBenchmark);
+		g_theEventSystem->SubscribeEventCallbackFunction("jobqueuebenchmark", JobSystem::Command_JobQueueBenchmark);
+	}
 }
 
 void JobSystem::BeginFrame()
 {
+	if (!m_isProfiling)
+	{
+		return;
+	}
 
+	m_frameStartTime = GetCurrentTimeSeconds();
+	m_queuedJobsHighWaterMark = m_numQueuedJobs.load();
 }
 
 void JobSystem::EndFrame()
 {
+	if (!m_isProfiling)
+	{
+		return;
+	}
+
+	JobFrameProfile frame;
+	frame.m_frameIndex = m_frameIndex++;
+	frame.m_endTime = GetCurrentTimeSeconds();
+	frame.m_startTime = m_frameStartTime > 0.0 ? m_frameStartTime : frame.m_endTime;
+	frame.m_queuedJobsHighWaterMark = m_queuedJobsHighWaterMark.load();
+	frame.m_workerBusySeconds.resize(m_workers.size(), 0.0);
+
+	for (size_t workerIndex = 0; workerIndex < m_workers.size(); workerIndex++)
+	{
+		JobWorker* worker = m_workers[workerIndex];
+		worker->m_profileEventsMutex.lock();
+		frame.m_events.insert(frame.m_events.end(), worker->m_profileEvents.begin(), worker->m_profileEvents.end());
+		worker->m_profileEvents.clear();
+		worker->m_profileEventsMutex.unlock();
+	}
+
+	for (size_t i = 0; i < frame.m_events.size(); i++)
+	{
+		JobProfileEvent const& profileEvent = frame.m_events[i];
 
+		// Only the part of a job that overlaps this frame counts towards its busy time
+		double clippedStart = profileEvent.m_startTime > frame.m_startTime ? profileEvent.m_startTime : frame.m_startTime;
+		double clippedEnd = profileEvent.m_endTime < frame.m_endTime ? profileEvent.m_endTime : frame.m_endTime;
+		if (clippedEnd > clippedStart && profileEvent.m_workerId >= 0 && profileEvent.m_workerId < (int)frame.m_workerBusySeconds.size())
+		{
+			frame.m_workerBusySeconds[profileEvent.m_workerId] += clippedEnd - clippedStart;
+		}
+
+		if (profileEvent.m_queuedTime > 0.0)
+		{
+			double waitSeconds = profileEvent.m_startTime - profileEvent.m_queuedTime;
+			frame.m_totalWaitSeconds += waitSeconds;
+			if (waitSeconds > frame.m_maxWaitSeconds)
+			{
+				frame.m_maxWaitSeconds = waitSeconds;
+			}
+		}
+	}
+
+	m_profiledFrames.push_back(frame);
+	while ((int)m_profiledFrames.size() > m_config.m_maxProfiledFrames)
+	{
+		m_profiledFrames.pop_front();
+	}
+	m_frameStartTime = frame.m_endTime;
 }
 
 void JobSystem::Shutdown()
 {
+	if (s_commandJobSystem == this)
+	{
+		s_commandJobSystem = nullptr;
+	}
+
 	m_isShuttingDown = true;
+	m_sleepMutex.lock();
+	m_wakeCount++;
+	m_sleepMutex.unlock();
+	m_sleepCondition.notify_all();
 	DestroyWorkers();
 }
 
 void JobSystem::CreateWorkers(int num)
 {
+	// Every worker has to exist before any thread starts, since they steal from each other
+	size_t firstNewWorker = m_workers.size();
 	for (int i = 0; i < num; i++)
 	{
-		JobWorker* newWorker = new JobWorker(i, this);
+		JobWorker* newWorker = new JobWorker((int)firstNewWorker + i, this);
 		m_workers.push_back(newWorker);
 	}
+	for (size_t i = firstNewWorker; i < m_workers.size(); i++)
+	{
+		m_workers[i]->m_thread = new std::thread(&JobWorker::ThreadMain, m_workers[i]);
+	}
 }
 
 void JobSystem::DestroyWorkers()
 {
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i]->m_thread->join();
+	}
 	for (size_t i = 0; i < m_workers.size(); i++)
 	{
 		delete m_workers[i];
@@ -82,139 +560,620 @@ void JobSystem::DestroyWorkers()
 
 void JobSystem::QueueJob(Job* jobToQueue)
 {
-	m_queuedJobsMutex.lock();
-	jobToQueue->m_state = JobState::QUEUED;
-	m_queuedJobs.push_back(jobToQueue);
-	m_queuedJobsMutex.unlock();
+	jobToQueue->m_hasFinishedExecuting = false;
+	jobToQueue->m_state = JobState::WAITING;
+
+	// Drop the submit reference, the last prerequisite to finish releases the job otherwise
+	if (jobToQueue->m_numPendingDependencies.fetch_sub(1) == 1)
+	{
+		EnqueueReadyJob(jobToQueue);
+	}
 }
 
-Job* JobSystem::ClaimJob(JobWorker* worker)
+void JobSystem::QueueJob(Job* jobToQueue, std::vector<Job*> const& prerequisites)
 {
-	m_queuedJobsMutex.lock();
-
-	if (m_queuedJobs.empty())
+	for (size_t i = 0; i < prerequisites.size(); i++)
 	{
-		m_queuedJobsMutex.unlock();
-		return nullptr;
+		AddDependency(jobToQueue, prerequisites[i]);
 	}
+	QueueJob(jobToQueue);
+}
 
-	Job* job = m_queuedJobs.front();
-
-	if ((job->m_Bitflags & worker->m_jobTypeBitflags) == 0)
+void JobSystem::AddDependency(Job* job, Job* prerequisite)
+{
+	// Must be called before the dependent job is queued. The prerequisite must still be alive: a job the
+	// caller owns must not have been retrieved and deleted yet, and a fire-and-forget job must either not
+	// be queued yet or be retained, otherwise it may already have completed and deleted itself
+	ASSERT_OR_DIE(!prerequisite->m_deleteOnComplete || prerequisite->m_state == JobState::NEW || prerequisite->m_numReferences.load() > 1,
+		"AddDependency on a queued fire-and-forget job that is not retained");
+	prerequisite->m_dependentsMutex.lock();
+	if (!prerequisite->m_hasFinishedExecuting)
 	{
-		m_queuedJobsMutex.unlock();
-		return nullptr;
+		job->m_numPendingDependencies++;
+		prerequisite->m_dependents.push_back(job);
 	}
+	prerequisite->m_dependentsMutex.unlock();
+}
 
-	m_queuedJobs.pop_front();
-	m_queuedJobsMutex.unlock();
-
-	job->m_state = JobState::EXECUTING;
-
-	m_executingJobsMutex.lock();
-	m_executingJobs.push_back(job);
-	m_executingJobsMutex.unlock();
+void JobSystem::RetainJob(Job* job)
+{
+	job->m_numReferences++;
+}
 
-	return job;
+void JobSystem::ReleaseJob(Job* job)
+{
+	// Only fire-and-forget jobs are ever released to zero, the JobSystem drops its reference in CompleteJob
+	if (job->m_numReferences.fetch_sub(1) == 1)
+	{
+		delete job;
+	}
 }
 
-void JobSystem::CompleteJob(Job* jobToComplete)
+void JobSystem::ReleaseDependents(Job* job)
 {
-	m_executingJobsMutex.lock();
+	std::vector<Job*> dependents;
+	job->m_dependentsMutex.lock();
+	job->m_hasFinishedExecuting = true;
+	dependents.swap(job->m_dependents);
+	job->m_dependentsMutex.unlock();
 
-	for (size_t i = 0; i < m_executingJobs.size(); i++)
+	for (size_t i = 0; i < dependents.size(); i++)
 	{
-		if (m_executingJobs[i] == jobToComplete)
+		if (dependents[i]->m_numPendingDependencies.fetch_sub(1) == 1)
 		{
-			m_executingJobs.erase(m_executingJobs.begin() + i);
-			m_executingJobsMutex.unlock();
-			m_completedJobsMutex.lock();
-			jobToComplete->m_state = JobState::COMPLETED;
-			m_completedJobs.push_back(jobToComplete);
-			m_completedJobsMutex.unlock();
-			return;
+			EnqueueReadyJob(dependents[i]);
 		}
 	}
+}
+
+void JobSystem::EnqueueReadyJob(Job* jobToQueue)
+{
+	// Restore the submit reference so the job can be queued again after it is retrieved
+	jobToQueue->m_numPendingDependencies = 1;
+	jobToQueue->m_state = JobState::QUEUED;
+	int numQueuedJobs = ++m_numQueuedJobs;
+	if (m_isProfiling.load(std::memory_order_relaxed))
+	{
+		jobToQueue->m_queuedTime = GetCurrentTimeSeconds();
+		RecordQueuedJobsHighWaterMark(numQueuedJobs);
+	}
+
+	// Jobs queued or released from inside a job stay on that worker's deque so they are hot in its cache;
+	// idle workers will steal them if it falls behind
+	JobWorker* worker = s_currentWorker;
+	bool isPushedLocally = false;
+	if (worker && worker->m_system == this && (jobToQueue->m_Bitflags & worker->m_jobTypeBitflags) != 0)
+	{
+		isPushedLocally = worker->m_localJobs->Push(jobToQueue);
+	}
+
+	if (!isPushedLocally)
+	{
+		PushToTypeQueue(GetOrCreateTypeQueue(jobToQueue->m_Bitflags), jobToQueue);
+	}
 
-	m_executingJobsMutex.unlock();
-	return;
+	WakeWorkers();
 }
 
-Job* JobSystem::RetrieveJob(Job* jobToRetrived)
+JobTypeQueue* JobSystem::GetOrCreateTypeQueue(unsigned int jobFlags)
 {
-	m_completedJobsMutex.lock();
-	if (!m_completedJobs.empty())
+	int numTypeQueues = m_numJobTypeQueues.load(std::memory_order_acquire);
+	for (int i = 0; i < numTypeQueues; i++)
 	{
-		if (jobToRetrived)
+		if (m_queuedJobsByType[i]->m_bitflags == jobFlags)
 		{
-			for (size_t i = 0; i < m_completedJobs.size(); i++)
-			{
-				if (m_completedJobs[i] == jobToRetrived)
-				{
-					m_completedJobs.erase(m_completedJobs.begin() + i);
-					jobToRetrived->m_state = JobState::RETRIEVED;
-					m_completedJobsMutex.unlock();
-					return jobToRetrived;
-				}
-			}
+			return m_queuedJobsByType[i];
 		}
-		else
+	}
+
+	m_queuedJobsMutex.lock();
+	numTypeQueues = m_numJobTypeQueues.load(std::memory_order_relaxed);
+	for (int i = 0; i < numTypeQueues; i++)
+	{
+		if (m_queuedJobsByType[i]->m_bitflags == jobFlags)
 		{
-			Job* firstFinishedJob = m_completedJobs.front();
-			m_completedJobs.pop_front();
-			m_completedJobsMutex.unlock();
-			return firstFinishedJob;
+			m_queuedJobsMutex.unlock();
+			return m_queuedJobsByType[i];
 		}
 	}
 
-	m_completedJobsMutex.unlock();
-	return nullptr;
+	GUARANTEE_OR_DIE(numTypeQueues < MAX_JOB_TYPE_QUEUES, "Too many distinct job type bitflag combinations");
+	JobTypeQueue* typeQueue = new JobTypeQueue();
+	typeQueue->m_bitflags = jobFlags;
+	if (m_config.m_useLockFreeQueue)
+	{
+		typeQueue->m_ring = new JobRing(m_config.m_globalQueueCapacity);
+	}
+	m_queuedJobsByType[numTypeQueues] = typeQueue;
+	m_numJobTypeQueues.store(numTypeQueues + 1, std::memory_order_release);
+	m_queuedJobsMutex.unlock();
+	return typeQueue;
 }
 
-size_t JobSystem::GetNumQueuedJobs() const
+void JobSystem::PushToTypeQueue(JobTypeQueue* typeQueue, Job* job)
 {
-	m_queuedJobsMutex.lock();
-	size_t numQueuedJob = m_queuedJobs.size();
-	m_queuedJobsMutex.unlock();
-	return numQueuedJob;
-}
+	// Count first so the counter never dips below zero when a worker pops the job straight away
+	m_numGlobalQueuedJobs++;
 
-size_t JobSystem::GetNumCompletedJobs() const
+	// Once the ring has spilled, keep spilling until the overflow drains so jobs stay roughly in order
+	if (typeQueue->m_ring && typeQueue->m_numOverflowJobs.load(std::memory_order_relaxed) <= 0 && typeQueue->m_ring->TryPush(job))
+	{
+		return;
+	}
+
+	m_queuedJobsMutex.lock();
+	typeQueue->m_jobs.push_back(job);
+	typeQueue->m_numOverflowJobs++;
+	m_queuedJobsMutex.unlock();
+}
+
+Job* JobSystem::PopFromTypeQueue(JobTypeQueue* typeQueue)
 {
+	Job* job = typeQueue->m_ring->TryPop();
+	if (job)
+	{
+		m_numGlobalQueuedJobs--;
+		return job;
+	}
+
+	if (typeQueue->m_numOverflowJobs.load(std::memory_order_relaxed) <= 0)
+	{
+		return nullptr;
+	}
+
+	m_queuedJobsMutex.lock();
+	if (!typeQueue->m_jobs.empty())
+	{
+		job = typeQueue->m_jobs.front();
+		typeQueue->m_jobs.pop_front();
+		typeQueue->m_numOverflowJobs--;
+		m_numGlobalQueuedJobs--;
+	}
+	m_queuedJobsMutex.unlock();
+	return job;
+}
+
+Job* JobSystem::ClaimJob(JobWorker* worker)
+{
+	Job* job = worker->m_localJobs->Pop();
+
+	if (!job)
+	{
+		job = ClaimFromGlobalQueue(worker);
+	}
+	if (!job)
+	{
+		job = StealJob(worker);
+	}
+	if (!job)
+	{
+		return nullptr;
+	}
+
+	MarkJobClaimed(job);
+	return job;
+}
+
+Job* JobSystem::ClaimFromGlobalQueue(JobWorker* worker)
+{
+	if (m_numGlobalQueuedJobs.load(std::memory_order_acquire) <= 0)
+	{
+		return nullptr;
+	}
+	if (m_config.m_useLockFreeQueue)
+	{
+		return ClaimFromGlobalRing(worker);
+	}
+
+	unsigned int workerFlags = worker->m_jobTypeBitflags;
+
+	m_queuedJobsMutex.lock();
+
+	// Rotate the starting queue so one busy job type cannot starve the others
+	JobTypeQueue* typeQueue = nullptr;
+	size_t numTypeQueues = (size_t)m_numJobTypeQueues.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < numTypeQueues; i++)
+	{
+		size_t queueIndex = (worker->m_nextTypeQueueIndex + i) % numTypeQueues;
+		JobTypeQueue* candidate = m_queuedJobsByType[queueIndex];
+		if ((candidate->m_bitflags & workerFlags) != 0 && !candidate->m_jobs.empty())
+		{
+			typeQueue = candidate;
+			worker->m_nextTypeQueueIndex = queueIndex + 1;
+			break;
+		}
+	}
+
+	if (!typeQueue)
+	{
+		m_queuedJobsMutex.unlock();
+		return nullptr;
+	}
+
+	Job* job = typeQueue->m_jobs.front();
+	typeQueue->m_jobs.pop_front();
+	typeQueue->m_numOverflowJobs--;
+	m_numGlobalQueuedJobs--;
+
+	// Take a fair share of the following jobs in the same lock so the other workers steal from us
+	// instead of all hammering this mutex
+	int numWorkers = (int)m_workers.size() > 0 ? (int)m_workers.size() : 1;
+	int batchSize = (int)typeQueue->m_jobs.size() / numWorkers;
+	if (batchSize > m_config.m_globalClaimBatchSize)
+	{
+		batchSize = m_config.m_globalClaimBatchSize;
+	}
+	for (int i = 0; i < batchSize; i++)
+	{
+		if (!worker->m_localJobs->Push(typeQueue->m_jobs.front()))
+		{
+			break;
+		}
+		typeQueue->m_jobs.pop_front();
+		typeQueue->m_numOverflowJobs--;
+		m_numGlobalQueuedJobs--;
+	}
+
+	m_queuedJobsMutex.unlock();
+	return job;
+}
+
+Job* JobSystem::ClaimFromGlobalRing(JobWorker* worker)
+{
+	unsigned int workerFlags = worker->m_jobTypeBitflags;
+	size_t numTypeQueues = (size_t)m_numJobTypeQueues.load(std::memory_order_acquire);
+	for (size_t i = 0; i < numTypeQueues; i++)
+	{
+		size_t queueIndex = (worker->m_nextTypeQueueIndex + i) % numTypeQueues;
+		JobTypeQueue* typeQueue = m_queuedJobsByType[queueIndex];
+		if ((typeQueue->m_bitflags & workerFlags) == 0)
+		{
+			continue;
+		}
+
+		Job* job = PopFromTypeQueue(typeQueue);
+		if (!job)
+		{
+			continue;
+		}
+		worker->m_nextTypeQueueIndex = queueIndex + 1;
+
+		// Same fair share batching as the mutex path, sized from the approximate global count
+		int numWorkers = (int)m_workers.size() > 0 ? (int)m_workers.size() : 1;
+		int batchSize = m_numGlobalQueuedJobs.load(std::memory_order_relaxed) / numWorkers;
+		if (batchSize > m_config.m_globalClaimBatchSize)
+		{
+			batchSize = m_config.m_globalClaimBatchSize;
+		}
+		for (int batchIndex = 0; batchIndex < batchSize; batchIndex++)
+		{
+			Job* batchJob = PopFromTypeQueue(typeQueue);
+			if (!batchJob)
+			{
+				break;
+			}
+			if (!worker->m_localJobs->Push(batchJob))
+			{
+				PushToTypeQueue(typeQueue, batchJob);
+				break;
+			}
+		}
+		return job;
+	}
+
+	return nullptr;
+}
+
+Job* JobSystem::StealJob(JobWorker* thief)
+{
+	int numWorkers = (int)m_workers.size();
+	if (numWorkers <= 1)
+	{
+		return nullptr;
+	}
+
+	unsigned int thiefFlags = thief->m_jobTypeBitflags;
+
+	// xorshift, good enough to spread victims
+	thief->m_stealSeed ^= thief->m_stealSeed << 13;
+	thief->m_stealSeed ^= thief->m_stealSeed >> 17;
+	thief->m_stealSeed ^= thief->m_stealSeed << 5;
+	int startIndex = (int)(thief->m_stealSeed % (unsigned int)numWorkers);
+
+	for (int i = 0; i < numWorkers; i++)
+	{
+		JobWorker* victim = m_workers[(startIndex + i) % numWorkers];
+		if (victim == thief)
+		{
+			continue;
+		}
+
+		// Every job on a victim's deque matches the victim's flags, so it is only safe to take
+		// when all of those flags are also ours
+		if ((victim->m_jobTypeBitflags & ~thiefFlags) != 0)
+		{
+			continue;
+		}
+
+		Job* job = victim->m_localJobs->Steal();
+		if (job)
+		{
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::MarkJobClaimed(Job* job)
+{
+	m_numQueuedJobs--;
+	m_numExecutingJobs++;
+	job->m_state = JobState::EXECUTING;
+}
+
+void JobSystem::WaitForWork(unsigned int observedWakeCount)
+{
+	std::unique_lock<std::mutex> lock(m_sleepMutex);
+	m_numSleepingWorkers++;
+	m_sleepCondition.wait(lock, [this, observedWakeCount]() { return m_isShuttingDown || m_wakeCount.load() != observedWakeCount; });
+	m_numSleepingWorkers--;
+}
+
+void JobSystem::WakeWorkers()
+{
+	m_wakeCount++;
+	if (m_numSleepingWorkers.load() <= 0)
+	{
+		return;
+	}
+
+	// Lock so a worker cannot miss the count change between checking it and going to sleep
+	m_sleepMutex.lock();
+	m_sleepMutex.unlock();
+
+	// With mixed job types the first worker woken might not be allowed to run the job
+	if (m_hasMixedWorkerFlags)
+	{
+		m_sleepCondition.notify_all();
+	}
+	else
+	{
+		m_sleepCondition.notify_one();
+	}
+}
+
+void JobSystem::CompleteJob(Job* jobToComplete)
+{
+	ReleaseDependents(jobToComplete);
+	m_numExecutingJobs--;
+
+	if (jobToComplete->m_deleteOnComplete)
+	{
+		ReleaseJob(jobToComplete);
+		return;
+	}
+
+	jobToComplete->m_state = JobState::COMPLETED;
+	m_numCompletedJobs++;
+
+	// The job may be retrieved and deleted as soon as it is published, do not touch it afterwards
+	Job* inboxHead = m_completedJobInbox.load(std::memory_order_relaxed);
+	do
+	{
+		jobToComplete->m_nextCompletedJob = inboxHead;
+	} while (!m_completedJobInbox.compare_exchange_weak(inboxHead, jobToComplete, std::memory_order_release, std::memory_order_relaxed));
+}
+
+Job* JobSystem::RetrieveJob(Job* jobToRetrived)
+{
+	if (jobToRetrived && jobToRetrived->m_state != JobState::COMPLETED)
+	{
+		return nullptr;
+	}
+	if (!jobToRetrived && m_numCompletedJobs.load() <= 0)
+	{
+		return nullptr;
+	}
+
 	m_completedJobsMutex.lock();
-	size_t numCompletedJob = m_completedJobs.size();
+
+	if (!m_completedJobsHead || (jobToRetrived && !jobToRetrived->m_isInCompletedList))
+	{
+		DrainCompletedJobInbox();
+	}
+
+	Job* retrievedJob = jobToRetrived ? jobToRetrived : m_completedJobsHead;
+
+	// A job can be marked completed a moment before its worker publishes it, the caller will get it next poll
+	if (!retrievedJob || !retrievedJob->m_isInCompletedList)
+	{
+		m_completedJobsMutex.unlock();
+		return nullptr;
+	}
+
+	UnlinkCompletedJob(retrievedJob);
+	retrievedJob->m_state = JobState::RETRIEVED;
+	m_numCompletedJobs--;
+
 	m_completedJobsMutex.unlock();
-	return numCompletedJob;
+	return retrievedJob;
+}
+
+void JobSystem::DrainCompletedJobInbox()
+{
+	Job* newestJob = m_completedJobInbox.exchange(nullptr, std::memory_order_acquire);
+
+	// The inbox is newest first, reverse it so jobs are retrieved in completion order
+	Job* oldestJob = nullptr;
+	while (newestJob)
+	{
+		Job* nextJob = newestJob->m_nextCompletedJob;
+		newestJob->m_nextCompletedJob = oldestJob;
+		oldestJob = newestJob;
+		newestJob = nextJob;
+	}
+
+	while (oldestJob)
+	{
+		Job* nextJob = oldestJob->m_nextCompletedJob;
+		oldestJob->m_prevCompletedJob = m_completedJobsTail;
+		oldestJob->m_nextCompletedJob = nullptr;
+		oldestJob->m_isInCompletedList = true;
+		if (m_completedJobsTail)
+		{
+			m_completedJobsTail->m_nextCompletedJob = oldestJob;
+		}
+		else
+		{
+			m_completedJobsHead = oldestJob;
+		}
+		m_completedJobsTail = oldestJob;
+		oldestJob = nextJob;
+	}
+}
+
+void JobSystem::UnlinkCompletedJob(Job* job)
+{
+	if (job->m_prevCompletedJob)
+	{
+		job->m_prevCompletedJob->m_nextCompletedJob = job->m_nextCompletedJob;
+	}
+	else
+	{
+		m_completedJobsHead = job->m_nextCompletedJob;
+	}
+	if (job->m_nextCompletedJob)
+	{
+		job->m_nextCompletedJob->m_prevCompletedJob = job->m_prevCompletedJob;
+	}
+	else
+	{
+		m_completedJobsTail = job->m_prevCompletedJob;
+	}
+	job->m_nextCompletedJob = nullptr;
+	job->m_prevCompletedJob = nullptr;
+	job->m_isInCompletedList = false;
+}
+
+void JobSystem::RecordQueuedJobsHighWaterMark(int numQueuedJobs)
+{
+	int highWaterMark = m_queuedJobsHighWaterMark.load(std::memory_order_relaxed);
+	while (numQueuedJobs > highWaterMark && !m_queuedJobsHighWaterMark.compare_exchange_weak(highWaterMark, numQueuedJobs, std::memory_order_relaxed))
+	{
+	}
+}
+
+size_t JobSystem::GetNumQueuedJobs() const
+{
+	int numQueuedJob = m_numQueuedJobs.load();
+	return numQueuedJob > 0 ? (size_t)numQueuedJob : 0;
+}
+
+size_t JobSystem::GetNumCompletedJobs() const
+{
+	int numCompletedJob = m_numCompletedJobs.load();
+	return numCompletedJob > 0 ? (size_t)numCompletedJob : 0;
+}
+
+size_t JobSystem::GetNumExecutingJobs() const
+{
+	int numExecutingJob = m_numExecutingJobs.load();
+	return numExecutingJob > 0 ? (size_t)numExecutingJob : 0;
+}
+
+int JobSystem::GetNumWorkers() const
+{
+	return (int)m_workers.size();
 }
 
 void JobSystem::ClearAllJobs()
 {
 	m_queuedJobsMutex.lock();
-	m_executingJobsMutex.lock();
 	m_completedJobsMutex.lock();
 
-	for (size_t i = 0; i < m_queuedJobs.size(); i++)
+	int numTypeQueues = m_numJobTypeQueues.load();
+	for (int typeIndex = 0; typeIndex < numTypeQueues; typeIndex++)
 	{
-		delete m_queuedJobs[i];
+		JobTypeQueue* typeQueue = m_queuedJobsByType[typeIndex];
+		if (typeQueue->m_ring)
+		{
+			while (Job* ringJob = typeQueue->m_ring->TryPop())
+			{
+				DeleteClearedJob(ringJob);
+				m_numQueuedJobs--;
+				m_numGlobalQueuedJobs--;
+			}
+		}
+		for (size_t i = 0; i < typeQueue->m_jobs.size(); i++)
+		{
+			DeleteClearedJob(typeQueue->m_jobs[i]);
+			m_numQueuedJobs--;
+			m_numGlobalQueuedJobs--;
+		}
+		typeQueue->m_numOverflowJobs -= (int)typeQueue->m_jobs.size();
+		typeQueue->m_jobs.clear();
 	}
-	for (size_t i = 0; i < m_executingJobs.size(); i++)
+	for (size_t i = 0; i < m_workers.size(); i++)
 	{
-		delete m_executingJobs[i];
+		while (Job* localJob = m_workers[i]->m_localJobs->Steal())
+		{
+			DeleteClearedJob(localJob);
+			m_numQueuedJobs--;
+		}
 	}
-	for (size_t i = 0; i < m_completedJobs.size(); i++)
+
+	// Jobs still executing belong to their worker until they complete, they are cleared on a later call
+	DrainCompletedJobInbox();
+	while (m_completedJobsHead)
 	{
-		delete m_completedJobs[i];
+		Job* completedJob = m_completedJobsHead;
+		UnlinkCompletedJob(completedJob);
+		delete completedJob;
+		m_numCompletedJobs--;
 	}
 
-	m_queuedJobs.clear();
-	m_executingJobs.clear();
-	m_completedJobs.clear();
-
 	m_queuedJobsMutex.unlock();
-	m_executingJobsMutex.unlock();
 	m_completedJobsMutex.unlock();
 }
 
+void JobSystem::DeleteClearedJob(Job* job)
+{
+	// A cleared job never finishes, so the reference it held on each dependent is dropped here instead.
+	// Dependents left waiting only on cleared jobs are cleared with it; those still waiting on an
+	// executing job are released when that job completes
+	std::vector<Job*> jobsToDelete;
+	jobsToDelete.push_back(job);
+	while (!jobsToDelete.empty())
+	{
+		Job* clearedJob = jobsToDelete.back();
+		jobsToDelete.pop_back();
+
+		std::vector<Job*> dependents;
+		clearedJob->m_dependentsMutex.lock();
+		clearedJob->m_hasFinishedExecuting = true;
+		dependents.swap(clearedJob->m_dependents);
+		clearedJob->m_dependentsMutex.unlock();
+
+		for (size_t i = 0; i < dependents.size(); i++)
+		{
+			if (dependents[i]->m_numPendingDependencies.fetch_sub(1) == 1)
+			{
+				jobsToDelete.push_back(dependents[i]);
+			}
+		}
+
+		if (clearedJob->m_deleteOnComplete)
+		{
+			ReleaseJob(clearedJob);
+		}
+		else
+		{
+			delete clearedJob;
+		}
+	}
+}
+
 void JobSystem::SetWorkerThreadJobFlags(unsigned int bitflags, int num)
 {
 	int tracker = num;
@@ -227,9 +1186,556 @@ void JobSystem::SetWorkerThreadJobFlags(unsigned int bitflags, int num)
 			tracker--;
 			if (tracker <= 0)
 			{
-				return;
+				break;
 			}
 		}
 	}
 
+	// Workers read this while waking each other, so publish the recomputed value in one store
+	bool hasMixedWorkerFlags = false;
+	for (size_t i = 1; i < m_workers.size(); i++)
+	{
+		if (m_workers[i]->m_jobTypeBitflags != m_workers[0]->m_jobTypeBitflags)
+		{
+			hasMixedWorkerFlags = true;
+		}
+	}
+	m_hasMixedWorkerFlags = hasMixedWorkerFlags;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// PROFILING
+
+void JobSystem::SetProfilingEnabled(bool isEnabled)
+{
+	if (isEnabled && !m_isProfiling)
+	{
+		m_frameStartTime = GetCurrentTimeSeconds();
+		m_queuedJobsHighWaterMark = m_numQueuedJobs.load();
+	}
+	m_isProfiling = isEnabled;
+}
+
+bool JobSystem::IsProfilingEnabled() const
+{
+	return m_isProfiling;
+}
+
+std::deque<JobFrameProfile> const& JobSystem::GetProfiledFrames() const
+{
+	return m_profiledFrames;
+}
+
+bool JobSystem::ExportChromeTrace(std::string const& filePath) const
+{
+	if (m_profiledFrames.empty())
+	{
+		return false;
+	}
+
+	// Chrome's trace viewer (chrome://tracing, ui.perfetto.dev) wants microseconds from any origin
+	double originTime = m_profiledFrames.front().m_startTime;
+	int frameTrackId = (int)m_workers.size();
+
+	std::string json = "{\"traceEvents\":[\n";
+	json += Stringf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"Frames\"}}", frameTrackId);
+	for (size_t workerIndex = 0; workerIndex < m_workers.size(); workerIndex++)
+	{
+		json += Stringf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"Worker %d\"}}", (int)workerIndex, (int)workerIndex);
+	}
+
+	for (size_t frameIndex = 0; frameIndex < m_profiledFrames.size(); frameIndex++)
+	{
+		JobFrameProfile const& frame = m_profiledFrames[frameIndex];
+		double frameStartMicroseconds = (frame.m_startTime - originTime) * 1000000.0;
+		double frameDurationMicroseconds = (frame.m_endTime - frame.m_startTime) * 1000000.0;
+
+		json += Stringf(",\n{\"name\":\"Frame %d\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d,\"args\":{\"jobs\":%d,\"queueHighWater\":%d}}",
+			frame.m_frameIndex, frameStartMicroseconds, frameDurationMicroseconds, frameTrackId, (int)frame.m_events.size(), frame.m_queuedJobsHighWaterMark);
+		json += Stringf(",\n{\"name\":\"Queued jobs high-water\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"args\":{\"jobs\":%d}}",
+			frameStartMicroseconds, frame.m_queuedJobsHighWaterMark);
+
+		for (size_t eventIndex = 0; eventIndex < frame.m_events.size(); eventIndex++)
+		{
+			JobProfileEvent const& profileEvent = frame.m_events[eventIndex];
+			double waitMicroseconds = profileEvent.m_queuedTime > 0.0 ? (profileEvent.m_startTime - profileEvent.m_queuedTime) * 1000000.0 : 0.0;
+			json += Stringf(",\n{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d,\"args\":{\"flags\":%u,\"waitUs\":%.3f}}",
+				profileEvent.m_name, (profileEvent.m_startTime - originTime) * 1000000.0, (profileEvent.m_endTime - profileEvent.m_startTime) * 1000000.0,
+				profileEvent.m_workerId, profileEvent.m_bitflags, waitMicroseconds);
+		}
+	}
+	json += "\n]}\n";
+
+	std::vector<uint8_t> buffer(json.begin(), json.end());
+	return FileWriteFromBuffer(buffer, filePath);
+}
+
+bool JobSystem::Command_JobProfile(EventArgs& args)
+{
+	JobSystem* system = s_commandJobSystem;
+	if (!system)
+	{
+		return false;
+	}
+
+	std::string enabledText = args.GetValue("enabled", "");
+	if (!enabledText.empty())
+	{
+		system->SetProfilingEnabled(args.GetValue("enabled", false));
+		g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Job profiling %s", system->IsProfilingEnabled() ? "enabled" : "disabled"));
+	}
+
+	std::string exportPath = args.GetValue("export", "");
+	if (!exportPath.empty())
+	{
+		if (system->ExportChromeTrace(exportPath))
+		{
+			g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Exported %d frames of job trace to %s", (int)system->m_profiledFrames.size(), exportPath.c_str()));
+		}
+		else
+		{
+			g_theDevConsole->AddLine(DevConsole::WARNING, "Nothing to export, enable profiling with jobprofile enabled=true first");
+		}
+	}
+
+	if (!enabledText.empty() || !exportPath.empty())
+	{
+		return false;
+	}
+
+	std::deque<JobFrameProfile> const& frames = system->m_profiledFrames;
+	if (frames.empty())
+	{
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, "No job profile recorded. Usage: jobprofile enabled=true|false, jobprofile export=<file.json>");
+		return false;
+	}
+
+	// Summary over every recorded frame
+	double totalFrameSeconds = 0.0;
+	double totalWaitSeconds = 0.0;
+	double maxWaitSeconds = 0.0;
+	int numJobs = 0;
+	int queuedJobsHighWaterMark = 0;
+	std::vector<double> workerBusySeconds(system->m_workers.size(), 0.0);
+	for (size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++)
+	{
+		JobFrameProfile const& frame = frames[frameIndex];
+		totalFrameSeconds += frame.m_endTime - frame.m_startTime;
+		totalWaitSeconds += frame.m_totalWaitSeconds;
+		numJobs += (int)frame.m_events.size();
+		if (frame.m_maxWaitSeconds > maxWaitSeconds)
+		{
+			maxWaitSeconds = frame.m_maxWaitSeconds;
+		}
+		if (frame.m_queuedJobsHighWaterMark > queuedJobsHighWaterMark)
+		{
+			queuedJobsHighWaterMark = frame.m_queuedJobsHighWaterMark;
+		}
+		for (size_t workerIndex = 0; workerIndex < frame.m_workerBusySeconds.size() && workerIndex < workerBusySeconds.size(); workerIndex++)
+		{
+			workerBusySeconds[workerIndex] += frame.m_workerBusySeconds[workerIndex];
+		}
+	}
+
+	int numFrames = (int)frames.size();
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Job profile over %d frames: %.1f jobs/frame, wait avg %.3f ms max %.3f ms, queue high-water %d",
+		numFrames, (double)numJobs / (double)numFrames, numJobs > 0 ? totalWaitSeconds * 1000.0 / (double)numJobs : 0.0, maxWaitSeconds * 1000.0, queuedJobsHighWaterMark));
+	for (size_t workerIndex = 0; workerIndex < workerBusySeconds.size(); workerIndex++)
+	{
+		double busyRatio = totalFrameSeconds > 0.0 ? workerBusySeconds[workerIndex] / totalFrameSeconds : 0.0;
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  worker %2d: busy %5.1f%%, idle %5.1f%%", (int)workerIndex, busyRatio * 100.0, (1.0 - busyRatio) * 100.0));
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// PARALLEL FOR
+
+struct ParallelForJob : public Job
+{
+	virtual void Execute() override
+	{
+		m_context->RunChunks();
+	}
+
+	std::shared_ptr<ParallelForContext> m_context;
+};
+
+void ParallelForContext::RunChunks()
+{
+	while (true)
+	{
+		int chunkIndex = m_nextChunk.fetch_add(1);
+		if (chunkIndex >= m_numChunks)
+		{
+			return;
+		}
+
+		int chunkBegin = m_begin + chunkIndex * m_grain;
+		int chunkEnd = chunkBegin + m_grain < m_end ? chunkBegin + m_grain : m_end;
+		m_chunkFunction(chunkBegin, chunkEnd);
+
+		if (m_numChunksRemaining.fetch_sub(1) == 1)
+		{
+			m_doneMutex.lock();
+			m_isDone = true;
+			m_doneMutex.unlock();
+			m_doneCondition.notify_all();
+		}
+	}
+}
+
+void JobSystem::ParallelForRange(int begin, int end, int grain, std::function<void(int, int)> const& chunkFunction)
+{
+	if (grain < 1)
+	{
+		grain = 1;
+	}
+	if (end <= begin)
+	{
+		return;
+	}
+	if (end - begin <= grain || m_workers.empty())
+	{
+		chunkFunction(begin, end);
+		return;
+	}
+
+	std::shared_ptr<ParallelForContext> context = std::make_shared<ParallelForContext>();
+	context->m_chunkFunction = chunkFunction;
+	context->m_begin = begin;
+	context->m_end = end;
+	context->m_grain = grain;
+	context->m_numChunks = (end - begin + grain - 1) / grain;
+	context->m_numChunksRemaining = context->m_numChunks;
+
+	// The calling thread works too, so it needs one helper less than there are chunks
+	int numHelpers = context->m_numChunks - 1;
+	if (numHelpers > (int)m_workers.size())
+	{
+		numHelpers = (int)m_workers.size();
+	}
+	for (int i = 0; i < numHelpers; i++)
+	{
+		ParallelForJob* helper = new ParallelForJob();
+		helper->m_context = context;
+		helper->m_deleteOnComplete = true;
+		QueueJob(helper);
+	}
+
+	context->RunChunks();
+
+	std::unique_lock<std::mutex> lock(context->m_doneMutex);
+	context->m_doneCondition.wait(lock, [&context]() { return context->m_isDone; });
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------------
+// BENCHMARK
+
+struct BenchmarkJob : public Job
+{
+	virtual void Execute() override
+	{
+		// Small fixed amount of ALU work, roughly what a fine grained gameplay job costs
+		unsigned int value = m_seed;
+		for (int i = 0; i < m_numIterations; i++)
+		{
+			value ^= value << 13;
+			value ^= value >> 17;
+			value ^= value << 5;
+		}
+		m_result = value;
+	}
+
+	unsigned int m_seed = 1;
+	unsigned int m_result = 0;
+	int m_numIterations = 256;
+};
+
+bool JobSystem::Command_JobBenchmark(EventArgs& args)
+{
+	int numJobs = args.GetValue("jobs", 100000);
+	int numIterations = args.GetValue("work", 256);
+	int maxWorkers = args.GetValue("workers", (int)std::thread::hardware_concurrency() - 1);
+	bool isMixed = args.GetValue("mixed", false);
+
+	// Mixed mode dedicates one worker to type 2 jobs and makes every 8th job (including the first) type 2,
+	// so a blocked type at the front of the queue shows up as a throughput collapse
+	int minWorkers = isMixed ? 2 : 1;
+	if (maxWorkers < minWorkers)
+	{
+		maxWorkers = minWorkers;
+	}
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Job benchmark: %d jobs, %d iterations per job%s", numJobs, numIterations, isMixed ? ", mixed job types" : ""));
+
+	std::vector<int> workerCounts;
+	for (int numWorkers = minWorkers; numWorkers < maxWorkers; numWorkers *= 2)
+	{
+		workerCounts.push_back(numWorkers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	double baselineJobsPerSecond = 0.0;
+	for (size_t countIndex = 0; countIndex < workerCounts.size(); countIndex++)
+	{
+		int numWorkers = workerCounts[countIndex];
+		JobSystemConfig config;
+		config.m_numWorkers = numWorkers;
+		JobSystem system(config);
+		system.CreateWorkers(numWorkers);
+		if (isMixed)
+		{
+			system.SetWorkerThreadJobFlags(2, 1);
+		}
+
+		std::vector<BenchmarkJob*> jobs;
+		jobs.reserve(numJobs);
+		for (int i = 0; i < numJobs; i++)
+		{
+			BenchmarkJob* job = new BenchmarkJob();
+			job->m_seed = (unsigned int)i + 1;
+			job->m_numIterations = numIterations;
+			if (isMixed && i % 8 == 0)
+			{
+				job->m_Bitflags = 2;
+			}
+			jobs.push_back(job);
+		}
+
+		double startTime = GetCurrentTimeSeconds();
+		for (int i = 0; i < numJobs; i++)
+		{
+			system.QueueJob(jobs[i]);
+		}
+		int numRetrieved = 0;
+		while (numRetrieved < numJobs)
+		{
+			Job* job = system.RetrieveJob();
+			if (job)
+			{
+				numRetrieved++;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		double elapsedSeconds = GetCurrentTimeSeconds() - startTime;
+
+		system.Shutdown();
+		for (int i = 0; i < numJobs; i++)
+		{
+			delete jobs[i];
+		}
+
+		double jobsPerSecond = elapsedSeconds > 0.0 ? (double)numJobs / elapsedSeconds : 0.0;
+		if (countIndex == 0)
+		{
+			baselineJobsPerSecond = jobsPerSecond;
+		}
+		double speedup = baselineJobsPerSecond > 0.0 ? jobsPerSecond / baselineJobsPerSecond : 0.0;
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %2d workers: %8.2f ms, %10.0f jobs/s, %.2fx", numWorkers, elapsedSeconds * 1000.0, jobsPerSecond, speedup));
+	}
+
+	return false;
+}
+
+bool JobSystem::Command_JobFrameBenchmark(EventArgs& args)
+{
+	int numJobsPerFrame = args.GetValue("jobs", 10000);
+	int numFrames = args.GetValue("frames", 60);
+	int numWorkers = args.GetValue("workers", (int)std::thread::hardware_concurrency() - 1);
+	if (numWorkers < 1)
+	{
+		numWorkers = 1;
+	}
+
+	JobSystemConfig config;
+	config.m_numWorkers = numWorkers;
+	JobSystem system(config);
+	system.CreateWorkers(numWorkers);
+
+	std::vector<BenchmarkJob*> jobs;
+	jobs.reserve(numJobsPerFrame);
+	for (int i = 0; i < numJobsPerFrame; i++)
+	{
+		BenchmarkJob* job = new BenchmarkJob();
+		job->m_seed = (unsigned int)i + 1;
+		job->m_numIterations = 16;
+		jobs.push_back(job);
+	}
+
+	// Retrieve by handle in reverse queue order, the worst case for a list scan
+	double totalSeconds = 0.0;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		double frameStartTime = GetCurrentTimeSeconds();
+		for (int i = 0; i < numJobsPerFrame; i++)
+		{
+			system.QueueJob(jobs[i]);
+		}
+		for (int i = numJobsPerFrame - 1; i >= 0; i--)
+		{
+			while (!system.RetrieveJob(jobs[i]))
+			{
+				std::this_thread::yield();
+			}
+		}
+		totalSeconds += GetCurrentTimeSeconds() - frameStartTime;
+	}
+
+	system.Shutdown();
+	for (int i = 0; i < numJobsPerFrame; i++)
+	{
+		delete jobs[i];
+	}
+
+	double secondsPerFrame = numFrames > 0 ? totalSeconds / (double)numFrames : 0.0;
+	double nanosecondsPerJob = numJobsPerFrame > 0 ? secondsPerFrame * 1000000000.0 / (double)numJobsPerFrame : 0.0;
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Job frame benchmark: %d jobs/frame, %d frames, %d workers", numJobsPerFrame, numFrames, numWorkers));
+	g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %.3f ms/frame, %.1f ns per job queue+complete+retrieve", secondsPerFrame * 1000.0, nanosecondsPerJob));
+	return false;
+}
+
+bool JobSystem::Command_ParallelForBenchmark(EventArgs& args)
+{
+	int grain = args.GetValue("grain", 4096);
+	int numRepeats = args.GetValue("repeats", 10);
+	int numWorkers = args.GetValue("workers", (int)std::thread::hardware_concurrency() - 1);
+	if (numWorkers < 1)
+	{
+		numWorkers = 1;
+	}
+	if (numRepeats < 1)
+	{
+		numRepeats = 1;
+	}
+
+	JobSystemConfig config;
+	config.m_numWorkers = numWorkers;
+	JobSystem system(config);
+	system.CreateWorkers(numWorkers);
+
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("ParallelFor benchmark: grain %d, %d workers, %d repeats", grain, numWorkers, numRepeats));
+
+	int const elementCounts[] = { 1000, 10000, 30000, 100000, 300000, 1000000 };
+	for (int countIndex = 0; countIndex < (int)(sizeof(elementCounts) / sizeof(elementCounts[0])); countIndex++)
+	{
+		int numElements = elementCounts[countIndex];
+		std::vector<float> values(numElements, 1.f);
+
+		double serialStartTime = GetCurrentTimeSeconds();
+		for (int repeat = 0; repeat < numRepeats; repeat++)
+		{
+			for (int i = 0; i < numElements; i++)
+			{
+				values[i] = values[i] * 0.999f + 0.5f / (1.f + values[i] * values[i]);
+			}
+		}
+		double serialSeconds = (GetCurrentTimeSeconds() - serialStartTime) / (double)numRepeats;
+
+		double parallelStartTime = GetCurrentTimeSeconds();
+		for (int repeat = 0; repeat < numRepeats; repeat++)
+		{
+			system.ParallelFor(0, numElements, grain, [&values](int i)
+				{
+					values[i] = values[i] * 0.999f + 0.5f / (1.f + values[i] * values[i]);
+				});
+		}
+		double parallelSeconds = (GetCurrentTimeSeconds() - parallelStartTime) / (double)numRepeats;
+
+		double reduceStartTime = GetCurrentTimeSeconds();
+		double sum = 0.0;
+		for (int repeat = 0; repeat < numRepeats; repeat++)
+		{
+			sum = system.ParallelReduce(0, numElements, grain, 0.0, [&values](int chunkBegin, int chunkEnd)
+				{
+					double chunkSum = 0.0;
+					for (int i = chunkBegin; i < chunkEnd; i++)
+					{
+						chunkSum += values[i];
+					}
+					return chunkSum;
+				}, [](double a, double b) { return a + b; });
+		}
+		double reduceSeconds = (GetCurrentTimeSeconds() - reduceStartTime) / (double)numRepeats;
+
+		double speedup = parallelSeconds > 0.0 ? serialSeconds / parallelSeconds : 0.0;
+		g_theDevConsole->AddLine(speedup > 1.0 ? DevConsole::INFO_MINOR : DevConsole::WARNING,
+			Stringf("  %8d elements: serial %8.3f ms, parallel %8.3f ms (%.2fx), reduce %8.3f ms (sum %.1f)",
+				numElements, serialSeconds * 1000.0, parallelSeconds * 1000.0, speedup, reduceSeconds * 1000.0, sum));
+	}
+
+	system.Shutdown();
+	return false;
+}
+
+bool JobSystem::Command_JobQueueBenchmark(EventArgs& args)
+{
+	int numJobs = args.GetValue("jobs", 200000);
+	int numIterations = args.GetValue("work", 16);
+	int maxWorkers = args.GetValue("workers", (int)std::thread::hardware_concurrency() - 1);
+	if (maxWorkers < 1)
+	{
+		maxWorkers = 1;
+	}
+
+	// Tiny jobs created, queued, retrieved and deleted inside the timed region, so the
+	// cost measured is the queue and allocation overhead rather than the work
+	g_theDevConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Job queue benchmark: %d jobs, %d iterations per job", numJobs, numIterations));
+
+	std::vector<int> workerCounts;
+	for (int numWorkers = 1; numWorkers < maxWorkers; numWorkers *= 2)
+	{
+		workerCounts.push_back(numWorkers);
+	}
+	workerCounts.push_back(maxWorkers);
+
+	for (size_t countIndex = 0; countIndex < workerCounts.size(); countIndex++)
+	{
+		int numWorkers = workerCounts[countIndex];
+		double jobsPerSecond[2] = {};
+		for (int mode = 0; mode < 2; mode++)
+		{
+			JobSystemConfig config;
+			config.m_numWorkers = numWorkers;
+			config.m_useLockFreeQueue = mode == 1;
+			JobSystem system(config);
+			system.CreateWorkers(numWorkers);
+
+			double startTime = GetCurrentTimeSeconds();
+			for (int i = 0; i < numJobs; i++)
+			{
+				BenchmarkJob* job = new BenchmarkJob();
+				job->m_seed = (unsigned int)i + 1;
+				job->m_numIterations = numIterations;
+				system.QueueJob(job);
+			}
+			int numRetrieved = 0;
+			while (numRetrieved < numJobs)
+			{
+				Job* job = system.RetrieveJob();
+				if (job)
+				{
+					delete job;
+					numRetrieved++;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+			double elapsedSeconds = GetCurrentTimeSeconds() - startTime;
+			system.Shutdown();
+
+			jobsPerSecond[mode] = elapsedSeconds > 0.0 ? (double)numJobs / elapsedSeconds : 0.0;
+		}
+
+		double speedup = jobsPerSecond[0] > 0.0 ? jobsPerSecond[1] / jobsPerSecond[0] : 0.0;
+		g_theDevConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %2d workers: mutex %10.0f jobs/s, lock-free %10.0f jobs/s, %.2fx",
+			numWorkers, jobsPerSecond[0], jobsPerSecond[1], speedup));
+	}
+
+	return false;
 }
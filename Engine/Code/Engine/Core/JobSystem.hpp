@@ -4,10 +4,19 @@
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <string>
+
+class JobSystem;
+class NamedStrings;
+typedef NamedStrings EventArgs;
 
 enum class JobState
 {
 	NEW,
+	WAITING,
 	QUEUED,
 	EXECUTING,
 	COMPLETED,
@@ -16,18 +25,152 @@ enum class JobState
 struct JobSystemConfig
 {
 	int m_numWorkers = -1;
+	int m_localQueueCapacity = 4096;
+	int m_globalClaimBatchSize = 32;
+	int m_numSpinsBeforeSleep = 64;
+	int m_globalQueueCapacity = 4096;
+	bool m_useLockFreeQueue = true;
+	bool m_isProfilingEnabled = false;
+	int m_maxProfiledFrames = 60;
 };
 
+constexpr int MAX_JOB_TYPE_QUEUES = 32;
+
 struct Job
 {
 	Job() = default;
 	virtual ~Job() = default;
 
 	virtual void Execute() = 0;
+
+	// Jobs come from per-thread slabs instead of the heap, see JOB ALLOCATOR in JobSystem.cpp
+	static void* operator new(size_t size);
+	static void operator delete(void* pointer, size_t size);
+
 	std::atomic<unsigned int> m_Bitflags = 1;
 	std::atomic<JobState> m_state = JobState::NEW;
+
+	// Dependencies: the count holds one extra reference until QueueJob is called, so a job
+	// is only released once it has been queued AND every prerequisite has finished
+	std::atomic<int> m_numPendingDependencies = 1;
+	std::vector<Job*> m_dependents;
+	std::mutex m_dependentsMutex;
+	std::atomic<bool> m_hasFinishedExecuting = false;
+
+	// Fire-and-forget jobs (e.g. interior nodes of a job graph) are deleted by the JobSystem
+	// instead of going to the completed list, so nobody has to retrieve them. The JobSystem holds
+	// one reference until the job completes; whoever still links dependents to the job after
+	// queueing it must RetainJob it first and ReleaseJob it once they are linked
+	bool m_deleteOnComplete = false;
+	std::atomic<int> m_numReferences = 1;
+
+	// Intrusive links owned by the JobSystem while the job is completed but not yet retrieved
+	Job* m_nextCompletedJob = nullptr;
+	Job* m_prevCompletedJob = nullptr;
+	bool m_isInCompletedList = false;
+
+	// Only written while the JobSystem is profiling
+	double m_queuedTime = 0.0;
+};
+
+// One executed job, as seen by the worker that ran it
+struct JobProfileEvent
+{
+	char const* m_name = nullptr;
+	unsigned int m_bitflags = 0;
+	int m_workerId = -1;
+	double m_queuedTime = 0.0;
+	double m_startTime = 0.0;
+	double m_endTime = 0.0;
+};
+
+// Everything that finished between one BeginFrame and the following EndFrame
+struct JobFrameProfile
+{
+	int m_frameIndex = 0;
+	double m_startTime = 0.0;
+	double m_endTime = 0.0;
+	int m_queuedJobsHighWaterMark = 0;
+	double m_totalWaitSeconds = 0.0;
+	double m_maxWaitSeconds = 0.0;
+	std::vector<double> m_workerBusySeconds;
+	std::vector<JobProfileEvent> m_events;
 };
 
+// Chase-Lev work-stealing deque. Only the owning worker may Push/Pop (bottom end),
+// any thread may Steal (top end). Capacity is fixed; Push returns false when full.
+class JobDeque
+{
+public:
+	explicit JobDeque(int capacity);
+	~JobDeque();
+	JobDeque(const JobDeque& copy) = delete;
+
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+	bool IsEmpty() const;
+
+private:
+	std::atomic<Job*>* m_buffer = nullptr;
+	long long m_mask = 0;
+	std::atomic<long long> m_top = 0;
+	std::atomic<long long> m_bottom = 0;
+};
+
+// Bounded multi-producer multi-consumer ring (Vyukov). Each cell carries a sequence number
+// that tells producers and consumers whose turn it is, so neither side needs a lock.
+class JobRing
+{
+public:
+	explicit JobRing(int capacity);
+	~JobRing();
+	JobRing(const JobRing& copy) = delete;
+
+	bool TryPush(Job* job);
+	Job* TryPop();
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> m_sequence = 0;
+		Job* m_job = nullptr;
+	};
+
+	Cell* m_cells = nullptr;
+	size_t m_mask = 0;
+	alignas(64) std::atomic<size_t> m_enqueuePosition = 0;
+	alignas(64) std::atomic<size_t> m_dequeuePosition = 0;
+};
+
+// Shared queue for one exact combination of job type bits, so a job nobody can run yet
+// never sits in front of jobs that somebody can. With the lock-free queue jobs go through
+// the ring and only spill into m_jobs when it is full; otherwise m_jobs is the whole queue.
+struct JobTypeQueue
+{
+	unsigned int m_bitflags = 0;
+	JobRing* m_ring = nullptr;
+	std::deque<Job*> m_jobs;
+	std::atomic<int> m_numOverflowJobs = 0;
+};
+
+// Shared state of one ParallelFor call. Helper jobs keep it alive through a shared_ptr because
+// a helper can start after the caller has already finished every chunk and returned
+struct ParallelForContext
+{
+	void RunChunks();
+
+	std::function<void(int, int)> m_chunkFunction;
+	int m_begin = 0;
+	int m_end = 0;
+	int m_grain = 1;
+	int m_numChunks = 0;
+	std::atomic<int> m_nextChunk = 0;
+	std::atomic<int> m_numChunksRemaining = 0;
+	std::mutex m_doneMutex;
+	std::condition_variable m_doneCondition;
+	bool m_isDone = false;
+};
 
 class JobWorker
 {
@@ -42,7 +185,14 @@ private:
 	int m_id = -1;
 	std::atomic<unsigned int> m_jobTypeBitflags = 1;
 	JobSystem* m_system = nullptr;
+	JobDeque* m_localJobs = nullptr;
+	unsigned int m_stealSeed = 0;
+	size_t m_nextTypeQueueIndex = 0;
 	std::thread* m_thread = nullptr;
+
+	// Filled by this worker while profiling, emptied by EndFrame
+	std::mutex m_profileEventsMutex;
+	std::vector<JobProfileEvent> m_profileEvents;
 };
 
 class JobSystem
@@ -51,6 +201,7 @@ class JobSystem
 
 public:
 	JobSystem(JobSystemConfig config);
+	~JobSystem();
 
 	void Startup();
 	void BeginFrame();
@@ -62,22 +213,129 @@ public:
 	void CreateWorkers(int num);
 	void DestroyWorkers();
 	void QueueJob(Job* jobToQueue);
+	void QueueJob(Job* jobToQueue, std::vector<Job*> const& prerequisites);
+	void AddDependency(Job* job, Job* prerequisite);
+	void RetainJob(Job* job);
+	void ReleaseJob(Job* job);
 	Job* ClaimJob(JobWorker* worker);
 	void CompleteJob(Job* jobToComplete);
 	Job* RetrieveJob(Job* jobToRetrived = nullptr);
 	size_t GetNumQueuedJobs() const;
 	size_t GetNumCompletedJobs() const;
+	size_t GetNumExecutingJobs() const;
+	int GetNumWorkers() const;
 
 	void ClearAllJobs();
 	void SetWorkerThreadJobFlags(unsigned int bitflags, int num);
 
+	// Data parallel helpers. [begin, end) is split into chunks of 'grain' indices that workers and the
+	// calling thread claim together; ranges of one chunk or less run inline. Returns once every chunk is done.
+	void ParallelForRange(int begin, int end, int grain, std::function<void(int, int)> const& chunkFunction);
+	template<typename IndexFunction>
+	void ParallelFor(int begin, int end, int grain, IndexFunction const& indexFunction);
+	template<typename T, typename ChunkFunction, typename CombineFunction>
+	T ParallelReduce(int begin, int end, int grain, T identity, ChunkFunction const& chunkFunction, CombineFunction const& combineFunction);
+
+	static bool Command_JobBenchmark(EventArgs& args);
+	static bool Command_JobFrameBenchmark(EventArgs& args);
+	static bool Command_ParallelForBenchmark(EventArgs& args);
+	static bool Command_JobQueueBenchmark(EventArgs& args);
+
+	// Profiling records every job's queue/start/end time plus per-frame worker busy time and queue
+	// high-water marks, keeping the last m_maxProfiledFrames frames
+	void SetProfilingEnabled(bool isEnabled);
+	bool IsProfilingEnabled() const;
+	std::deque<JobFrameProfile> const& GetProfiledFrames() const;
+	bool ExportChromeTrace(std::string const& filePath) const;
+	static bool Command_JobProfile(EventArgs& args);
+
+private:
+	void EnqueueReadyJob(Job* job);
+	void ReleaseDependents(Job* job);
+	void DeleteClearedJob(Job* job);
+	JobTypeQueue* GetOrCreateTypeQueue(unsigned int jobFlags);
+	void PushToTypeQueue(JobTypeQueue* typeQueue, Job* job);
+	Job* PopFromTypeQueue(JobTypeQueue* typeQueue);
+	Job* ClaimFromGlobalQueue(JobWorker* worker);
+	Job* ClaimFromGlobalRing(JobWorker* worker);
+	Job* StealJob(JobWorker* thief);
+	void MarkJobClaimed(Job* job);
+	void WaitForWork(unsigned int observedWakeCount);
+	void WakeWorkers();
+	void DrainCompletedJobInbox();
+	void UnlinkCompletedJob(Job* job);
+	void RecordQueuedJobsHighWaterMark(int numQueuedJobs);
+
 private:
 	std::vector<JobWorker*> m_workers;
-	std::deque<Job*> m_queuedJobs;
-	std::deque<Job*> m_executingJobs;
-	std::deque<Job*> m_completedJobs;
+	// Fixed table so workers can scan it without a lock; entries are only ever appended
+	JobTypeQueue* m_queuedJobsByType[MAX_JOB_TYPE_QUEUES] = {};
+	std::atomic<int> m_numJobTypeQueues = 0;
 	mutable std::mutex m_queuedJobsMutex;
-	mutable std::mutex m_executingJobsMutex;
+
+	// Workers push finished jobs onto a lock-free inbox; retrieval moves them into
+	// an intrusive list so retrieving any specific job is O(1)
+	std::atomic<Job*> m_completedJobInbox = nullptr;
+	Job* m_completedJobsHead = nullptr;
+	Job* m_completedJobsTail = nullptr;
 	mutable std::mutex m_completedJobsMutex;
+	std::atomic<int> m_numExecutingJobs = 0;
+	std::atomic<int> m_numCompletedJobs = 0;
 	std::atomic<bool> m_isShuttingDown = false;
+
+	std::atomic<int> m_numQueuedJobs = 0;
+	std::atomic<int> m_numGlobalQueuedJobs = 0;
+	std::atomic<bool> m_hasMixedWorkerFlags = false;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<unsigned int> m_wakeCount = 0;
+	std::atomic<int> m_numSleepingWorkers = 0;
+
+	std::atomic<bool> m_isProfiling = false;
+	std::atomic<int> m_queuedJobsHighWaterMark = 0;
+	double m_frameStartTime = 0.0;
+	int m_frameIndex = 0;
+	std::deque<JobFrameProfile> m_profiledFrames;
 };
+
+template<typename IndexFunction>
+void JobSystem::ParallelFor(int begin, int end, int grain, IndexFunction const& indexFunction)
+{
+	ParallelForRange(begin, end, grain, [&indexFunction](int chunkBegin, int chunkEnd)
+		{
+			for (int index = chunkBegin; index < chunkEnd; index++)
+			{
+				indexFunction(index);
+			}
+		});
+}
+
+// chunkFunction(chunkBegin, chunkEnd) returns the partial result of its chunk. Partials are combined
+// in chunk order, so the result does not depend on how many workers took part
+template<typename T, typename ChunkFunction, typename CombineFunction>
+T JobSystem::ParallelReduce(int begin, int end, int grain, T identity, ChunkFunction const& chunkFunction, CombineFunction const& combineFunction)
+{
+	if (grain < 1)
+	{
+		grain = 1;
+	}
+	if (end <= begin)
+	{
+		return identity;
+	}
+
+	int numChunks = (end - begin + grain - 1) / grain;
+	std::vector<T> partialResults(numChunks, identity);
+	ParallelForRange(begin, end, grain, [&](int chunkBegin, int chunkEnd)
+		{
+			partialResults[(chunkBegin - begin) / grain] = chunkFunction(chunkBegin, chunkEnd);
+		});
+
+	T result = identity;
+	for (int chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+	{
+		result = combineFunction(result, partialResults[chunkIndex]);
+	}
+	return result;
+}
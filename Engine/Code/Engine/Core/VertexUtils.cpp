@@ -1,6 +1,7 @@
 #include "Engine/Core/VertexUtils.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/JobSystem.hpp"
 
 void TransformVertexArrayXY3D(int numVerts, Vertex_PCU* verts, float scaleXY,
 	float rotationDegreesAboutZ, Vec2 const& translationXY)
@@ -894,6 +895,20 @@ void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, const Mat44& transfo
 	}
 }
 
+void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, const Mat44& transform, JobSystem* jobSystem, int grain)
+{
+	if (!jobSystem)
+	{
+		TransformVertexArray3D(verts, transform);
+		return;
+	}
+
+	jobSystem->ParallelFor(0, (int)verts.size(), grain, [&verts, &transform](int i)
+		{
+			verts[i].m_position = transform.TransformPosition3D(verts[i].m_position);
+		});
+}
+
 AABB2 GetVertexBounds2D(const std::vector<Vertex_PCU>& verts)
 {
 	float minX = verts[0].m_position.x;
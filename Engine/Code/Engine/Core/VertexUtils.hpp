@@ -11,10 +11,12 @@
 #include "Engine/Math/Mat44.hpp"
 #include <vector>
 
+class JobSystem;
 
 // Utility
 void TransformVertexArrayXY3D(int numVerts, Vertex_PCU* verts, float uniformScaleXY, float rotationDegreesAboutZ, Vec2 const& translationXY);
 void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, const Mat44& transform);
+void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, const Mat44& transform, JobSystem* jobSystem, int grain = 4096);
 AABB2 GetVertexBounds2D(const std::vector<Vertex_PCU>& verts);
 
 // 2D
@@ -0,0 +1,48 @@
+#include "Engine/Math/Frustum.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+// Gribb and Hartmann: every clip-space bound is a plane in world space, made of the matrix's rows
+Frustum const Frustum::CreateFromWorldToClip(Mat44 const& worldToClip)
+{
+	float const* m = worldToClip.m_values;
+	Vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = Vec4(m[Mat44::Ix + row], m[Mat44::Jx + row], m[Mat44::Kx + row], m[Mat44::Tx + row]);
+	}
+	Vec4 planeCoefficients[NUM_FRUSTUM_PLANES] = {
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[2],
+		rows[3] - rows[2] };
+
+	Frustum frustum;
+	for (int planeIndex = 0; planeIndex < NUM_FRUSTUM_PLANES; planeIndex++)
+	{
+		Vec4 const& coefficients = planeCoefficients[planeIndex];
+		Vec3 normal = Vec3(coefficients.x, coefficients.y, coefficients.z);
+		float length = normal.GetLength();
+		float scale = length > 0.f ? 1.f / length : 0.f;
+		frustum.m_planes[planeIndex] = Plane3(normal * scale, -coefficients.w * scale);
+	}
+	return frustum;
+}
+
+bool Frustum::IsPointInside(Vec3 const& point) const
+{
+	return !IsSphereOutside(point, 0.f);
+}
+
+bool Frustum::IsSphereOutside(Vec3 const& center, float radius) const
+{
+	for (int planeIndex = 0; planeIndex < NUM_FRUSTUM_PLANES; planeIndex++)
+	{
+		if (m_planes[planeIndex].GetAltitudeOfPoint(center) < -radius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
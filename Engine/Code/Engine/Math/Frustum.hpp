@@ -0,0 +1,32 @@
+#pragma once
+#include "Engine/Math/Plane3.hpp"
+#include "Engine/Math/Mat44.hpp"
+
+enum FrustumPlane
+{
+	FRUSTUM_PLANE_LEFT,
+	FRUSTUM_PLANE_RIGHT,
+	FRUSTUM_PLANE_BOTTOM,
+	FRUSTUM_PLANE_TOP,
+	FRUSTUM_PLANE_NEAR,
+	FRUSTUM_PLANE_FAR,
+	NUM_FRUSTUM_PLANES
+};
+
+// Six planes with normals pointing inward, so a point is inside when its altitude over every plane is
+// at least 0
+struct Frustum
+{
+public:
+	Plane3 m_planes[NUM_FRUSTUM_PLANES];
+
+public:
+	Frustum() = default;
+	// From a matrix taking world positions to D3D clip space, where x and y run -w to w and z runs 0 to w
+	static Frustum const CreateFromWorldToClip(Mat44 const& worldToClip);
+
+	bool IsPointInside(Vec3 const& point) const;
+	// Conservative: a sphere near a corner can be kept while outside, but a sphere any part of which is
+	// inside is never culled
+	bool IsSphereOutside(Vec3 const& center, float radius) const;
+};
@@ -122,6 +122,13 @@ Mat44 Camera::GetModelMatrix() const
 	return modelMat;
 }
 
+Frustum Camera::GetWorldFrustum() const
+{
+	Mat44 worldToClip = GetProjectionMatrix();
+	worldToClip.Append(GetViewMatrix());
+	return Frustum::CreateFromWorldToClip(worldToClip);
+}
+
 EulerAngles Camera::GetOrientation() const
 {
 	return m_orientation;
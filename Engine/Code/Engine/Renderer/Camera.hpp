@@ -3,6 +3,7 @@
 #include "Engine/Math/AABB2.hpp"
 #include "Engine/Math/Mat44.hpp"
 #include "Engine/Math/EulerAngles.hpp"
+#include "Engine/Math/Frustum.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 
 class Camera {
@@ -37,6 +38,8 @@ public:
 	void SetTransform(const Vec3& position, const EulerAngles& orientation);
 	Mat44 GetViewMatrix() const;
 	Mat44 GetModelMatrix() const;
+	// What the camera sees, in world space, for culling on the CPU
+	Frustum GetWorldFrustum() const;
 
 	EulerAngles GetOrientation() const;
 
@@ -68,4 +68,62 @@ const char* g_defaultShaderSource = R"(
 		clip(color.a - 0.001f);
 		return float4(color);
 	}
-)";
\ No newline at end of file
+)";
+
+// Same as the default shader, but the model matrix and color come from the instance buffer in slot 1
+// instead of ModelConstants. The matrix arrives as its four basis columns, like Mat44 stores it.
+const char* g_defaultInstancedShaderSource = R"(
+	cbuffer CameraConstants : register(b2)
+	{
+		float4x4 ProjectionMatrix;
+		float4x4 ViewMatrix;
+	};
+
+	Texture2D diffuseTexture: register(t0);
+	SamplerState diffuseSampler: register(s0);
+
+	struct vs_input_t
+	{
+		float3 localPosition : POSITION;
+		float4 color : COLOR;
+		float2 uv : TEXCOORD;
+		float4 modelIBasis : MODEL_I;
+		float4 modelJBasis : MODEL_J;
+		float4 modelKBasis : MODEL_K;
+		float4 modelTranslation : MODEL_T;
+		float4 modelColor : MODEL_COLOR;
+	};
+	
+	struct v2p_t
+	{
+		float4 position : SV_Position;
+		float4 color : COLOR;
+		float2 uv : TEXCOORD;
+	};
+	
+	v2p_t VertexMain(vs_input_t input)
+	{
+		float4 worldPosition = input.modelIBasis * input.localPosition.x
+			+ input.modelJBasis * input.localPosition.y
+			+ input.modelKBasis * input.localPosition.z
+			+ input.modelTranslation;
+
+		float4 viewPosition = mul(ViewMatrix, worldPosition);
+
+		float4 clipPosition = mul(ProjectionMatrix, viewPosition);
+
+		v2p_t v2p;
+		v2p.position = clipPosition;
+		v2p.color = input.color * input.modelColor;
+		v2p.uv = input.uv;
+		return v2p;
+	}
+	
+	float4 PixelMain(v2p_t input) : SV_Target0
+	{
+		float4 textureColor = diffuseTexture.Sample(diffuseSampler, input.uv);
+		float4 color = textureColor * input.color;
+		clip(color.a - 0.001f);
+		return float4(color);
+	}
+)";
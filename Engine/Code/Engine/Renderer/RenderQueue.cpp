@@ -0,0 +1,365 @@
+#include "Engine/Renderer/RenderQueue.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Sort key, high bits first: pass 4, blend 3, shader 10, texture 12, depth 2, rasterizer 3, and the
+// packet's index in the low 30 so equal keys keep the order they were added in
+constexpr int RENDER_KEY_PASS_SHIFT = 60;
+constexpr int RENDER_KEY_BLEND_SHIFT = 57;
+constexpr int RENDER_KEY_SHADER_SHIFT = 47;
+constexpr int RENDER_KEY_TEXTURE_SHIFT = 35;
+constexpr int RENDER_KEY_DEPTH_SHIFT = 33;
+constexpr int RENDER_KEY_RASTERIZER_SHIFT = 30;
+constexpr int MAX_RENDER_KEY_SHADERS = 1 << 10;
+constexpr int MAX_RENDER_KEY_TEXTURES = 1 << 12;
+constexpr unsigned long long RENDER_KEY_INDEX_MASK = (1ull << 30) - 1;
+
+static void HashValue(unsigned int& checksum, unsigned int value)
+{
+	for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+	{
+		checksum = (checksum ^ ((value >> (byteIndex * 8)) & 0xff)) * 16777619u;
+	}
+}
+
+// Shaders and textures are numbered in the order the queue first uses them, so keys and checksums
+// don't depend on where they happen to live in memory
+static int GetOrAddId(std::vector<void const*>& ids, void const* pointer)
+{
+	for (int i = 0; i < (int)ids.size(); i++)
+	{
+		if (ids[i] == pointer)
+		{
+			return i;
+		}
+	}
+	ids.push_back(pointer);
+	return (int)ids.size() - 1;
+}
+
+static bool IsSameModelConstants(RenderDrawState const& a, RenderDrawState const& b)
+{
+	return memcmp(a.m_modelMatrix.m_values, b.m_modelMatrix.m_values, sizeof(a.m_modelMatrix.m_values)) == 0
+		&& a.m_modelColor.r == b.m_modelColor.r && a.m_modelColor.g == b.m_modelColor.g && a.m_modelColor.b == b.m_modelColor.b && a.m_modelColor.a == b.m_modelColor.a;
+}
+
+static bool IsSamePacket(RenderPacket const& a, RenderPacket const& b)
+{
+	RenderDrawState const& stateA = a.m_state;
+	RenderDrawState const& stateB = b.m_state;
+	bool isSameState = stateA.m_pass == stateB.m_pass && stateA.m_shader == stateB.m_shader && stateA.m_texture == stateB.m_texture
+		&& stateA.m_blendMode == stateB.m_blendMode && stateA.m_depthMode == stateB.m_depthMode && stateA.m_rasterizerMode == stateB.m_rasterizerMode
+		&& IsSameModelConstants(stateA, stateB);
+	return isSameState && a.m_type == b.m_type && a.m_staticMesh == b.m_staticMesh && a.m_vbo == b.m_vbo && a.m_ibo == b.m_ibo
+		&& a.m_instanceVbo == b.m_instanceVbo && a.m_indexCount == b.m_indexCount && a.m_instanceCount == b.m_instanceCount
+		&& a.m_firstVertex == b.m_firstVertex && a.m_numVertexes == b.m_numVertexes && a.m_firstIndex == b.m_firstIndex && a.m_numIndexes == b.m_numIndexes;
+}
+
+static VertexType GetPacketVertexType(RenderPacket const& packet)
+{
+	return packet.m_type == RenderPacketType::STATIC_MESH ? packet.m_staticMesh->m_vertexType : VertexType::Vertex_PCU;
+}
+
+int RenderQueueStats::GetNumStateChanges() const
+{
+	return m_numShaderBinds + m_numTextureBinds + m_numBlendChanges + m_numDepthChanges + m_numRasterizerChanges + m_numModelConstantUpdates;
+}
+
+void RenderQueue::Clear()
+{
+	m_packets.clear();
+	m_vertexes.clear();
+	m_indexes.clear();
+}
+
+void RenderQueue::AddVertexArray(RenderDrawState const& state, size_t numVertexes, Vertex_PCU const* vertexArray)
+{
+	if (numVertexes == 0)
+	{
+		return;
+	}
+	RenderPacket packet;
+	packet.m_state = state;
+	packet.m_type = RenderPacketType::VERTEX_ARRAY;
+	packet.m_firstVertex = m_vertexes.size();
+	packet.m_numVertexes = numVertexes;
+	m_vertexes.insert(m_vertexes.end(), vertexArray, vertexArray + numVertexes);
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::AddIndexedVertexArray(RenderDrawState const& state, size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes, unsigned int const* indexArray)
+{
+	if (numVertexes == 0 || numIndexes == 0)
+	{
+		return;
+	}
+	RenderPacket packet;
+	packet.m_state = state;
+	packet.m_type = RenderPacketType::INDEXED_VERTEX_ARRAY;
+	packet.m_firstVertex = m_vertexes.size();
+	packet.m_numVertexes = numVertexes;
+	packet.m_firstIndex = m_indexes.size();
+	packet.m_numIndexes = numIndexes;
+	m_vertexes.insert(m_vertexes.end(), vertexArray, vertexArray + numVertexes);
+	m_indexes.insert(m_indexes.end(), indexArray, indexArray + numIndexes);
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::AddStaticMesh(RenderDrawState const& state, StaticMesh const* mesh)
+{
+	RenderPacket packet;
+	packet.m_state = state;
+	packet.m_type = RenderPacketType::STATIC_MESH;
+	packet.m_staticMesh = mesh;
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::AddIndexedBuffer(RenderDrawState const& state, VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount)
+{
+	RenderPacket packet;
+	packet.m_state = state;
+	packet.m_type = RenderPacketType::INDEXED_BUFFER;
+	packet.m_vbo = vbo;
+	packet.m_ibo = ibo;
+	packet.m_indexCount = indexCount;
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::AddIndexedInstanced(RenderDrawState const& state, VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, VertexBuffer* instanceVbo, size_t instanceCount)
+{
+	RenderPacket packet;
+	packet.m_state = state;
+	packet.m_type = RenderPacketType::INDEXED_INSTANCED;
+	packet.m_vbo = vbo;
+	packet.m_ibo = ibo;
+	packet.m_indexCount = indexCount;
+	packet.m_instanceVbo = instanceVbo;
+	packet.m_instanceCount = instanceCount;
+	m_packets.push_back(packet);
+}
+
+void RenderQueue::Append(RenderQueue const& other)
+{
+	size_t vertexOffset = m_vertexes.size();
+	size_t indexOffset = m_indexes.size();
+	m_packets.reserve(m_packets.size() + other.m_packets.size());
+	for (size_t i = 0; i < other.m_packets.size(); i++)
+	{
+		// Only packets drawing from the arenas have offsets into them, the rest keep theirs at 0
+		RenderPacket packet = other.m_packets[i];
+		if (packet.m_type == RenderPacketType::VERTEX_ARRAY || packet.m_type == RenderPacketType::INDEXED_VERTEX_ARRAY)
+		{
+			packet.m_firstVertex += vertexOffset;
+		}
+		if (packet.m_type == RenderPacketType::INDEXED_VERTEX_ARRAY)
+		{
+			packet.m_firstIndex += indexOffset;
+		}
+		m_packets.push_back(packet);
+	}
+	m_vertexes.insert(m_vertexes.end(), other.m_vertexes.begin(), other.m_vertexes.end());
+	m_indexes.insert(m_indexes.end(), other.m_indexes.begin(), other.m_indexes.end());
+}
+
+bool RenderQueue::IsSameAs(RenderQueue const& other) const
+{
+	if (m_packets.size() != other.m_packets.size() || m_vertexes.size() != other.m_vertexes.size() || m_indexes.size() != other.m_indexes.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < m_packets.size(); i++)
+	{
+		if (!IsSamePacket(m_packets[i], other.m_packets[i]))
+		{
+			return false;
+		}
+	}
+	bool isSameVertexes = m_vertexes.empty() || memcmp(m_vertexes.data(), other.m_vertexes.data(), m_vertexes.size() * sizeof(Vertex_PCU)) == 0;
+	bool isSameIndexes = m_indexes.empty() || memcmp(m_indexes.data(), other.m_indexes.data(), m_indexes.size() * sizeof(unsigned int)) == 0;
+	return isSameVertexes && isSameIndexes;
+}
+
+RenderQueueStats RenderQueue::Submit(Renderer* renderer, bool isSorted) const
+{
+	int numPackets = (int)m_packets.size();
+	std::vector<void const*> shaders;
+	std::vector<void const*> textures;
+	std::vector<int> shaderIds(numPackets);
+	std::vector<int> textureIds(numPackets);
+	for (int i = 0; i < numPackets; i++)
+	{
+		shaderIds[i] = GetOrAddId(shaders, m_packets[i].m_state.m_shader);
+		textureIds[i] = GetOrAddId(textures, m_packets[i].m_state.m_texture);
+	}
+
+	std::vector<unsigned long long> keys(numPackets);
+	for (int i = 0; i < numPackets; i++)
+	{
+		RenderDrawState const& state = m_packets[i].m_state;
+		RenderPass pass = state.m_pass == RenderPass::WORLD && state.m_blendMode != BlendMode::OPAQUE ? RenderPass::TRANSLUCENT : state.m_pass;
+		unsigned long long key = ((unsigned long long)pass << RENDER_KEY_PASS_SHIFT) | (unsigned long long)i;
+		if (pass == RenderPass::WORLD)
+		{
+			key |= (unsigned long long)state.m_blendMode << RENDER_KEY_BLEND_SHIFT;
+			key |= (unsigned long long)std::min(shaderIds[i], MAX_RENDER_KEY_SHADERS - 1) << RENDER_KEY_SHADER_SHIFT;
+			key |= (unsigned long long)std::min(textureIds[i], MAX_RENDER_KEY_TEXTURES - 1) << RENDER_KEY_TEXTURE_SHIFT;
+			key |= (unsigned long long)state.m_depthMode << RENDER_KEY_DEPTH_SHIFT;
+			key |= (unsigned long long)state.m_rasterizerMode << RENDER_KEY_RASTERIZER_SHIFT;
+		}
+		keys[i] = key;
+	}
+	if (isSorted)
+	{
+		std::sort(keys.begin(), keys.end());
+	}
+
+	RenderQueueStats stats;
+	stats.m_numPackets = numPackets;
+	unsigned int checksum = 2166136261u;
+	RenderDrawState bound;
+	VertexType boundVertexType = VertexType::Vertex_PCU;
+	bool hasBoundModelConstants = false;
+	for (int keyIndex = 0; keyIndex < numPackets; keyIndex++)
+	{
+		int packetIndex = (int)(keys[keyIndex] & RENDER_KEY_INDEX_MASK);
+		RenderPacket const& packet = m_packets[packetIndex];
+		RenderDrawState const& state = packet.m_state;
+		VertexType vertexType = GetPacketVertexType(packet);
+		bool isFirst = keyIndex == 0;
+
+		if (isFirst || state.m_shader != bound.m_shader || vertexType != boundVertexType)
+		{
+			stats.m_numShaderBinds++;
+			HashValue(checksum, 1);
+			HashValue(checksum, (unsigned int)shaderIds[packetIndex]);
+			if (renderer)
+			{
+				renderer->BindShader(state.m_shader, vertexType);
+			}
+			bound.m_shader = state.m_shader;
+			boundVertexType = vertexType;
+		}
+		if (isFirst || state.m_texture != bound.m_texture)
+		{
+			stats.m_numTextureBinds++;
+			HashValue(checksum, 2);
+			HashValue(checksum, (unsigned int)textureIds[packetIndex]);
+			if (renderer)
+			{
+				renderer->BindTexture(state.m_texture);
+			}
+			bound.m_texture = state.m_texture;
+		}
+		if (isFirst || state.m_blendMode != bound.m_blendMode)
+		{
+			stats.m_numBlendChanges++;
+			HashValue(checksum, 3);
+			HashValue(checksum, (unsigned int)state.m_blendMode);
+			if (renderer)
+			{
+				renderer->SetBlendMode(state.m_blendMode);
+			}
+			bound.m_blendMode = state.m_blendMode;
+		}
+		if (isFirst || state.m_depthMode != bound.m_depthMode)
+		{
+			stats.m_numDepthChanges++;
+			HashValue(checksum, 4);
+			HashValue(checksum, (unsigned int)state.m_depthMode);
+			if (renderer)
+			{
+				renderer->SetDepthStencilMode(state.m_depthMode);
+			}
+			bound.m_depthMode = state.m_depthMode;
+		}
+		if (isFirst || state.m_rasterizerMode != bound.m_rasterizerMode)
+		{
+			stats.m_numRasterizerChanges++;
+			HashValue(checksum, 5);
+			HashValue(checksum, (unsigned int)state.m_rasterizerMode);
+			if (renderer)
+			{
+				renderer->SetRasterizerMode(state.m_rasterizerMode);
+			}
+			bound.m_rasterizerMode = state.m_rasterizerMode;
+		}
+		if (packet.m_type != RenderPacketType::INDEXED_INSTANCED && (!hasBoundModelConstants || !IsSameModelConstants(state, bound)))
+		{
+			stats.m_numModelConstantUpdates++;
+			HashValue(checksum, 6);
+			unsigned int matrixBits[16];
+			memcpy(matrixBits, state.m_modelMatrix.m_values, sizeof(matrixBits));
+			for (int i = 0; i < 16; i++)
+			{
+				HashValue(checksum, matrixBits[i]);
+			}
+			HashValue(checksum, ((unsigned int)state.m_modelColor.r << 24) | ((unsigned int)state.m_modelColor.g << 16) | ((unsigned int)state.m_modelColor.b << 8) | (unsigned int)state.m_modelColor.a);
+			if (renderer)
+			{
+				renderer->SetModelConstants(state.m_modelMatrix, state.m_modelColor);
+			}
+			bound.m_modelMatrix = state.m_modelMatrix;
+			bound.m_modelColor = state.m_modelColor;
+			hasBoundModelConstants = true;
+		}
+
+		stats.m_numDraws++;
+		HashValue(checksum, 7 + (unsigned int)packet.m_type);
+		switch (packet.m_type)
+		{
+		case RenderPacketType::VERTEX_ARRAY:
+			HashValue(checksum, (unsigned int)packet.m_numVertexes);
+			stats.m_numImmediateBytes += packet.m_numVertexes * sizeof(Vertex_PCU);
+			if (renderer)
+			{
+				renderer->DrawVertexArray(packet.m_numVertexes, &m_vertexes[packet.m_firstVertex]);
+			}
+			break;
+		case RenderPacketType::INDEXED_VERTEX_ARRAY:
+			HashValue(checksum, (unsigned int)packet.m_numVertexes);
+			HashValue(checksum, (unsigned int)packet.m_numIndexes);
+			stats.m_numImmediateBytes += packet.m_numVertexes * sizeof(Vertex_PCU) + packet.m_numIndexes * sizeof(unsigned int);
+			if (renderer)
+			{
+				renderer->DrawIndexedVertexArray(packet.m_numVertexes, &m_vertexes[packet.m_firstVertex], packet.m_numIndexes, &m_indexes[packet.m_firstIndex]);
+			}
+			break;
+		case RenderPacketType::STATIC_MESH:
+			HashValue(checksum, (unsigned int)packet.m_staticMesh->m_numVertexes);
+			HashValue(checksum, (unsigned int)packet.m_staticMesh->m_numIndexes);
+			if (renderer)
+			{
+				renderer->DrawStaticMesh(packet.m_staticMesh);
+			}
+			break;
+		case RenderPacketType::INDEXED_BUFFER:
+			HashValue(checksum, (unsigned int)packet.m_indexCount);
+			if (renderer)
+			{
+				renderer->DrawIndexedBuffer(packet.m_vbo, packet.m_ibo, packet.m_indexCount);
+			}
+			break;
+		case RenderPacketType::INDEXED_INSTANCED:
+			HashValue(checksum, (unsigned int)packet.m_indexCount);
+			HashValue(checksum, (unsigned int)packet.m_instanceCount);
+			stats.m_numInstancesDrawn += (int)packet.m_instanceCount;
+			if (renderer)
+			{
+				renderer->DrawIndexedInstanced(packet.m_vbo, packet.m_ibo, packet.m_indexCount, packet.m_instanceVbo, packet.m_instanceCount);
+			}
+			break;
+		}
+	}
+	stats.m_checksum = checksum;
+	return stats;
+}
+
+int RenderQueue::GetNumPackets() const
+{
+	return (int)m_packets.size();
+}
+
+std::vector<RenderPacket> const& RenderQueue::GetPackets() const
+{
+	return m_packets;
+}
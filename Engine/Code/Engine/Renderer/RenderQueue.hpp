@@ -0,0 +1,110 @@
+#pragma once
+#include "Engine/Renderer/Renderer.hpp"
+#include "Engine/Math/Mat44.hpp"
+#include <vector>
+
+// Passes submit in this order. Packets in an ordered pass keep the order they were added in, packets
+// in WORLD are grouped by state instead. Grouping would reorder blended draws, so a WORLD packet that
+// isn't OPAQUE goes out with TRANSLUCENT, in the order it was added
+enum class RenderPass
+{
+	WORLD,
+	TRANSLUCENT,
+	OVERLAY,
+	COUNT
+};
+
+// Everything a packet needs bound when it draws. A null shader or texture is the renderer's default.
+// Draws are opaque unless they ask to blend, blended ones belong in TRANSLUCENT
+struct RenderDrawState
+{
+	RenderPass m_pass = RenderPass::WORLD;
+	Shader* m_shader = nullptr;
+	Texture const* m_texture = nullptr;
+	BlendMode m_blendMode = BlendMode::OPAQUE;
+	DepthMode m_depthMode = DepthMode::ENABLED;
+	RasterizerMode m_rasterizerMode = RasterizerMode::SOLID_CULL_BACK;
+	Mat44 m_modelMatrix;
+	Rgba8 m_modelColor = Rgba8::COLOR_WHITE;
+};
+
+enum class RenderPacketType
+{
+	VERTEX_ARRAY,
+	INDEXED_VERTEX_ARRAY,
+	STATIC_MESH,
+	INDEXED_BUFFER,
+	INDEXED_INSTANCED
+};
+
+// One draw. Vertex arrays are copied into the queue, buffers and meshes are referenced and have to
+// outlive the submit
+struct RenderPacket
+{
+	RenderDrawState m_state;
+	RenderPacketType m_type = RenderPacketType::VERTEX_ARRAY;
+	StaticMesh const* m_staticMesh = nullptr;
+	VertexBuffer* m_vbo = nullptr;
+	IndexBuffer* m_ibo = nullptr;
+	VertexBuffer* m_instanceVbo = nullptr;
+	size_t m_indexCount = 0;
+	size_t m_instanceCount = 0;
+	size_t m_firstVertex = 0;
+	size_t m_numVertexes = 0;
+	size_t m_firstIndex = 0;
+	size_t m_numIndexes = 0;
+};
+
+// What a submit did, or would have done when it only records. A state change is only counted, and
+// only issued, when it differs from what the previous packet left bound
+struct RenderQueueStats
+{
+	int m_numPackets = 0;
+	int m_numDraws = 0;
+	int m_numInstancesDrawn = 0;
+	int m_numShaderBinds = 0;
+	int m_numTextureBinds = 0;
+	int m_numBlendChanges = 0;
+	int m_numDepthChanges = 0;
+	int m_numRasterizerChanges = 0;
+	int m_numModelConstantUpdates = 0;
+	size_t m_numImmediateBytes = 0;
+	unsigned int m_checksum = 0; // FNV-1a over every state change and draw in the order they were issued
+
+	int GetNumStateChanges() const;
+};
+
+// Draws recorded over a frame and submitted at once, sorted by a 64-bit key per packet so that draws
+// sharing a pass, blend mode, shader, texture and depth mode go out together
+class RenderQueue
+{
+public:
+	void Clear();
+
+	void AddVertexArray(RenderDrawState const& state, size_t numVertexes, Vertex_PCU const* vertexArray);
+	void AddIndexedVertexArray(RenderDrawState const& state, size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes, unsigned int const* indexArray);
+	void AddStaticMesh(RenderDrawState const& state, StaticMesh const* mesh);
+	void AddIndexedBuffer(RenderDrawState const& state, VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount);
+	// Instanced draws use the renderer's instanced shader and take their placement from the instances,
+	// so the state's shader and model constants don't apply
+	void AddIndexedInstanced(RenderDrawState const& state, VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, VertexBuffer* instanceVbo, size_t instanceCount);
+
+	// Queues can be recorded on different threads and merged afterwards. Appending puts the other queue's
+	// packets after this one's, in the order they were added, so merging per-thread queues in a fixed order
+	// gives the same queue as recording everything on one thread
+	void Append(RenderQueue const& other);
+	// Same packets with the same states, in the same order, drawing the same vertexes and indexes
+	bool IsSameAs(RenderQueue const& other) const;
+
+	// With a null renderer nothing is issued and the stats are all that comes out, which is what a
+	// headless run can check. Unsorted, the packets go out in the order they were added
+	RenderQueueStats Submit(Renderer* renderer, bool isSorted = true) const;
+
+	int GetNumPackets() const;
+	std::vector<RenderPacket> const& GetPackets() const;
+
+private:
+	std::vector<RenderPacket> m_packets;
+	std::vector<Vertex_PCU> m_vertexes;
+	std::vector<unsigned int> m_indexes;
+};
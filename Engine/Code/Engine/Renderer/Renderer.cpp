@@ -75,11 +75,27 @@ void Renderer::Startup()
 	backBuffer->Release();
 
 	m_defaultShader = CreateShader("Default", g_defaultShaderSource);
+	m_defaultInstancedShader = CreateShader("DefaultInstanced", g_defaultInstancedShaderSource, VertexType::Vertex_PCU, true);
 	BindShader(m_currentShader);
 
 	m_immediateVBO = CreateVertexBuffer(sizeof(Vertex_PCU));
 	m_immediateIBO = CreateIndexBuffer(sizeof(unsigned int));
 
+	m_transientVBO = CreateVertexBuffer(m_config.m_transientVertexBytes);
+	m_transientIBO = CreateIndexBuffer(m_config.m_transientIndexBytes);
+	m_transientVertexRing.Reset(m_config.m_transientVertexBytes);
+	m_transientIndexRing.Reset(m_config.m_transientIndexBytes);
+	D3D11_QUERY_DESC fenceDesc = {};
+	fenceDesc.Query = D3D11_QUERY_EVENT;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		HRESULT fenceResult = m_device->CreateQuery(&fenceDesc, &m_frameFences[i]);
+		if (!SUCCEEDED(fenceResult))
+		{
+			ERROR_AND_DIE("Couldn't create frame fence query");
+		}
+	}
+
 	m_cameraCBO = CreateConstantBuffer(sizeof(CameraConstants));
 	m_modelCBO = CreateConstantBuffer(sizeof(ModelConstants));
 	m_lightCBO = CreateConstantBuffer(sizeof(LightConstants));
@@ -344,6 +360,9 @@ void Renderer::Startup()
 }
 void Renderer::BeginFrame()
 {
+	m_frameStats = RendererFrameStats();
+	RetireCompletedFrames();
+
 	if (m_config.m_renderEmissive)
 	{
 		ID3D11RenderTargetView* RTVs[2] = {
@@ -364,6 +383,13 @@ void Renderer::BeginFrame()
 }
 void Renderer::EndFrame()
 {
+	// A frame that reuses a fence slot before the old frame was seen completing just delays retiring it,
+	// the GPU finishes frames in order
+	m_numFramesSubmitted++;
+	m_deviceContext->End(m_frameFences[m_numFramesSubmitted % MAX_FRAMES_IN_FLIGHT]);
+	m_transientVertexRing.EndFrame(m_numFramesSubmitted);
+	m_transientIndexRing.EndFrame(m_numFramesSubmitted);
+
 	//Present
 	HRESULT hr;
 	hr = m_swapChain->Present(0, 0);
@@ -383,6 +409,17 @@ void Renderer::Shutdown()
 	delete m_immediateVBO;
 	m_immediateVBO = nullptr;
 
+	delete m_transientVBO;
+	m_transientVBO = nullptr;
+
+	delete m_transientIBO;
+	m_transientIBO = nullptr;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		DX_SAFE_RELEASE(m_frameFences[i]);
+	}
+
 	delete m_cameraCBO;
 	m_cameraCBO = nullptr;
 
@@ -526,32 +563,163 @@ void Renderer::DrawVertexBuffer(VertexBuffer* vbo, size_t vertexCount, int verte
 	BindVertexBuffer(vbo, type);
 	SetStatesIfChanged();
 	m_deviceContext->Draw((UINT)vertexCount, vertexOffset);
+	m_frameStats.m_numDrawCalls++;
 }
-void Renderer::DrawIndexedBuffer(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, int indexOffset, VertexType type)
+void Renderer::DrawIndexedBuffer(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, int indexOffset, VertexType type, int baseVertex)
 {
 	BindVertexBuffer(vbo, type);
 	BindIndexBuffer(ibo);
 	SetStatesIfChanged();
-	m_deviceContext->DrawIndexed((UINT)indexCount, indexOffset, 0);
+	m_deviceContext->DrawIndexed((UINT)indexCount, indexOffset, baseVertex);
+	m_frameStats.m_numDrawCalls++;
 }
 
-void Renderer::DrawIndexedBuffer(std::vector<Vertex_PCUTBN> vertexes, std::vector<unsigned int> indexes, int indexOffset)
+void Renderer::DrawIndexedInstanced(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, VertexBuffer* instanceVbo, size_t instanceCount)
 {
-	CopyCPUToGPU(vertexes.data(), (unsigned int)vertexes.size() * sizeof(Vertex_PCUTBN), m_immediateVBO);
-	CopyCPUToGPU(indexes.data(), (unsigned int)indexes.size() * sizeof(unsigned int), m_immediateIBO);
-	BindVertexBuffer(m_immediateVBO, VertexType::Vertex_PCUTBN);
-	BindIndexBuffer(m_immediateIBO);
+	Shader* previousShader = m_currentShader;
+	BindShader(m_defaultInstancedShader);
+
+	BindVertexBuffer(vbo);
+	UINT instanceStride = sizeof(ModelInstance);
+	UINT instanceOffset = 0;
+	m_deviceContext->IASetVertexBuffers(k_instanceBufferSlot, 1, &instanceVbo->m_buffer, &instanceStride, &instanceOffset);
+	BindIndexBuffer(ibo);
 	SetStatesIfChanged();
-	m_deviceContext->DrawIndexed((int)indexes.size(), indexOffset, 0);
+	m_deviceContext->DrawIndexedInstanced((UINT)indexCount, (UINT)instanceCount, 0, 0, 0);
+	m_frameStats.m_numDrawCalls++;
+	m_frameStats.m_numInstancesDrawn += (int)instanceCount;
+
+	BindShader(previousShader);
 }
-void Renderer::DrawIndexedBuffer(std::vector<Vertex_PCU> vertexes, std::vector<unsigned int> indexes, int indexOffset)
+
+RendererFrameStats const& Renderer::GetFrameStats() const
 {
-	CopyCPUToGPU(vertexes.data(), (unsigned int)vertexes.size() * sizeof(Vertex_PCU), m_immediateVBO);
-	CopyCPUToGPU(indexes.data(), (unsigned int)indexes.size() * sizeof(unsigned int), m_immediateIBO);
-	BindVertexBuffer(m_immediateVBO);
-	BindIndexBuffer(m_immediateIBO);
-	SetStatesIfChanged();
-	m_deviceContext->DrawIndexed((int)indexes.size(), indexOffset, 0);
+	return m_frameStats;
+}
+
+void Renderer::DrawIndexedBuffer(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, int indexOffset)
+{
+	DrawIndexedVertexArray(vertexes.size(), vertexes.data(), indexes.size(), indexes.data(), indexOffset);
+}
+void Renderer::DrawIndexedBuffer(std::vector<Vertex_PCU> const& vertexes, std::vector<unsigned int> const& indexes, int indexOffset)
+{
+	DrawIndexedVertexArray(vertexes.size(), vertexes.data(), indexes.size(), indexes.data(), indexOffset);
+}
+
+void Renderer::DrawIndexedVertexArray(size_t numVertexes, Vertex_PCUTBN const* vertexArray, size_t numIndexes, unsigned int const* indexArray, int indexOffset)
+{
+	unsigned int vertexOffset = 0;
+	unsigned int indexByteOffset = 0;
+	if (CopyCPUToTransientRing(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCUTBN)), sizeof(Vertex_PCUTBN), m_transientVertexRing, m_transientVBO->m_buffer, vertexOffset)
+		&& CopyCPUToTransientRing(indexArray, (unsigned int)(numIndexes * sizeof(unsigned int)), sizeof(unsigned int), m_transientIndexRing, m_transientIBO->m_buffer, indexByteOffset))
+	{
+		DrawIndexedBuffer(m_transientVBO, m_transientIBO, numIndexes, indexOffset + (int)(indexByteOffset / sizeof(unsigned int)), VertexType::Vertex_PCUTBN, (int)(vertexOffset / sizeof(Vertex_PCUTBN)));
+		return;
+	}
+	CopyCPUToGPU(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCUTBN)), m_immediateVBO);
+	CopyCPUToGPU(indexArray, (unsigned int)(numIndexes * sizeof(unsigned int)), m_immediateIBO);
+	DrawIndexedBuffer(m_immediateVBO, m_immediateIBO, numIndexes, indexOffset, VertexType::Vertex_PCUTBN);
+}
+void Renderer::DrawIndexedVertexArray(size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes, unsigned int const* indexArray, int indexOffset)
+{
+	unsigned int vertexOffset = 0;
+	unsigned int indexByteOffset = 0;
+	if (CopyCPUToTransientRing(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCU)), sizeof(Vertex_PCU), m_transientVertexRing, m_transientVBO->m_buffer, vertexOffset)
+		&& CopyCPUToTransientRing(indexArray, (unsigned int)(numIndexes * sizeof(unsigned int)), sizeof(unsigned int), m_transientIndexRing, m_transientIBO->m_buffer, indexByteOffset))
+	{
+		DrawIndexedBuffer(m_transientVBO, m_transientIBO, numIndexes, indexOffset + (int)(indexByteOffset / sizeof(unsigned int)), VertexType::Vertex_PCU, (int)(vertexOffset / sizeof(Vertex_PCU)));
+		return;
+	}
+	CopyCPUToGPU(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCU)), m_immediateVBO);
+	CopyCPUToGPU(indexArray, (unsigned int)(numIndexes * sizeof(unsigned int)), m_immediateIBO);
+	DrawIndexedBuffer(m_immediateVBO, m_immediateIBO, numIndexes, indexOffset);
+}
+
+StaticMesh::~StaticMesh()
+{
+	delete m_vbo;
+	m_vbo = nullptr;
+	delete m_ibo;
+	m_ibo = nullptr;
+}
+
+StaticMesh* Renderer::CreateStaticMesh(size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes, unsigned int const* indexArray)
+{
+	return CreateStaticMesh(vertexArray, numVertexes, sizeof(Vertex_PCU), VertexType::Vertex_PCU, numIndexes, indexArray);
+}
+StaticMesh* Renderer::CreateStaticMesh(size_t numVertexes, Vertex_PCUTBN const* vertexArray, size_t numIndexes, unsigned int const* indexArray)
+{
+	return CreateStaticMesh(vertexArray, numVertexes, sizeof(Vertex_PCUTBN), VertexType::Vertex_PCUTBN, numIndexes, indexArray);
+}
+
+StaticMesh* Renderer::CreateStaticMesh(void const* vertexData, size_t numVertexes, unsigned int vertexStride, VertexType type, size_t numIndexes, unsigned int const* indexArray)
+{
+	if (numVertexes == 0)
+	{
+		ERROR_AND_DIE(Stringf("Could not create an empty static mesh."));
+	}
+
+	// Immutable buffers get their contents at creation and can't be mapped, which is the point:
+	// nothing about this mesh goes through CopyCPUToGPU again
+	StaticMesh* mesh = new StaticMesh();
+	mesh->m_numVertexes = numVertexes;
+	mesh->m_numIndexes = numIndexes;
+	mesh->m_vertexType = type;
+
+	unsigned int vertexBytes = (unsigned int)(numVertexes * vertexStride);
+	mesh->m_vbo = new VertexBuffer(vertexBytes);
+
+	D3D11_BUFFER_DESC bufferDesc = { 0 };
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.ByteWidth = (UINT)vertexBytes;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialData = { 0 };
+	initialData.pSysMem = vertexData;
+
+	HRESULT hr = m_device->CreateBuffer(&bufferDesc, &initialData, &mesh->m_vbo->m_buffer);
+	if (!SUCCEEDED(hr))
+	{
+		ERROR_AND_DIE(Stringf("Could not create static vertex buffer."));
+	}
+	m_frameStats.m_numBuffersCreated++;
+	m_frameStats.m_numBufferUploads++;
+	m_frameStats.m_numBytesUploaded += vertexBytes;
+	mesh->m_numBytes += vertexBytes;
+
+	if (numIndexes > 0)
+	{
+		unsigned int indexBytes = (unsigned int)(numIndexes * sizeof(unsigned int));
+		mesh->m_ibo = new IndexBuffer(indexBytes);
+
+		bufferDesc.ByteWidth = (UINT)indexBytes;
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		initialData.pSysMem = indexArray;
+
+		hr = m_device->CreateBuffer(&bufferDesc, &initialData, &mesh->m_ibo->m_buffer);
+		if (!SUCCEEDED(hr))
+		{
+			ERROR_AND_DIE(Stringf("Could not create static index buffer."));
+		}
+		m_frameStats.m_numBuffersCreated++;
+		m_frameStats.m_numBufferUploads++;
+		m_frameStats.m_numBytesUploaded += indexBytes;
+		mesh->m_numBytes += indexBytes;
+	}
+
+	return mesh;
+}
+
+void Renderer::DrawStaticMesh(StaticMesh const* mesh)
+{
+	if (mesh->m_ibo)
+	{
+		DrawIndexedBuffer(mesh->m_vbo, mesh->m_ibo, mesh->m_numIndexes, 0, mesh->m_vertexType);
+	}
+	else
+	{
+		DrawVertexBuffer(mesh->m_vbo, mesh->m_numVertexes, 0, mesh->m_vertexType);
+	}
+	m_frameStats.m_numStaticMeshDraws++;
 }
 
 void Renderer::RenderEmissive()
@@ -697,12 +865,24 @@ BlurConstants Renderer::SetBlurUpConstants()
 
 void Renderer::DrawVertexArray(size_t numVertexes, Vertex_PCU const* vertexArray)
 {
+	unsigned int vertexOffset = 0;
+	if (CopyCPUToTransientRing(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCU)), sizeof(Vertex_PCU), m_transientVertexRing, m_transientVBO->m_buffer, vertexOffset))
+	{
+		DrawVertexBuffer(m_transientVBO, numVertexes, (int)(vertexOffset / sizeof(Vertex_PCU)));
+		return;
+	}
 	CopyCPUToGPU(vertexArray, (unsigned int)numVertexes * sizeof(Vertex_PCU), m_immediateVBO);
 	DrawVertexBuffer(m_immediateVBO, numVertexes, 0);
 }
 
 void Renderer::DrawVertexArray(size_t numVertexes, Vertex_PCUTBN const* vertexArray)
 {
+	unsigned int vertexOffset = 0;
+	if (CopyCPUToTransientRing(vertexArray, (unsigned int)(numVertexes * sizeof(Vertex_PCUTBN)), sizeof(Vertex_PCUTBN), m_transientVertexRing, m_transientVBO->m_buffer, vertexOffset))
+	{
+		DrawVertexBuffer(m_transientVBO, numVertexes, (int)(vertexOffset / sizeof(Vertex_PCUTBN)), VertexType::Vertex_PCUTBN);
+		return;
+	}
 	CopyCPUToGPU(vertexArray, (unsigned int)numVertexes * sizeof(Vertex_PCUTBN), m_immediateVBO);
 	DrawVertexBuffer(m_immediateVBO, numVertexes, 0, VertexType::Vertex_PCUTBN);
 }
@@ -805,7 +985,7 @@ Texture* Renderer::CreateRenderTexture(const IntVec2& dimensions, const char* na
 	return newTexture;
 }
 
-Shader* Renderer::CreateShader(char const* shaderName, char const* shaderSource, VertexType type)
+Shader* Renderer::CreateShader(char const* shaderName, char const* shaderSource, VertexType type, bool isInstanced)
 {
 	HRESULT hr;
 	ShaderConfig newConfig;
@@ -845,7 +1025,32 @@ Shader* Renderer::CreateShader(char const* shaderName, char const* shaderSource,
 		ERROR_AND_DIE(Stringf("Could not create pixel shader."));
 	}
 
-	if (type == VertexType::Vertex_PCU)
+	if (type == VertexType::Vertex_PCU && isInstanced)
+	{
+		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] = {
+			{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0 , 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0 , D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0 , D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"MODEL_I", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, k_instanceBufferSlot, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"MODEL_J", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, k_instanceBufferSlot, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"MODEL_K", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, k_instanceBufferSlot, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"MODEL_T", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, k_instanceBufferSlot, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"MODEL_COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, k_instanceBufferSlot, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		};
+
+		UINT numElements = ARRAYSIZE(inputElementDesc);
+		hr = m_device->CreateInputLayout(
+			inputElementDesc, numElements,
+			vertexShaderByteCode.data(),
+			vertexShaderByteCode.size(),
+			&newShader->m_inputLayoutForVertex_PCU
+		);
+		if (!SUCCEEDED(hr))
+		{
+			ERROR_AND_DIE(Stringf("Could not create instanced vertex pcu layout."));
+		}
+	}
+	else if (type == VertexType::Vertex_PCU)
 	{
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] = {
 			{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0 , 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
@@ -988,6 +1193,7 @@ VertexBuffer* Renderer::CreateVertexBuffer(unsigned int size)
 	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
 	HRESULT hr = m_device->CreateBuffer(&bufferDesc, nullptr, &vbo->m_buffer);
+	m_frameStats.m_numBuffersCreated++;
 
 	if (!SUCCEEDED(hr))
 	{
@@ -1008,6 +1214,7 @@ IndexBuffer* Renderer::CreateIndexBuffer(size_t size)
 	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
 	HRESULT hr = m_device->CreateBuffer(&bufferDesc, nullptr, &ibo->m_buffer);
+	m_frameStats.m_numBuffersCreated++;
 
 	if (!SUCCEEDED(hr))
 	{
@@ -1030,6 +1237,8 @@ void Renderer::CopyCPUToGPU(const void* data, unsigned int size, VertexBuffer*&
 	m_deviceContext->Map(vbo->m_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
 	memcpy(resource.pData, data, size);
 	m_deviceContext->Unmap(vbo->m_buffer, 0);
+	m_frameStats.m_numBufferUploads++;
+	m_frameStats.m_numBytesUploaded += size;
 }
 
 void Renderer::CopyCPUToGPU(const void* data, unsigned int size, IndexBuffer*& ibo)
@@ -1045,6 +1254,8 @@ void Renderer::CopyCPUToGPU(const void* data, unsigned int size, IndexBuffer*& i
 	m_deviceContext->Map(ibo->m_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
 	memcpy(resource.pData, data, size);
 	m_deviceContext->Unmap(ibo->m_buffer, 0);
+	m_frameStats.m_numBufferUploads++;
+	m_frameStats.m_numBytesUploaded += size;
 }
 
 void Renderer::BindVertexBuffer(VertexBuffer* vbo, VertexType type)
@@ -1093,6 +1304,40 @@ ConstantBuffer* Renderer::CreateConstantBuffer(const size_t size)
 	return cbo;
 }
 
+bool Renderer::CopyCPUToTransientRing(void const* data, unsigned int size, unsigned int alignment, RingBufferAllocator& ring, ID3D11Buffer* buffer, unsigned int& out_offset)
+{
+	RingAllocation allocation;
+	if (!ring.Allocate(size, alignment, allocation))
+	{
+		return false;
+	}
+	D3D11_MAPPED_SUBRESOURCE resource;
+	m_deviceContext->Map(buffer, 0, allocation.m_isDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &resource);
+	memcpy((unsigned char*)resource.pData + allocation.m_offset, data, size);
+	m_deviceContext->Unmap(buffer, 0);
+	m_frameStats.m_numBufferUploads++;
+	m_frameStats.m_numBytesUploaded += size;
+	m_frameStats.m_numTransientDiscards += allocation.m_isDiscard ? 1 : 0;
+	out_offset = allocation.m_offset;
+	return true;
+}
+
+void Renderer::RetireCompletedFrames()
+{
+	// Never waits: a fence that isn't done yet just leaves its frame, and every later one, in flight
+	while (m_numFramesCompleted < m_numFramesSubmitted)
+	{
+		unsigned long long fenceValue = m_numFramesCompleted + 1;
+		if (m_deviceContext->GetData(m_frameFences[fenceValue % MAX_FRAMES_IN_FLIGHT], nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			break;
+		}
+		m_numFramesCompleted = fenceValue;
+	}
+	m_transientVertexRing.RetireFrames(m_numFramesCompleted);
+	m_transientIndexRing.RetireFrames(m_numFramesCompleted);
+}
+
 void Renderer::CopyCPUToGPU(const void* data, unsigned int size, ConstantBuffer* cbo)
 {
 	//Copy vertices
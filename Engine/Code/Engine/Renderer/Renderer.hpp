@@ -21,6 +21,7 @@
 #include "Engine/Renderer/ConstantBuffer.hpp"
 #include "Engine/Renderer/VertexBuffer.hpp"
 #include "Engine/Renderer/IndexBuffer.hpp"
+#include "Engine/Renderer/RingBufferAllocator.hpp"
 #include "Engine/Core/EngineBuildPreferences.hpp"
 #include "Engine/Window/Window.hpp"
 #include "Engine/Core/Image.hpp"
@@ -42,6 +43,8 @@ static const int k_cameraConstantsSlot = 2;
 static const int k_modelConstantsSlot = 3;
 static const int k_blurConstantsSlot = 5;
 
+static const int k_instanceBufferSlot = 1;
+
 static const int g_textureNum = 4;
 
 enum class BlendMode
@@ -79,6 +82,10 @@ struct RendererConfig
 {
 	Window* m_window = nullptr;
 	bool m_renderEmissive = false;
+	// Immediate draws are written into rings of these sizes. A draw bigger than its ring falls back to
+	// the single immediate buffer
+	unsigned int m_transientVertexBytes = 8 * 1024 * 1024;
+	unsigned int m_transientIndexBytes = 2 * 1024 * 1024;
 };
 
 struct CameraConstants
@@ -93,6 +100,41 @@ struct ModelConstants
 	float ModelColor[4];
 };
 
+// One entry of an instance buffer for DrawIndexedInstanced
+struct ModelInstance
+{
+	Mat44 ModelMatrix;
+	Rgba8 ModelColor = Rgba8::COLOR_WHITE;
+};
+
+// Geometry that never changes, uploaded once by CreateStaticMesh into buffers only the GPU reads and drawn
+// by DrawStaticMesh without sending anything again. Deleting the mesh releases its buffers
+struct StaticMesh
+{
+	StaticMesh() = default;
+	StaticMesh(StaticMesh const& copy) = delete;
+	~StaticMesh();
+
+	VertexBuffer* m_vbo = nullptr;
+	IndexBuffer* m_ibo = nullptr; // null for a mesh drawn straight from its vertexes
+	size_t m_numVertexes = 0;
+	size_t m_numIndexes = 0;
+	VertexType m_vertexType = VertexType::Vertex_PCU;
+	size_t m_numBytes = 0;
+};
+
+// What the renderer was asked to do since the last BeginFrame
+struct RendererFrameStats
+{
+	int m_numDrawCalls = 0;
+	int m_numStaticMeshDraws = 0;
+	int m_numInstancesDrawn = 0;
+	int m_numBuffersCreated = 0;
+	int m_numBufferUploads = 0;
+	size_t m_numBytesUploaded = 0;
+	int m_numTransientDiscards = 0;
+};
+
 struct LightingDebug
 {
 	int RenderAmbient = 1;
@@ -174,9 +216,22 @@ public:
 	void DrawVertexArray(size_t numVertexes, Vertex_PCU const* vertexArray);
 	void DrawVertexArray(size_t numVertexes, Vertex_PCUTBN const* vertexArray);
 	void DrawVertexBuffer(VertexBuffer* vbo, size_t vertexCount, int vertexOffset = 0, VertexType type = VertexType::Vertex_PCU);
-	void DrawIndexedBuffer(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, int indexOffset = 0, VertexType type = VertexType::Vertex_PCU);
-	void DrawIndexedBuffer(std::vector<Vertex_PCUTBN> vertexes, std::vector<unsigned int> indexes, int indexOffset = 0);
-	void DrawIndexedBuffer(std::vector<Vertex_PCU> vertexes, std::vector<unsigned int> indexes, int indexOffset = 0);
+	void DrawIndexedBuffer(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, int indexOffset = 0, VertexType type = VertexType::Vertex_PCU, int baseVertex = 0);
+	void DrawIndexedBuffer(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, int indexOffset = 0);
+	void DrawIndexedBuffer(std::vector<Vertex_PCU> const& vertexes, std::vector<unsigned int> const& indexes, int indexOffset = 0);
+	// Immediate indexed draws straight from the caller's arrays. They are copied into the transient ring,
+	// or into the immediate buffers when the ring can't fit them this frame
+	void DrawIndexedVertexArray(size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes, unsigned int const* indexArray, int indexOffset = 0);
+	void DrawIndexedVertexArray(size_t numVertexes, Vertex_PCUTBN const* vertexArray, size_t numIndexes, unsigned int const* indexArray, int indexOffset = 0);
+	// numIndexes 0 makes a mesh drawn straight from its vertexes. The caller owns the mesh and deletes it
+	StaticMesh* CreateStaticMesh(size_t numVertexes, Vertex_PCU const* vertexArray, size_t numIndexes = 0, unsigned int const* indexArray = nullptr);
+	StaticMesh* CreateStaticMesh(size_t numVertexes, Vertex_PCUTBN const* vertexArray, size_t numIndexes = 0, unsigned int const* indexArray = nullptr);
+	void DrawStaticMesh(StaticMesh const* mesh);
+	// Draws instanceCount copies of a Vertex_PCU mesh, each placed and tinted by a ModelInstance from instanceVbo.
+	// Uses the built-in instanced shader for the call and rebinds the current shader afterwards.
+	void DrawIndexedInstanced(VertexBuffer* vbo, IndexBuffer* ibo, size_t indexCount, VertexBuffer* instanceVbo, size_t instanceCount);
+
+	RendererFrameStats const& GetFrameStats() const;
 
 	void RenderEmissive();
 	BlurConstants SetBlurDownConstants();
@@ -219,9 +274,19 @@ protected:
 	std::vector<Shader*>			m_loadedShader;
 	Shader* m_currentShader = nullptr;
 	Shader* m_defaultShader = nullptr;
+	Shader* m_defaultInstancedShader = nullptr;
 	VertexBuffer* m_immediateVBO = nullptr;
 	VertexBuffer* m_fullScreenQuadVBO = nullptr;
 	IndexBuffer* m_immediateIBO = nullptr;
+	// Immediate draws are sub-allocated from these, mapped no-overwrite and discarded only when the ring
+	// runs into a frame the GPU may still be reading. One event query per frame in flight says when it's done
+	VertexBuffer* m_transientVBO = nullptr;
+	IndexBuffer* m_transientIBO = nullptr;
+	RingBufferAllocator m_transientVertexRing;
+	RingBufferAllocator m_transientIndexRing;
+	ID3D11Query* m_frameFences[MAX_FRAMES_IN_FLIGHT] = {};
+	unsigned long long m_numFramesSubmitted = 0;
+	unsigned long long m_numFramesCompleted = 0;
 	ConstantBuffer* m_cameraCBO = nullptr;
 	ConstantBuffer* m_modelCBO = nullptr;
 	ConstantBuffer* m_lightCBO = nullptr;
@@ -245,6 +310,8 @@ protected:
 	std::vector<const Texture*> m_blurUpTextures;
 	D3D11_VIEWPORT m_originalViewport;
 
+	RendererFrameStats m_frameStats;
+
 	ID3D11BlendState* m_blendState = nullptr;
 	BlendMode m_desiredBlendMode = BlendMode::ALPHA;
 	ID3D11BlendState* m_blendStates[(int)(BlendMode::COUNT)] = {};
@@ -267,7 +334,12 @@ protected:
 	void* m_dxgiDebug = nullptr;
 
 protected:
-	Shader* CreateShader(char const* shaderName, char const* shaderSource, VertexType type = VertexType::Vertex_PCU);
+	// An instanced shader's Vertex_PCU layout also reads a ModelInstance per instance from k_instanceBufferSlot
+	Shader* CreateShader(char const* shaderName, char const* shaderSource, VertexType type = VertexType::Vertex_PCU, bool isInstanced = false);
+	StaticMesh* CreateStaticMesh(void const* vertexData, size_t numVertexes, unsigned int vertexStride, VertexType type, size_t numIndexes, unsigned int const* indexArray);
+	// False when the data doesn't fit the ring at all, the caller then goes through the immediate buffers
+	bool CopyCPUToTransientRing(void const* data, unsigned int size, unsigned int alignment, RingBufferAllocator& ring, ID3D11Buffer* buffer, unsigned int& out_offset);
+	void RetireCompletedFrames();
 	bool CompileShaderToByteCode(std::vector<unsigned char>& outByteCode, char const* name, char const* source, char const* entryPoint, char const* target);
 	void SetStatesIfChanged();
 
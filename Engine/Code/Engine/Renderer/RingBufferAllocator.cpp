@@ -0,0 +1,272 @@
+#include "Engine/Renderer/RingBufferAllocator.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Math/RandomNumberGenerator.hpp"
+
+RingBufferAllocator::RingBufferAllocator(unsigned int capacity)
+	:m_capacity(capacity)
+{
+}
+
+void RingBufferAllocator::Reset(unsigned int capacity)
+{
+	m_capacity = capacity;
+	m_head = 0;
+	m_framesInFlight.clear();
+	m_currentFrameBegin = 0;
+	m_hasCurrentFrameAllocation = false;
+}
+
+void RingBufferAllocator::EndFrame(unsigned long long fenceValue)
+{
+	if (!m_hasCurrentFrameAllocation)
+	{
+		return;
+	}
+	FrameRegion region;
+	region.m_begin = m_currentFrameBegin;
+	region.m_fenceValue = fenceValue;
+	m_framesInFlight.push_back(region);
+	m_hasCurrentFrameAllocation = false;
+}
+
+void RingBufferAllocator::RetireFrames(unsigned long long completedFenceValue)
+{
+	while (!m_framesInFlight.empty() && m_framesInFlight.front().m_fenceValue <= completedFenceValue)
+	{
+		m_framesInFlight.pop_front();
+	}
+}
+
+bool RingBufferAllocator::Allocate(unsigned int size, unsigned int alignment, RingAllocation& out_allocation)
+{
+	if (size == 0 || size > m_capacity)
+	{
+		m_stats.m_numFailedAllocations++;
+		return false;
+	}
+	alignment = alignment > 0 ? alignment : 1;
+	unsigned long long alignedHead = ((unsigned long long)m_head + alignment - 1) / alignment * alignment;
+	if (alignedHead + size <= m_capacity && FitsAt((unsigned int)alignedHead, size))
+	{
+		Place((unsigned int)alignedHead, size, false, out_allocation);
+		return true;
+	}
+	if (FitsAtStart(size))
+	{
+		m_stats.m_numWraps++;
+		Place(0, size, false, out_allocation);
+		return true;
+	}
+	m_stats.m_numDiscards++;
+	Place(0, size, true, out_allocation);
+	return true;
+}
+
+unsigned int RingBufferAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+int RingBufferAllocator::GetNumFramesInFlight() const
+{
+	return (int)m_framesInFlight.size();
+}
+
+RingBufferAllocatorStats const& RingBufferAllocator::GetStats() const
+{
+	return m_stats;
+}
+
+bool RingBufferAllocator::HasLiveData() const
+{
+	return !m_framesInFlight.empty() || m_hasCurrentFrameAllocation;
+}
+
+unsigned int RingBufferAllocator::GetTail() const
+{
+	return m_framesInFlight.empty() ? m_currentFrameBegin : m_framesInFlight.front().m_begin;
+}
+
+bool RingBufferAllocator::FitsAt(unsigned int offset, unsigned int size) const
+{
+	if (!HasLiveData())
+	{
+		return true;
+	}
+	// Live data runs from the tail up to the head, wrapping past the end when the head is behind the tail.
+	// A head sitting on the tail with data live means the ring is full
+	unsigned int tail = GetTail();
+	if (m_head > tail)
+	{
+		return true;
+	}
+	if (m_head < tail)
+	{
+		return offset + size <= tail;
+	}
+	return false;
+}
+
+bool RingBufferAllocator::FitsAtStart(unsigned int size) const
+{
+	if (!HasLiveData())
+	{
+		return true;
+	}
+	unsigned int tail = GetTail();
+	return m_head > tail && size <= tail;
+}
+
+void RingBufferAllocator::Place(unsigned int offset, unsigned int size, bool isDiscard, RingAllocation& out_allocation)
+{
+	if (isDiscard)
+	{
+		// Everything in flight belongs to the memory the discard just let go of
+		m_framesInFlight.clear();
+		m_hasCurrentFrameAllocation = false;
+	}
+	if (!m_hasCurrentFrameAllocation)
+	{
+		m_currentFrameBegin = offset;
+		m_hasCurrentFrameAllocation = true;
+	}
+	m_head = offset + size;
+
+	out_allocation.m_offset = offset;
+	out_allocation.m_size = size;
+	out_allocation.m_isDiscard = isDiscard;
+	m_stats.m_numAllocations++;
+	m_stats.m_numBytesAllocated += size;
+}
+
+//..............................
+// Every allocation the model still considers in use, tagged with the buffer memory it was written to
+struct RingTestRange
+{
+	int m_generation = 0;
+	unsigned int m_begin = 0;
+	unsigned int m_end = 0;
+	unsigned long long m_fenceValue = 0; // 0 while its frame is still being recorded
+};
+
+static bool CheckRingTest(bool condition, char const* description, std::vector<std::string>& out_lines)
+{
+	out_lines.push_back(Stringf("  %s: %s", condition ? "pass" : "FAIL", description));
+	return condition;
+}
+
+bool RingBufferAllocator::RunSelfTest(unsigned int seed, int numFrames, std::vector<std::string>& out_lines)
+{
+	bool hasPassed = true;
+
+	// Allocations inside a frame follow each other, aligned, without mapping with discard
+	RingBufferAllocator ring(1000);
+	RingAllocation first;
+	RingAllocation second;
+	ring.Allocate(100, 24, first);
+	ring.Allocate(100, 24, second);
+	hasPassed &= CheckRingTest(first.m_offset == 0 && second.m_offset == 120 && !first.m_isDiscard && !second.m_isDiscard, "allocations in a frame are aligned and back to back", out_lines);
+
+	// Once the GPU is done with frame 1 the ring wraps over it without a discard
+	ring.EndFrame(1);
+	RingAllocation large;
+	ring.Allocate(700, 4, large);
+	ring.EndFrame(2);
+	ring.RetireFrames(1);
+	RingAllocation wrapped;
+	ring.Allocate(200, 4, wrapped);
+	hasPassed &= CheckRingTest(wrapped.m_offset == 0 && !wrapped.m_isDiscard && ring.GetStats().m_numWraps == 1 && ring.GetStats().m_numDiscards == 0, "wrapping over a retired frame doesn't discard", out_lines);
+
+	// With frame 2 still in flight there's no room left, so the next allocation discards
+	RingAllocation blocked;
+	ring.Allocate(300, 4, blocked);
+	hasPassed &= CheckRingTest(blocked.m_offset == 0 && blocked.m_isDiscard && ring.GetStats().m_numDiscards == 1 && ring.GetNumFramesInFlight() == 0, "running into a frame in flight discards", out_lines);
+
+	RingAllocation tooLarge;
+	hasPassed &= CheckRingTest(!ring.Allocate(1001, 4, tooLarge) && !ring.Allocate(0, 4, tooLarge), "empty and larger than the ring allocations fail", out_lines);
+
+	// Randomized frames against a GPU that finishes each frame a random 0 to 3 frames later. The model
+	// keeps every allocation until its fence completes and checks no-overwrite ones never overlap them
+	RandomNumberGenerator rng(seed);
+	RingBufferAllocator randomRing(128 * 1024);
+	std::vector<RingTestRange> liveRanges;
+	int generation = 0;
+	unsigned long long completedFenceValue = 0;
+	int numOverlaps = 0;
+	int numMisaligned = 0;
+	for (int frame = 1; frame <= numFrames; frame++)
+	{
+		int numAllocations = rng.RollRandomIntInRange(0, 40);
+		for (int i = 0; i < numAllocations; i++)
+		{
+			unsigned int alignment = rng.RollRandomIntInRange(0, 1) == 0 ? 24 : 4;
+			unsigned int size = (unsigned int)rng.RollRandomIntInRange(1, 128) * alignment;
+			RingAllocation allocation;
+			if (!randomRing.Allocate(size, alignment, allocation))
+			{
+				continue;
+			}
+			if (allocation.m_isDiscard)
+			{
+				generation++;
+			}
+			numMisaligned += allocation.m_offset % alignment != 0 ? 1 : 0;
+			for (size_t rangeIndex = 0; rangeIndex < liveRanges.size(); rangeIndex++)
+			{
+				RingTestRange const& range = liveRanges[rangeIndex];
+				bool isOverlapping = allocation.m_offset < range.m_end && range.m_begin < allocation.m_offset + allocation.m_size;
+				numOverlaps += range.m_generation == generation && isOverlapping ? 1 : 0;
+			}
+			RingTestRange range;
+			range.m_generation = generation;
+			range.m_begin = allocation.m_offset;
+			range.m_end = allocation.m_offset + allocation.m_size;
+			liveRanges.push_back(range);
+		}
+
+		randomRing.EndFrame((unsigned long long)frame);
+		for (size_t rangeIndex = 0; rangeIndex < liveRanges.size(); rangeIndex++)
+		{
+			if (liveRanges[rangeIndex].m_fenceValue == 0)
+			{
+				liveRanges[rangeIndex].m_fenceValue = (unsigned long long)frame;
+			}
+		}
+
+		int latency = rng.RollRandomIntInRange(0, MAX_FRAMES_IN_FLIGHT);
+		if (frame - latency > (int)completedFenceValue)
+		{
+			completedFenceValue = (unsigned long long)(frame - latency);
+			randomRing.RetireFrames(completedFenceValue);
+			for (int rangeIndex = (int)liveRanges.size() - 1; rangeIndex >= 0; rangeIndex--)
+			{
+				if (liveRanges[rangeIndex].m_fenceValue <= completedFenceValue)
+				{
+					liveRanges.erase(liveRanges.begin() + rangeIndex);
+				}
+			}
+		}
+	}
+	RingBufferAllocatorStats const& stats = randomRing.GetStats();
+	out_lines.push_back(Stringf("  randomized: %d frames, %d allocations (%d KB), %d wraps, %d discards", numFrames, stats.m_numAllocations, (int)(stats.m_numBytesAllocated / 1024), stats.m_numWraps, stats.m_numDiscards));
+	hasPassed &= CheckRingTest(numOverlaps == 0, "no allocation overlaps memory still in flight", out_lines);
+	hasPassed &= CheckRingTest(numMisaligned == 0, "every allocation is aligned", out_lines);
+	hasPassed &= CheckRingTest(stats.m_numWraps > 0 && stats.m_numDiscards < stats.m_numWraps, "the randomized run wraps more often than it discards", out_lines);
+	return hasPassed;
+}
+
+bool RingBufferAllocator::Command_RingBufferAllocatorTest(EventArgs& args)
+{
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1234);
+	int numFrames = args.GetValue("frames", 2000);
+	std::vector<std::string> lines;
+	bool hasPassed = RunSelfTest(seed, numFrames, lines);
+	g_theDevConsole->AddLine(hasPassed ? DevConsole::INFO_MAJOR : DevConsole::ERROR, Stringf("Ring buffer allocator test %s", hasPassed ? "passed" : "FAILED"));
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		g_theDevConsole->AddLine(lines[i].find("FAIL") != std::string::npos ? DevConsole::ERROR : DevConsole::INFO_MINOR, lines[i]);
+	}
+	return false;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+
+class NamedStrings;
+typedef NamedStrings EventArgs;
+
+constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+
+// Where an allocation went and how the buffer has to be mapped to write it. A discard gives the
+// buffer fresh memory, so it's only used when the ring has nowhere left that the GPU is done with
+struct RingAllocation
+{
+	unsigned int m_offset = 0;
+	unsigned int m_size = 0;
+	bool m_isDiscard = false;
+};
+
+struct RingBufferAllocatorStats
+{
+	int m_numAllocations = 0;
+	int m_numWraps = 0;
+	int m_numDiscards = 0;
+	int m_numFailedAllocations = 0;
+	size_t m_numBytesAllocated = 0;
+};
+
+// Sub-allocates a dynamic buffer as a ring, CPU side only. Every frame's allocations stay in flight
+// from EndFrame until RetireFrames sees its fence value complete, and a no-overwrite allocation never
+// lands on memory that's still in flight. When nothing fits, the allocation discards and starts over at
+// 0: the driver keeps the old memory alive for the frames still reading it.
+class RingBufferAllocator
+{
+public:
+	RingBufferAllocator(unsigned int capacity = 0);
+
+	// Forgets everything, including what's in flight. Only for a buffer that was just (re)created
+	void Reset(unsigned int capacity);
+	// Ends the frame being recorded, its allocations stay in flight until fenceValue completes
+	void EndFrame(unsigned long long fenceValue);
+	// Frames are retired in order, so completing a fence completes every earlier one
+	void RetireFrames(unsigned long long completedFenceValue);
+	// Alignment doesn't have to be a power of two, so a vertex stride works and offset / stride is exact.
+	// Fails when size is 0 or more than the whole ring
+	bool Allocate(unsigned int size, unsigned int alignment, RingAllocation& out_allocation);
+
+	unsigned int GetCapacity() const;
+	int GetNumFramesInFlight() const;
+	RingBufferAllocatorStats const& GetStats() const;
+
+	// Allocator-only checks, no GPU involved: alignment, wrapping over retired frames, discarding over
+	// frames in flight, and a randomized run checked against a separate model of what's in flight
+	static bool RunSelfTest(unsigned int seed, int numFrames, std::vector<std::string>& out_lines);
+	static bool Command_RingBufferAllocatorTest(EventArgs& args);
+
+private:
+	struct FrameRegion
+	{
+		unsigned int m_begin = 0;
+		unsigned long long m_fenceValue = 0;
+	};
+
+	bool HasLiveData() const;
+	unsigned int GetTail() const;
+	bool FitsAt(unsigned int offset, unsigned int size) const;
+	bool FitsAtStart(unsigned int size) const;
+	void Place(unsigned int offset, unsigned int size, bool isDiscard, RingAllocation& out_allocation);
+
+	unsigned int m_capacity = 0;
+	unsigned int m_head = 0;
+	// Frames ended since the last discard and not retired yet, oldest first
+	std::deque<FrameRegion> m_framesInFlight;
+	unsigned int m_currentFrameBegin = 0;
+	bool m_hasCurrentFrameAllocation = false;
+	RingBufferAllocatorStats m_stats;
+};